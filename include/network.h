@@ -4,7 +4,18 @@
 #include "game_state.h"
 
 #define DEFAULT_PORT 5000
-#define MAX_CLIENTS 32
+#ifndef MAX_CLIENTS
+#define MAX_CLIENTS 32 /* Build-time override for load tests, see Makefile */
+#endif
+
+/* Object ids in updates and commands: captains 1..MAX_CLIENTS, then one range per kind.
+   Up to 99 captains the ranges start at 100/500/1000/2000/3000; larger builds shift them all past MAX_CLIENTS */
+#define ID_SHIFT (MAX_CLIENTS < 100 ? 0 : MAX_CLIENTS / 100 * 100)
+#define ID_NPC (100 + ID_SHIFT)
+#define ID_BASE (500 + ID_SHIFT)
+#define ID_PLANET (1000 + ID_SHIFT)
+#define ID_STAR (2000 + ID_SHIFT)
+#define ID_BH (3000 + ID_SHIFT)
 #define PKT_LOGIN 1
 #define PKT_COMMAND 2
 #define PKT_UPDATE 3
@@ -60,10 +71,14 @@ typedef struct {
     char text[4096];
 } PacketMessage;
 
+/* Simulation rate: server_tick advances NET_TICK_HZ times per second of game time */
+#define NET_TICK_HZ 30
+
 /* Update Packet: Inviato dal server ai client per aggiornare la Tactical View */
 typedef struct {
     int type;
     long long frame_id;
+    long long server_tick;     /* Simulation tick the snapshot was taken at */
     int q1, q2, q3;
     double s1, s2, s3;
     double ent_h, ent_m;
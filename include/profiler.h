@@ -0,0 +1,46 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Tick Profiler
+ * Per-phase latency histograms and per-tick counters for the server loop.
+ * Build with -DTREK_PROFILE (make PROFILE=1, the default) to enable it: without
+ * the flag every recording hook compiles to nothing.
+ */
+
+#define PROF_MAX_PHASES 8
+#define PROF_WINDOW 300             /* Rolling window: 10 seconds at 30 FPS */
+#define PROF_SUB_BITS 3             /* 8 sub-buckets per power of two (12.5% resolution) */
+#define PROF_BUCKETS (64 << PROF_SUB_BITS)
+
+typedef enum {
+    PROF_CTR_SCANNED = 0,           /* Entities visited by simulation loops */
+    PROF_CTR_BYTES_SENT,
+    PROF_CTR_SYSCALLS,              /* Socket and sleep syscalls */
+    PROF_CTR_COUNT
+} ProfCounter;
+
+#ifdef TREK_PROFILE
+extern uint64_t prof_counters[PROF_CTR_COUNT];
+
+void prof_init(const char **phase_names, int phase_count);
+void prof_phase(int phase, uint64_t ns);
+void prof_end_tick(uint64_t tick_ns);
+#define PROF_COUNT(ctr, n) __atomic_fetch_add(&prof_counters[ctr], (uint64_t)(n), __ATOMIC_RELAXED)
+#else
+#define prof_init(names, count) ((void)0)
+#define prof_phase(phase, ns) ((void)0)
+#define prof_end_tick(ns) ((void)0)
+#define PROF_COUNT(ctr, n) ((void)0)
+#endif
+
+/* Text report: rolling p50/p99/max per phase and counter, lifetime histogram percentiles */
+void prof_report(char *buf, size_t len);
+
+/* Local admin endpoint: a 0600 Unix stream socket, returns the listening fd or -1 */
+int prof_listen(const char *path);
+
+#endif
@@ -0,0 +1,197 @@
+#ifndef SERVER_SIM_H
+#define SERVER_SIM_H
+
+#include <sys/types.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdint.h>
+#include "network.h"
+
+/*
+ * Server Simulation
+ * World state, tick phases and the tick scheduler, kept free of sockets so the
+ * same code runs behind trek_server, the benchmarks and headless tools.
+ * A captain whose socket is -1 is headless: everything sent to it is dropped.
+ */
+
+typedef enum {
+    NAV_STATE_IDLE = 0,
+    NAV_STATE_ALIGN,
+    NAV_STATE_WARP,
+    NAV_STATE_REALIGN,
+    NAV_STATE_IMPULSE
+} NavState;
+
+typedef struct {
+    int socket;
+    char name[64];
+    int faction;
+    int ship_class;
+    int active;
+    
+    /* Warp State */
+    NavState nav_state;
+    int nav_timer; /* In frame (20 FPS) */
+    double start_h, start_m;
+    double target_h, target_m;
+    double target_gx, target_gy, target_gz;
+    double dx, dy, dz;
+    double warp_speed;
+    long long last_cmd_tick; /* Scheduler idle detection */
+
+    StarTrekGame state; 
+} ConnectedPlayer;
+
+typedef enum {
+    AI_STATE_PATROL = 0,
+    AI_STATE_CHASE,
+    AI_STATE_FLEE
+} AIState;
+
+typedef struct { int id, faction, q1, q2, q3; double x, y, z; int active; } NPCStar;
+typedef struct { int id, q1, q2, q3; double x, y, z; int active; } NPCBlackHole;
+typedef struct { int id, faction, q1, q2, q3; double x, y, z, h, m; int energy, active; int fire_cooldown; AIState ai_state; int target_player_idx; int nav_timer; double dx, dy, dz; } NPCShip;
+typedef struct { int id, q1, q2, q3; double x, y, z; int resource_type, amount, active; } NPCPlanet;
+typedef struct { int id, faction, q1, q2, q3; double x, y, z; int health, active; } NPCBase;
+
+#define MAX_NPC 600
+#define MAX_PLANETS 400
+#define MAX_BASES 100
+#define MAX_STARS 1200
+#define MAX_BH 100
+
+/* Projectile pool: torpedoes, probes and future weapon types live in one dense
+ * array that is integrated once per tick. Positions are galactic (0-100 per
+ * axis) so a projectile keeps flying when it crosses a quadrant boundary. */
+typedef enum {
+    PROJ_TORPEDO = 0,
+    PROJ_PROBE
+} ProjectileType;
+
+typedef struct {
+    ProjectileType type;
+    int owner;                /* players[] index of the launcher */
+    double gx, gy, gz;        /* Galactic position */
+    double dx, dy, dz;        /* Unit heading */
+    double speed;             /* Units per tick */
+    int ttl;                  /* Ticks left before the projectile expires */
+    int target_q1, target_q2, target_q3; /* Probe destination */
+} Projectile;
+
+#define MAX_PROJECTILES 256
+#define TORP_SPEED 0.8
+#define TORP_TTL 60           /* 2 seconds at 30 FPS (48 units) */
+#define TORP_RADIUS_PLAYER 0.5
+#define TORP_RADIUS_NPC 0.6
+#define PROBE_SPEED 2.0
+
+/* Tick scheduler: phase timings, overrun detection and load shedding */
+#define TICK_NS (1000000000LL / NET_TICK_HZ)
+#define TICK_MS (TICK_NS / 1e6)
+#define MAX_CATCHUP_TICKS 30      /* Up to 1 second of simulation is replayed back-to-back */
+#define SCHED_RAISE_TICKS 15      /* 0.5 s of sustained overload per shedding level */
+#define SCHED_LOWER_TICKS 90      /* 3 s of headroom before service is restored */
+#define IDLE_TICKS 150            /* A captain without commands for 5 s is idle */
+#define IDLE_UPDATE_STRIDE 3      /* Idle captains get 10 updates/s when throttled */
+#define NPC_NAP_STRIDE 4          /* Napping NPCs think at 7.5 Hz */
+
+typedef enum {
+    PHASE_NAV = 0,
+    PHASE_HAZARDS,
+    PHASE_PROJECTILES,
+    PHASE_NPC_AI,
+    PHASE_UPDATES,
+    PHASE_AUTOSAVE,
+    PHASE_COUNT
+} TickPhase;
+
+typedef struct {
+    int level;                    /* 0: full service .. 3: cosmetic events skipped */
+    double phase_ms[PHASE_COUNT]; /* Last tick */
+    double avg_ms, max_ms, load_ewma;
+    int hot_ticks, cool_ticks;
+    long long overruns, catchup_ticks, ticks_dropped;
+    long long updates_shed, npc_naps, events_shed;
+    long long level_ticks[4];
+} TickScheduler;
+
+/* Quadrant index rebuilt every tick: players and NPCs bucketed by quadrant with
+ * a counting sort, so per-quadrant candidate lists cost O(1) to find. */
+#define QUAD_CELLS 1000
+#define QUAD_CELL(q1,q2,q3) (((q1)-1)*100 + ((q2)-1)*10 + ((q3)-1))
+
+extern NPCStar stars_data[MAX_STARS];
+extern NPCBlackHole black_holes[MAX_BH];
+extern NPCPlanet planets[MAX_PLANETS];
+extern NPCBase bases[MAX_BASES];
+extern NPCShip npcs[MAX_NPC];
+extern ConnectedPlayer players[MAX_CLIENTS];
+extern StarTrekGame galaxy_master;
+extern Projectile projectiles[MAX_PROJECTILES];
+extern int projectile_count;
+extern TickScheduler sched;
+extern long long server_tick;
+extern const char *phase_names[PHASE_COUNT];
+extern int quad_npc_start[QUAD_CELLS+1], quad_npc_list[MAX_NPC];
+extern int quad_player_start[QUAD_CELLS+1], quad_player_list[MAX_CLIENTS];
+extern volatile sig_atomic_t trace_dump_requested;
+extern int sched_pinned;      /* Replay: shedding levels come from the session log */
+extern int autosave_enabled;
+extern const char *galaxy_path; /* save_galaxy()/load_galaxy() target, "galaxy.dat" */
+
+/* Simulation RNG: one seeded stream for generation, combat rolls and AI, so a
+ * recorded session replays bit for bit. Only the thread owning the world calls it. */
+extern uint64_t sim_rng_state;
+void sim_seed(uint64_t seed);
+int sim_rand();
+
+/* Long-run health of the world tables (soak reports) */
+typedef struct {
+    int active[5], high[5];       /* NPCs, planets, bases, stars, black holes: live count and high-water index */
+    int census_stale;             /* Quadrants whose galaxy map entry no longer matches the live census */
+    int census_enemies_off;       /* Sum over quadrants of |map enemies - live enemies| */
+    int k9_off;                   /* galaxy_master.k9 minus live NPCs */
+} WorldAudit;
+
+/* Persistence */
+void save_galaxy();
+int load_galaxy();
+void generate_galaxy();
+long world_size();
+void world_write(FILE *f);
+int world_read(FILE *f);
+uint64_t sim_state_hash();
+const char *get_species_name(int s);
+
+/* Output towards captains */
+ssize_t server_send(int p_idx, const void *buf, size_t len);
+void broadcast_message(PacketMessage *msg);
+void send_server_msg(int p_idx, const char *from, const char *text);
+
+/* World queries */
+void build_quadrant_index();
+int quadrant_census(int q1, int q2, int q3);
+void build_update(int i, PacketUpdate *upd);
+NetPoint quadrant_torpedo(int i);
+void world_audit(WorldAudit *a);
+
+/* Projectiles */
+Projectile *launch_projectile(ProjectileType type, int owner, double dx, double dy, double dz, double speed, int ttl);
+void expire_projectiles(int owner);
+double sweep_sphere(double px, double py, double pz, double vx, double vy, double vz, double cx, double cy, double cz, double r);
+void update_projectiles();
+
+/* Tick phases, in run order */
+void phase_navigation();
+void phase_hazards();
+void phase_projectiles();
+void phase_npc_ai();
+void phase_updates();
+void phase_autosave();
+
+/* Scheduler */
+double now_ms();
+void sched_report(char *b, size_t len);
+void run_tick(double lag_ms);
+
+#endif
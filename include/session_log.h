@@ -0,0 +1,66 @@
+#ifndef SESSION_LOG_H
+#define SESSION_LOG_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "network.h"
+
+/*
+ * Session Log
+ * Deterministic record of a server run: the world and RNG state at startup,
+ * then every input applied to the simulation (connects, packets, disconnects,
+ * shedding level changes) stamped with the tick it followed, plus a state
+ * hash checkpoint every SLOG_HASH_STRIDE ticks. Replaying the log through
+ * run_tick reproduces the session bit for bit.
+ *
+ * Layout: header, world_size() bytes of world, then records of
+ *   kind:u8  tick_delta:varint  slot:varint  payload
+ * where payload is varint length + packet bytes (trailing zeros trimmed)
+ * for SLOG_PACKET, u8 for SLOG_LEVEL and u64 for SLOG_HASH.
+ */
+
+#define SLOG_MAGIC "TREKREC1"
+#define SLOG_VERSION 1
+#define SLOG_HASH_STRIDE 30         /* One checkpoint per second of simulation */
+
+typedef enum {
+    SLOG_CONNECT = 1,
+    SLOG_PACKET,
+    SLOG_DISCONNECT,
+    SLOG_LEVEL,
+    SLOG_HASH
+} SlogKind;
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t max_clients;
+    uint32_t world_size;
+    uint32_t reserved;
+    uint64_t seed;                  /* As passed to sim_seed() at startup */
+    uint64_t rng_state;             /* sim_rng_state when the log was opened */
+    int64_t start_tick;
+} SlogHeader;
+
+typedef struct {
+    SlogKind kind;
+    long long tick;
+    int slot;
+    int len;
+    int level;
+    uint64_t hash;
+    unsigned char data[sizeof(PacketMessage)]; /* Zero-padded to the packet size */
+} SlogRecord;
+
+/* Recording: every call is made with the world locked, so records are in apply order */
+extern FILE *slog_out;
+int slog_record_open(const char *path, uint64_t seed);
+/* SLOG_LEVEL passes the level as len, SLOG_HASH a uint64_t in data */
+void slog_record(SlogKind kind, int slot, const void *data, int len);
+void slog_record_close();
+
+/* Replay: restores world, RNG and tick from the header; 1 per record read, 0 at the end */
+FILE *slog_replay_open(const char *path, SlogHeader *hdr);
+int slog_read(FILE *f, SlogRecord *r);
+
+#endif
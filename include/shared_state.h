@@ -1,15 +1,30 @@
 #ifndef SHARED_STATE_H
 #define SHARED_STATE_H
 
-#include <pthread.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 
 #define MAX_OBJECTS 200
 #define MAX_BEAMS 10
+#define SHM_BEAM_RING 32            /* Power of two */
 #define SHM_NAME "/startrek_ultra_shm"
 
-/* 
+/*
  * Shared State Structure
  * Replaces the textual format of /tmp/ultra_map.dat
+ *
+ * Lock-free between trek_client (one writer: the network thread) and
+ * trek_3dview (one reader: the render loop). Frames go through a triple
+ * buffer: the writer fills its back frame and swaps it into `latest`, the
+ * reader swaps `latest` with its front frame when the FRESH bit is set, so
+ * neither side ever waits and a handoff is two atomic exchanges. Phaser
+ * beams are a single-producer ring so none is lost when frames are skipped;
+ * explosions carry a sequence number instead of a flag the reader clears.
+ * The other way, the viewer posts click-to-lock requests as one 64-bit word:
+ * only the latest counts, and the count makes a repeated id a new request.
  */
 
 typedef struct {
@@ -39,32 +54,116 @@ typedef struct {
 } SharedDismantle;
 
 typedef struct {
-    pthread_mutex_t mutex;
-    
     /* UI Info */
     int shm_energy;
     int shm_shields[6];
     int inventory[7];
     int klingons;
     char quadrant[128];
-    int shm_show_axes;
-    int shm_show_grid;
     int is_cloaked;
 
     /* Object List */
     int object_count;
     SharedObject objects[MAX_OBJECTS];
 
-    /* FX */
-    int beam_count;
-    SharedBeam beams[MAX_BEAMS];
-    
     SharedPoint torp;
-    SharedPoint boom;
-    SharedDismantle dismantle;
-    
+    SharedPoint boom;                /* Latest explosion, new when boom_seq changes */
+    SharedDismantle dismantle;       /* Latest wreck, new when dismantle_seq changes */
+    uint32_t boom_seq, dismantle_seq;
+
     /* Synchronization counter */
     long long frame_id;
+    long long server_tick;           /* Server simulation tick of the snapshot */
+    double recv_ms;                  /* shm_now_ms() when the client received it */
+} ShmFrame;
+
+#define SHM_FRESH 4u                 /* Set in `latest` when it holds an unread frame */
+
+typedef struct {
+    ShmFrame frames[3];
+    uint32_t latest;                 /* Frame index | SHM_FRESH, swapped by both sides */
+    uint32_t frame_seq;              /* Futex word: bumped on every publish */
+    uint32_t waiters;                /* Readers blocked in shm_wait_frame() */
+
+    SharedBeam beams[SHM_BEAM_RING];
+    uint32_t beam_head;              /* Written by the client only */
+    uint32_t beam_tail;              /* Written by the viewer only */
+
+    /* Display toggles, written by the client's command line */
+    int shm_show_axes;
+    int shm_show_grid;
+
+    uint32_t viewer_ready;           /* Futex word: the viewer has mapped the segment */
+
+    uint64_t lock_request;           /* Click-to-lock: request count << 32 | target id, written by the viewer only */
 } GameState;
 
+/* Monotonic milliseconds shared by the client's receive stamps and the viewer's playout clock */
+static inline double shm_now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static inline long shm_futex(uint32_t *addr, int op, uint32_t val, const struct timespec *timeout) {
+    return syscall(SYS_futex, addr, op, val, timeout, NULL, 0);
+}
+
+/* Writer: the client starts with back frame 0, `latest` = 1, the viewer with front frame 2 */
+static inline void shm_init(GameState *s) { s->latest = 1; }
+
+static inline ShmFrame *shm_publish(GameState *s, int *back) {
+    uint32_t prev = __atomic_exchange_n(&s->latest, (uint32_t)*back | SHM_FRESH, __ATOMIC_ACQ_REL);
+    *back = prev & 3;
+    /* Store then load on both sides (waiters in shm_wait_frame): only SEQ_CST keeps both from seeing the old value */
+    __atomic_fetch_add(&s->frame_seq, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&s->waiters, __ATOMIC_SEQ_CST)) shm_futex(&s->frame_seq, FUTEX_WAKE, INT32_MAX, NULL);
+    return &s->frames[*back];
+}
+
+/* Reader: the freshest complete frame, or NULL if nothing was published since the last call */
+static inline ShmFrame *shm_acquire(GameState *s, int *front) {
+    if (!(__atomic_load_n(&s->latest, __ATOMIC_ACQUIRE) & SHM_FRESH)) return NULL;
+    uint32_t prev = __atomic_exchange_n(&s->latest, (uint32_t)*front, __ATOMIC_ACQ_REL);
+    *front = prev & 3;
+    return &s->frames[*front];
+}
+
+/* Reader: sleep until the writer publishes after `seen` (a frame_seq value) or the timeout expires */
+static inline void shm_wait_frame(GameState *s, uint32_t seen, const struct timespec *timeout) {
+    __atomic_fetch_add(&s->waiters, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&s->frame_seq, __ATOMIC_SEQ_CST) == seen) shm_futex(&s->frame_seq, FUTEX_WAIT, seen, timeout);
+    __atomic_fetch_sub(&s->waiters, 1, __ATOMIC_ACQ_REL);
+}
+
+static inline void shm_push_beam(GameState *s, const SharedBeam *b) {
+    uint32_t head = s->beam_head;
+    if (head - __atomic_load_n(&s->beam_tail, __ATOMIC_ACQUIRE) >= SHM_BEAM_RING) return; /* Viewer behind: drop */
+    s->beams[head & (SHM_BEAM_RING - 1)] = *b;
+    __atomic_store_n(&s->beam_head, head + 1, __ATOMIC_RELEASE);
+}
+
+static inline int shm_pop_beam(GameState *s, SharedBeam *b) {
+    uint32_t tail = s->beam_tail;
+    if (tail == __atomic_load_n(&s->beam_head, __ATOMIC_ACQUIRE)) return 0;
+    *b = s->beams[tail & (SHM_BEAM_RING - 1)];
+    __atomic_store_n(&s->beam_tail, tail + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+/* Viewer: ask the client to lock `id` */
+static inline void shm_request_lock(GameState *s, int id) {
+    uint64_t cur = __atomic_load_n(&s->lock_request, __ATOMIC_RELAXED);
+    __atomic_store_n(&s->lock_request, ((cur >> 32) + 1) << 32 | (uint32_t)id, __ATOMIC_RELEASE);
+}
+
+/* Client: 1 and the id if a request came after `*seen` */
+static inline int shm_take_lock(GameState *s, uint64_t *seen, int *id) {
+    uint64_t req = __atomic_load_n(&s->lock_request, __ATOMIC_ACQUIRE);
+    if (req == *seen) return 0;
+    *seen = req;
+    *id = (int)(uint32_t)req;
+    return 1;
+}
+
 #endif
@@ -0,0 +1,46 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Span Tracer
+ * Ring buffer of timed spans (tick phases, command handlers, socket I/O)
+ * exported as Chrome/Perfetto trace-event JSON. Build with -DTREK_TRACE
+ * (make TRACE=1, the default); recording also has to be switched on at run
+ * time (TREK_TRACE=1 or "aux trace on"), otherwise each hook is one branch.
+ */
+
+#define TRACE_RING 65536            /* Power of two: about a minute of a busy server */
+#define TRACE_NAME_LEN 16
+
+/* Timeline lanes (Chrome "tid") */
+#define TRACE_TID_GAME 1            /* game_loop thread */
+#define TRACE_TID_NET 2             /* select/accept/read thread */
+#define TRACE_TID_PLAYER 100        /* + player slot: command handlers */
+
+typedef enum { TRACE_CAT_PHASE = 0, TRACE_CAT_CMD, TRACE_CAT_IO, TRACE_CAT_COUNT } TraceCategory;
+
+#ifdef TREK_TRACE
+extern int trace_on;
+
+uint64_t trace_now(void);
+void trace_set_thread(int tid);
+int trace_thread(void);
+void trace_span(TraceCategory cat, int tid, const char *name, uint64_t t0, uint64_t t1, int player, long long arg);
+/* Marks the ring position; a background thread copies the spans before it and writes them. -1 if off or a dump is in progress */
+int trace_dump(const char *reason, long long tick, char *path, size_t len);
+
+#define TRACE_BEGIN(var) uint64_t var = trace_on ? trace_now() : 0
+#define TRACE_END(var, cat, tid, name, player, arg) do { if (trace_on && var) trace_span(cat, tid, name, var, trace_now(), player, arg); } while (0)
+#else
+#define trace_on 0
+#define trace_set_thread(tid) ((void)0)
+#define trace_span(cat, tid, name, t0, t1, player, arg) ((void)0)
+#define trace_dump(reason, tick, path, len) (-1)
+#define TRACE_BEGIN(var)
+#define TRACE_END(var, cat, tid, name, player, arg) ((void)0)
+#endif
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef VIEW_BENCH_H
+#define VIEW_BENCH_H
+
+#include <stdio.h>
+#include "shared_state.h"
+
+/*
+ * Headless Renderer Benchmark (trek_3dview --bench)
+ * Renders frames into an offscreen framebuffer of an EGL surfaceless
+ * context (llvmpipe works), without a window system. Scenes come from a
+ * synthetic generator or from frames recorded by `trek_3dview --record`.
+ * The bench runs the viewer's own loop on a virtual clock: a server frame
+ * every tick (33 ms) and a rendered frame every 16 ms, whatever the real cost, so
+ * two runs render the same images and only the timings move.
+ * Output: one JSON line with CPU, GPU and frame time percentiles, draw
+ * calls and vertices per frame, and the cost of one click-to-lock pick at
+ * a random pixel per frame; optional PNG dumps check correctness.
+ */
+
+#define BENCH_FRAME_MS 16.0         /* Virtual time between rendered frames, as the GLUT timer */
+
+/* Viewer entry points the bench drives (trek_3dview.c) */
+extern GameState *g_shared_state;
+extern int g_headless;              /* No GLUT: no buffer swaps, virtual clock */
+extern double g_bench_clock;        /* Virtual playout clock while headless, in ms */
+int viewInit();                     /* GL state, static lists and baked meshes: 0 without GL 3.3 */
+void display();
+void reshape(int w, int h);
+void viewTick();
+int pickAt(int x, int y);           /* Click-to-lock query against the frame on screen */
+
+int view_bench(int argc, char **argv);
+
+/* Appends every frame the viewer acquires to a recording */
+void bench_record(FILE *out, const ShmFrame *f);
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef VIEW_CAPTURE_H
+#define VIEW_CAPTURE_H
+
+/*
+ * Frame Capture (trek_3dview --capture, --bench -c)
+ * Records what the viewer draws to a YUV4MPEG2 (.y4m) stream that ffmpeg,
+ * mpv and most encoders read as is. Each frame is read back into one of
+ * CAPTURE_SLOTS pixel buffer objects without waiting; a later frame maps
+ * it once its fence has signalled and hands the mapping to an encoder
+ * thread, which converts it to 4:2:0 (BT.601, full range) and writes it
+ * out, and the render loop unmaps it when the thread is done. The render
+ * loop never waits on the GPU or the disk: with every slot busy a frame is
+ * dropped and counted instead.
+ * The stream runs at CAPTURE_FPS against the clock the caller passes in
+ * (wall time in the window, the virtual clock in the bench): frames drawn
+ * faster are skipped, and a frame after a gap, or after a dropped frame, is
+ * written as many times as the time since the previous one needs.
+ */
+
+#define CAPTURE_SLOTS 4
+#define CAPTURE_FPS 60
+
+/* Starts a capture of width x height (rounded down to even) into `path`: 0 on failure */
+int capture_open(const char *path, int width, int height);
+
+/* After the frame is drawn, with the time it shows: reads it back and moves earlier frames along. No-op when not capturing */
+void capture_frame(double now_ms);
+
+/* The stream's frame size: a Y4M stream cannot change it */
+void capture_size(int *width, int *height);
+
+/* Waits for every frame in flight, writes it and closes the stream */
+void capture_close();
+
+int capture_active();
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef VIEW_FX_H
+#define VIEW_FX_H
+
+/*
+ * Pooled Effects (trek_3dview)
+ * Explosions, wrecks, phaser beams, torpedo wakes and warp flashes are all
+ * particles of one fixed pool. A particle is written once, when it is
+ * emitted: origin, velocity, size at birth and death, colour, birth tick and
+ * lifetime. The vertex shader moves, grows and fades it from the effects
+ * clock, so the CPU never touches a live particle again. Each frame uploads
+ * only the slots emitted since the previous one and draws the whole pool
+ * with one instanced call; dead slots collapse in the shader. Slots are
+ * handed out round-robin, so a full pool recycles its oldest particles and
+ * the cost stays flat however many effects stack up.
+ */
+
+#define FX_MAX_PARTICLES 16384
+#define FX_REBASE_TICKS (1 << 20)   /* Clock rebase (~4.6 h): keeps birth ticks exact in a float */
+
+/* Flags */
+#define FX_SOFT 1                   /* Round billboard with a soft edge (fireballs, glows) */
+#define FX_PIXELS 2                 /* Size in pixels instead of world units (sparks, debris) */
+#define FX_BEAM 4                   /* Segment from the origin to `v`, `size` pixels wide */
+#define FX_HOLD 8                   /* Full alpha for the first third of the life, then fade */
+
+typedef struct {
+    float p[3];                     /* Origin */
+    float v[3];                     /* World units per tick; a beam's far end */
+    float size[2];                  /* At birth and at death: radius in world units, or diameter in pixels */
+    float birth, life;              /* Effects clock, in ticks */
+    unsigned char c[4];
+    unsigned int flags;
+} FxParticle;
+
+/* Buffers and shader: 0 if the context lacks GL 3.3 (after vgl_init()) */
+int fx_init();
+
+/* One animation step (16 ms): every live particle ages by one tick */
+void fx_tick();
+
+/* 1 while any particle is alive: the view still animates */
+int fx_busy();
+
+/* Uploads the particles emitted since the last call and draws the pool, after the opaque geometry */
+void fx_draw();
+
+/* Fraction of the spark and debris particles each effect emits, (0, 1] (quality governor) */
+void fx_density(float density);
+
+/* Effects, in viewer coordinates */
+void fx_explosion(float x, float y, float z);
+void fx_dismantle(float x, float y, float z);
+void fx_phaser(const float *from, const float *to);
+void fx_torpedo_wake(float x, float y, float z);
+void fx_warp_flash(float x, float y, float z);
+
+#endif
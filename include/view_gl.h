@@ -0,0 +1,101 @@
+#ifndef VIEW_GL_H
+#define VIEW_GL_H
+
+/*
+ * Core-profile Rendering (trek_3dview)
+ * Per-frame data (camera, overlay projection, light, viewport) lives in one
+ * uniform buffer that every viewer shader reads through the Frame block.
+ * The static scenery (stars, sector box, compass, grid) is recorded with
+ * the glBegin / glColor / glVertex vocabulary into lists before vgl_init(),
+ * which uploads them once to a static buffer. vgl_call() queues a list's
+ * runs and vgl_flush() draws each run of equal state with one call.
+ * Per-frame geometry lives in the mesh, overlay, trail and effects modules.
+ */
+
+#define VGL_FRAME_BINDING 0         /* Uniform buffer binding of the Frame block */
+#define VGL_MAX_VERTICES 65536      /* Vertices per primitive */
+#define VGL_MAX_RUNS 256            /* Runs per list and per flush */
+#define VGL_MAX_LISTS 16
+
+/* The Frame block as every viewer shader declares it (std140, same layout as ViewFrame) */
+#define VGL_FRAME_GLSL \
+    "layout(std140) uniform Frame { mat4 view; mat4 proj; mat4 screen; vec4 light; vec4 viewport; };\n"
+
+typedef struct {
+    float view[16];                 /* World to eye */
+    float proj[16];
+    float screen[16];               /* Window pixels to clip, origin bottom left */
+    float light[4];                 /* LIGHT0 in eye space */
+    float viewport[4];
+} ViewFrame;
+
+enum { VGL_POINTS, VGL_LINES, VGL_LINE_STRIP, VGL_LINE_LOOP, VGL_TRIANGLES, VGL_QUADS };
+#define VGL_SCREEN 1                /* Vertices in window pixels, drawn without depth test */
+
+/* Submitted by the batcher and the meshes since start, for the benchmark */
+typedef struct { long draws, vertices; } VglStats;
+extern VglStats vgl_stats;
+
+/* Static lists: record between vgl_list_begin() and vgl_list_end(), before vgl_init() */
+int vgl_list_begin();
+void vgl_list_end();
+
+/* Shader, buffers and the uploaded lists: 0 if the context lacks GL 3.3. Checks the version for every module, so it runs first */
+int vgl_init();
+
+/* Compiles and links a program with the Frame block bound, logging failures under `name`: 0 on failure */
+unsigned vgl_program(const char *name, const char *vertex, const char *fragment);
+
+/* Camera for the frame: fills and uploads the Frame block */
+void vgl_frame(const float *view, const float *proj, int width, int height);
+const ViewFrame *vgl_current();
+
+/* World point to window pixels and depth: 0 if it is behind the camera */
+int vgl_project(float x, float y, float z, float *win);
+
+/* Primitives of the list being recorded (ignored outside one); `size` is the line width or point size */
+void vgl_begin(int prim, float size, int flags);
+void vgl_color3(float r, float g, float b);
+void vgl_color4(float r, float g, float b, float a);
+void vgl_vertex(float x, float y, float z);
+void vgl_end();
+void vgl_call(int list);
+
+/* Draws the lists called since the last flush, in order */
+void vgl_flush();
+
+/*
+ * Streams: per-frame vertex data written straight into GPU-visible memory.
+ * The buffer holds VGL_STREAM_FRAMES sections; each frame writes into the
+ * next one, and a fence set at the following vgl_frame() says when the GPU
+ * is done with it, so writers never wait on a draw in flight and nothing is
+ * orphaned. With ARB_buffer_storage (GL 4.4) the buffer is mapped once,
+ * persistent and coherent; without it, or with TREK_NO_BUFFER_STORAGE set,
+ * each write maps its range unsynchronized, which the fences make safe too.
+ */
+#define VGL_STREAM_FRAMES 3
+#define VGL_MAX_STREAMS 4
+
+typedef struct {
+    unsigned buffer;
+    int stride;                     /* Bytes per element: every write starts on a whole element */
+    long section;                   /* Bytes per frame */
+    char *map;                      /* Persistent mapping, NULL on the fallback */
+    int part;                       /* Section of the current frame */
+    long used, open;                /* Bytes written this frame; start of the write in progress */
+    void *fence[VGL_STREAM_FRAMES];
+} VglStream;
+
+/* Storage for `per_frame` elements of `stride` bytes in `buffer`, left bound to GL_ARRAY_BUFFER: 0 on failure */
+int vgl_stream_init(VglStream *s, unsigned buffer, int stride, int per_frame);
+
+/* Where to write up to `count` elements this frame (GL_ARRAY_BUFFER is bound to the stream): NULL if the section is full */
+void *vgl_stream_begin(VglStream *s, int count);
+
+/* Ends the write with the `count` elements actually written: returns the index of the first in the buffer */
+int vgl_stream_end(VglStream *s, int count);
+
+/* 1 when streams are persistently mapped */
+int vgl_persistent();
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef VIEW_MESH_H
+#define VIEW_MESH_H
+
+/*
+ * Baked Meshes (trek_3dview)
+ * Every model is built once at startup by running its drawing routine
+ * against a recorder that speaks the same vocabulary as the fixed-function
+ * calls the models were written with: matrix stack, colour, lighting on/off,
+ * polygon mode and the GLUT solids and wires. Models become ranges of one
+ * shared vertex/index buffer pair; each frame all instances of a model are
+ * drawn with one glDrawElementsInstanced per draw range, reading a per-
+ * instance transform, tint and animation factors from a streamed buffer.
+ * Lighting reproduces LIGHT0 with the default material in a shader.
+ *
+ * Models are baked at MESH_LODS tessellation levels; mesh_cull() drops
+ * instances whose bounding sphere is outside the view frustum and picks
+ * the level from the sphere's projected radius in pixels. Below LOD 0 the
+ * hull wire overlays go and glows become single-quad halos.
+ */
+
+#define MESH_MAX_MODELS 32
+#define MESH_MAX_RANGES 16          /* Triangle/line runs per model, kept in recording order */
+#define MESH_MAX_INSTANCES 256
+#define MESH_STACK_DEPTH 16
+#define MESH_LODS 3                 /* Full, half and quarter tessellation */
+#define MESH_LOD1_PX 96.0f          /* Projected radius below which a model drops to LOD 1 (no hull wires, halo glows) */
+#define MESH_LOD2_PX 40.0f          /* ... and to LOD 2 */
+
+typedef struct {
+    int model;
+    float m[16];                    /* Column-major model matrix */
+    float tint[4];                  /* Multiplies the baked colour (cloak) */
+    float anim[2];                  /* Glow and scale factors for geometry marked by mesh_animate() */
+    int lod;                        /* Set by mesh_cull(): -1 when outside the frustum */
+} MeshInstance;
+
+/* Column-major 4x4 helpers, post-multiplying like glTranslatef & co. */
+void mat4_identity(float *m);
+void mat4_mul(float *m, const float *r);
+void mat4_translate(float *m, float x, float y, float z);
+void mat4_rotate(float *m, float deg, float x, float y, float z);
+void mat4_scale(float *m, float x, float y, float z);
+void mat4_perspective(float *m, float fovy, float aspect, float znear, float zfar);
+void mat4_ortho(float *m, float left, float right, float bottom, float top, float znear, float zfar);
+
+/* Recording: everything emitted between mesh_begin() and mesh_end() belongs to `model` at `lod` */
+void mesh_begin(int model, int lod);
+void mesh_end();
+int mesh_level();                   /* LOD being recorded, for routines that simplify themselves */
+void mesh_push();
+void mesh_pop();
+void mesh_translate(float x, float y, float z);
+void mesh_rotate(float deg, float x, float y, float z);
+void mesh_scale(float x, float y, float z);
+void mesh_color3(float r, float g, float b);
+void mesh_color4(float r, float g, float b, float a);
+void mesh_lighting(int on);         /* glEnable/glDisable(GL_LIGHTING) */
+void mesh_wireframe(int on);        /* glPolygonMode(GL_FRONT_AND_BACK, GL_LINE/GL_FILL) */
+void mesh_animate(int glow, int scale); /* Following geometry follows anim[0] (colour) / anim[1] (size) */
+void mesh_sphere(float radius, int slices, int stacks);
+void mesh_wire_sphere(float radius, int slices, int stacks);
+void mesh_cube(float size);
+void mesh_wire_cube(float size);
+void mesh_cone(float base, float height, int slices, int stacks);
+void mesh_octahedron();
+void mesh_wire_octahedron();
+void mesh_wire_torus(float inner, float outer, int sides, int rings);
+/* Camera-facing impostor of 5 glow shells: shell i at radius * (1 + 0.2i) with alpha / (1.5i) */
+void mesh_halo(float radius, float r, float g, float b, float alpha);
+
+/* Moves the recorded meshes to the GPU and builds the shader: 0 if the context lacks GL 3.3 (after vgl_init()) */
+int mesh_upload();
+
+/* Bounding sphere radius around the model origin, animations included */
+float mesh_radius(int model);
+
+/* Multiplies the projected radius the LOD choice sees: below 1 models drop detail sooner (quality governor) */
+void mesh_detail(float scale);
+
+/* Frustum test and LOD choice for every instance against vgl_current(): returns the visible count */
+int mesh_cull(MeshInstance *inst, int count);
+
+/* Draws a frame's culled instances in any order; camera and light come from the Frame uniform block */
+void mesh_draw(const MeshInstance *inst, int count);
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef VIEW_OVERLAY_H
+#define VIEW_OVERLAY_H
+
+/*
+ * 2D Overlay (trek_3dview)
+ * Labels, health bars and status text in window pixels, all in one streamed
+ * vertex buffer drawn with a single call after the scene. Text comes from a
+ * glyph atlas built at startup from the Helvetica 10 and 12 bitmaps GLUT
+ * used to draw with, so the overlay looks the same and needs no window
+ * system font. Solid rectangles sample a white texel of the same atlas.
+ * An OvLabel keeps the layout of a string (glyphs and pen positions) and
+ * only lays it out again when the text changes.
+ */
+
+#define OV_MAX_QUADS 16384          /* Glyphs and rectangles per frame */
+#define OV_LABEL_MAX 96             /* Characters of a cached label, terminator included */
+
+enum { OV_FONT_SMALL, OV_FONT_NORMAL, OV_FONTS }; /* GLUT_BITMAP_HELVETICA_10 and _12 */
+
+typedef struct {
+    char text[OV_LABEL_MAX];
+    int font, width, count;
+    short pen[OV_LABEL_MAX];        /* x offset of every glyph from the label origin */
+    unsigned char glyph[OV_LABEL_MAX];
+} OvLabel;
+
+/* Atlas, shader and buffer: 0 if the context lacks GL 3.3 (after vgl_init()) */
+int ov_init();
+
+/* Colour of everything added until the next call, as glColor4f */
+void ov_color(float r, float g, float b, float a);
+
+/* Lays `text` out into `l` unless it already holds it: returns the width in pixels */
+int ov_label(OvLabel *l, int font, const char *text);
+
+/* A laid out label with its baseline starting at window pixel (x, y) */
+void ov_draw_label(const OvLabel *l, float x, float y);
+
+/* One-off text, laid out on every call */
+void ov_text(float x, float y, int font, const char *text);
+
+/* Filled rectangle and 1-pixel outline, window pixels */
+void ov_rect(float x0, float y0, float x1, float y1);
+void ov_frame(float x0, float y0, float x1, float y1);
+
+/* Draws everything added since the last flush, on top of the scene */
+void ov_flush();
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef VIEW_PICK_H
+#define VIEW_PICK_H
+
+/*
+ * Ray Picking (trek_3dview)
+ * A bounding volume hierarchy over the bounding spheres of the objects on
+ * screen answers "which object is under the cursor". Nodes are axis-aligned
+ * boxes kept in depth-first order, built by median split on the longest
+ * axis with up to PICK_LEAF spheres per leaf. While the same ids come back
+ * in the same order only the boxes are refitted, bottom-up; a changed set,
+ * or PICK_REFITS refits in a row, rebuilds the tree so its quality does not
+ * drift as ships move. A query walks the nodes front to back and stops
+ * descending past the nearest hit so far.
+ */
+
+#define PICK_MAX 256                /* Spheres: at least MAX_OBJECTS */
+#define PICK_LEAF 4
+#define PICK_REFITS 64
+
+typedef struct {
+    float c[3], r;                  /* World centre and radius */
+    int id;
+} PickSphere;
+
+/* The spheres as they are now: refits the tree or rebuilds it. Returns 1 on a rebuild */
+int pick_update(const PickSphere *s, int n);
+
+/* Nearest sphere the ray hits ahead of `org` (dir need not be unit): its id, -1 for none; *t gets the distance in units of dir */
+int pick_ray(const float *org, const float *dir, float *t);
+
+#endif
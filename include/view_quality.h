@@ -0,0 +1,59 @@
+#ifndef VIEW_QUALITY_H
+#define VIEW_QUALITY_H
+
+/*
+ * Adaptive Quality (trek_3dview)
+ * The viewer times every frame it renders and steps through a ladder of
+ * quality levels to hold a target frame rate. Each level sets the knobs of the
+ * other modules: mesh LOD bias (tessellation and, through the LODs, the
+ * glow shells), spark and debris density, trail length, how many name
+ * tags the HUD draws and, at the bottom of the ladder, the resolution the
+ * scene is rendered at before it is scaled up under the overlay. A level
+ * goes down after QUAL_DOWN_FRAMES frames over budget and comes back after
+ * QUAL_UP_FRAMES frames with clear headroom, so the view doesn't flicker
+ * between two levels.
+ */
+
+#define QUAL_LEVELS 6
+#define QUAL_DEFAULT_FPS 60.0       /* The GLUT timer's rate; --fps overrides, 0 turns the governor off */
+#define QUAL_DOWN_FRAMES 8          /* Consecutive frames over budget before a step down */
+#define QUAL_UP_FRAMES 120          /* ... and under QUAL_UP_RATIO of it before a step up */
+#define QUAL_UP_RATIO 0.6           /* The level above costs up to ~1.5x: only then does it fit */
+#define QUAL_HOLD_FRAMES 30         /* Frames ignored after a change while the cost settles */
+#define QUAL_QUERIES 4              /* GPU timer queries in flight */
+
+typedef struct {
+    float detail;                   /* mesh_detail() */
+    float particles;                /* fx_density() */
+    int trail;                      /* trail_length() */
+    int labels;                     /* Name tags, nearest to our ship first */
+    float scale;                    /* Scene resolution, fraction of the window */
+} QualKnobs;
+
+/* Target frame rate, 0 to keep full quality; `scaling` 0 keeps the scene at window resolution */
+void qual_target(double fps, int scaling);
+
+int qual_enabled();
+
+/* Level changes go to stderr only when asked (--quality-log): the window's stderr is the captain's prompt */
+void qual_log(int on);
+
+/* Frame timing around display(). GPU time comes from timer queries read a few frames late, so
+   the pipeline never drains; with qual_finish (software GL, found by qual_target, and the bench)
+   the caller finishes the frame itself and the CPU time to glFinish is the cost */
+void qual_frame_begin();
+void qual_frame_end(double cpu_ms);
+void qual_finish(int on);
+int qual_finishes();              /* Governor on and timing to glFinish */
+
+/* Frame cost in ms: may move to another level and set the knobs */
+void qual_frame(double ms);
+
+int qual_level();
+const QualKnobs *qual_knobs();
+
+/* Scene pass at the level's resolution: begin binds a scaled target (no-op at full scale), end scales it up into the window */
+void qual_scene_begin(int width, int height);
+void qual_scene_end(int width, int height);
+
+#endif
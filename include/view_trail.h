@@ -0,0 +1,37 @@
+#ifndef VIEW_TRAIL_H
+#define VIEW_TRAIL_H
+
+/*
+ * Ship Trails (trek_3dview)
+ * Every trail segment of every ship lives in one GPU ring of line
+ * segments, appended in time order: the segments a tick adds are
+ * contiguous, so a frame uploads one span of new vertices and the live
+ * window (the last TRAIL_POINTS ticks) draws with one call, two when it
+ * wraps. Each vertex carries the tick its point was laid; the shader fades
+ * it by age and drops segments that are too old or that belong to a trail
+ * cut since (jump, quadrant change, despawn) through a per-slot cut tick.
+ */
+
+#define TRAIL_POINTS 40             /* Points per trail, one per tick */
+#define TRAIL_SLOTS 256             /* Entity slots: at least MAX_OBJECTS */
+#define TRAIL_RING (TRAIL_SLOTS * TRAIL_POINTS) /* Segments: every slot can hold a full trail */
+
+/* Buffer and shader: 0 if the context lacks GL 3.3 (after vgl_init()) */
+int trail_init();
+
+/* One animation step: segments appended after this belong to the next tick */
+void trail_tick();
+
+/* Segment of `slot`'s trail from its previous point to its new one, laid this tick */
+void trail_append(int slot, const float *from, const float *to, float r, float g, float b);
+
+/* Hides every segment of `slot` laid so far */
+void trail_cut(int slot);
+
+/* Ticks of trail drawn, 2..TRAIL_POINTS: shorter trails fade out sooner (quality governor) */
+void trail_length(int points);
+
+/* Uploads the new segments and draws every live trail */
+void trail_draw();
+
+#endif
@@ -0,0 +1,149 @@
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "profiler.h"
+
+#ifdef TREK_PROFILE
+
+uint64_t prof_counters[PROF_CTR_COUNT];
+
+/* Slot phase_count holds the whole tick */
+static const char *phase_names[PROF_MAX_PHASES + 1];
+static int phase_count = 0;
+
+static pthread_mutex_t prof_mutex = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t cur_phase_ns[PROF_MAX_PHASES];
+static uint64_t hist[PROF_MAX_PHASES + 1][PROF_BUCKETS];
+static uint64_t hist_max[PROF_MAX_PHASES + 1];
+static uint32_t win_ns[PROF_MAX_PHASES + 1][PROF_WINDOW];
+static uint64_t win_ctr[PROF_CTR_COUNT][PROF_WINDOW];
+static uint64_t ctr_total[PROF_CTR_COUNT];
+static long long ticks = 0;
+
+static const char *counter_names[PROF_CTR_COUNT] = {"entities scanned", "bytes sent", "syscalls"};
+
+/* Log-linear bucket: exact below 8 ns, then 8 sub-buckets per power of two */
+static int bucket_of(uint64_t v) {
+    if (v < (1u << PROF_SUB_BITS)) return (int)v;
+    int msb = 63 - __builtin_clzll(v);
+    return ((msb - PROF_SUB_BITS + 1) << PROF_SUB_BITS) | (int)((v >> (msb - PROF_SUB_BITS)) & ((1u << PROF_SUB_BITS) - 1));
+}
+
+static uint64_t bucket_mid(int b) {
+    if (b < (1 << PROF_SUB_BITS)) return b;
+    int msb = (b >> PROF_SUB_BITS) + PROF_SUB_BITS - 1;
+    uint64_t lo = ((uint64_t)((1 << PROF_SUB_BITS) | (b & ((1 << PROF_SUB_BITS) - 1)))) << (msb - PROF_SUB_BITS);
+    return lo + ((1ull << (msb - PROF_SUB_BITS)) >> 1);
+}
+
+void prof_init(const char **names, int count) {
+    if (count > PROF_MAX_PHASES) count = PROF_MAX_PHASES;
+    for (int p = 0; p < count; p++) phase_names[p] = names[p];
+    phase_names[count] = "TICK";
+    phase_count = count;
+}
+
+void prof_phase(int phase, uint64_t ns) {
+    if (phase >= 0 && phase < phase_count) cur_phase_ns[phase] = ns;
+}
+
+static void record(int slot, uint64_t ns, int w) {
+    hist[slot][bucket_of(ns)]++;
+    if (ns > hist_max[slot]) hist_max[slot] = ns;
+    win_ns[slot][w] = (ns > UINT32_MAX) ? UINT32_MAX : (uint32_t)ns;
+}
+
+void prof_end_tick(uint64_t tick_ns) {
+    int w = (int)(ticks % PROF_WINDOW);
+    pthread_mutex_lock(&prof_mutex);
+    for (int p = 0; p < phase_count; p++) record(p, cur_phase_ns[p], w);
+    record(phase_count, tick_ns, w);
+    for (int c = 0; c < PROF_CTR_COUNT; c++) {
+        uint64_t v = __atomic_exchange_n(&prof_counters[c], 0, __ATOMIC_RELAXED);
+        win_ctr[c][w] = v;
+        ctr_total[c] += v;
+    }
+    ticks++;
+    pthread_mutex_unlock(&prof_mutex);
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* p50/p99/max over the samples currently in the window */
+static void window_stats(const uint64_t *samples, int n, uint64_t *p50, uint64_t *p99, uint64_t *max) {
+    uint64_t sorted[PROF_WINDOW];
+    memcpy(sorted, samples, n * sizeof(uint64_t));
+    qsort(sorted, n, sizeof(uint64_t), cmp_u64);
+    *p50 = n ? sorted[(n - 1) * 50 / 100] : 0;
+    *p99 = n ? sorted[(n - 1) * 99 / 100] : 0;
+    *max = n ? sorted[n - 1] : 0;
+}
+
+static uint64_t hist_percentile(const uint64_t *h, long long total, int pct) {
+    long long rank = (total * pct + 99) / 100, seen = 0;
+    for (int b = 0; b < PROF_BUCKETS; b++) {
+        seen += h[b];
+        if (seen >= rank && seen > 0) return bucket_mid(b);
+    }
+    return 0;
+}
+
+void prof_report(char *b, size_t len) {
+    uint64_t samples[PROF_WINDOW], p50, p99, max;
+    size_t o = 0;
+    pthread_mutex_lock(&prof_mutex);
+    int n = (ticks < PROF_WINDOW) ? (int)ticks : PROF_WINDOW;
+    o += snprintf(b + o, len - o, "--- TICK PROFILE: %d-tick window, %lld ticks total ---\n", n, ticks);
+    o += snprintf(b + o, len - o, "%-12s %9s %9s %9s | %9s %9s %9s\n", "PHASE (us)", "p50", "p99", "max", "all p50", "all p99", "all max");
+    for (int p = 0; p <= phase_count && o < len; p++) {
+        for (int i = 0; i < n; i++) samples[i] = win_ns[p][i];
+        window_stats(samples, n, &p50, &p99, &max);
+        o += snprintf(b + o, len - o, "%-12s %9.1f %9.1f %9.1f | %9.1f %9.1f %9.1f\n", phase_names[p], p50 / 1e3, p99 / 1e3, max / 1e3,
+                      hist_percentile(hist[p], ticks, 50) / 1e3, hist_percentile(hist[p], ticks, 99) / 1e3, hist_max[p] / 1e3);
+    }
+    if (o < len) o += snprintf(b + o, len - o, "%-18s %9s %9s %9s %12s\n", "COUNTER (per tick)", "p50", "p99", "max", "total");
+    for (int c = 0; c < PROF_CTR_COUNT && o < len; c++) {
+        for (int i = 0; i < n; i++) samples[i] = win_ctr[c][i];
+        window_stats(samples, n, &p50, &p99, &max);
+        o += snprintf(b + o, len - o, "%-18s %9llu %9llu %9llu %12llu\n", counter_names[c], (unsigned long long)p50,
+                      (unsigned long long)p99, (unsigned long long)max, (unsigned long long)ctr_total[c]);
+    }
+    pthread_mutex_unlock(&prof_mutex);
+}
+
+#else
+
+void prof_report(char *b, size_t len) {
+    snprintf(b, len, "--- TICK PROFILE: disabled at compile time (build with PROFILE=1) ---\n");
+}
+
+#endif
+
+int prof_listen(const char *path) {
+    struct sockaddr_un addr;
+    if (strlen(path) >= sizeof(addr.sun_path)) return -1;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    unlink(path);
+    /* Created 0600: no moment where others could connect (called before any other thread starts) */
+    mode_t old = umask(0177);
+    int bound = bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+    umask(old);
+    if (bound < 0 || chmod(path, 0600) < 0 || listen(fd, 4) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
@@ -0,0 +1,937 @@
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <math.h>
+#include "server_sim.h"
+#include "profiler.h"
+#include "tracer.h"
+#include "session_log.h"
+
+NPCStar stars_data[MAX_STARS];
+NPCBlackHole black_holes[MAX_BH];
+NPCPlanet planets[MAX_PLANETS];
+NPCBase bases[MAX_BASES];
+NPCShip npcs[MAX_NPC];
+ConnectedPlayer players[MAX_CLIENTS];
+StarTrekGame galaxy_master;
+
+Projectile projectiles[MAX_PROJECTILES];
+int projectile_count = 0;
+
+TickScheduler sched;
+long long server_tick = 0;
+const char *phase_names[PHASE_COUNT] = {"navigation", "hazards", "torpedoes", "npc_ai", "packets", "autosave"};
+
+/* Span tracer: a tick over budget dumps the ring, at most once per cooldown */
+#define TRACE_DUMP_COOLDOWN 900   /* 30 s */
+long long trace_last_dump = -TRACE_DUMP_COOLDOWN;
+volatile sig_atomic_t trace_dump_requested = 0;
+
+int sched_pinned = 0;
+int autosave_enabled = 1;
+const char *galaxy_path = "galaxy.dat";
+uint64_t sim_rng_state = 0x9E3779B97F4A7C15ull;
+
+int quad_npc_start[QUAD_CELLS+1], quad_npc_list[MAX_NPC];
+int quad_player_start[QUAD_CELLS+1], quad_player_list[MAX_CLIENTS];
+
+void sim_seed(uint64_t seed) { sim_rng_state = seed ? seed : 0x9E3779B97F4A7C15ull; }
+
+/* xorshift64*, top 31 bits: same range semantics as rand() for the "% n" rolls */
+int sim_rand() {
+    sim_rng_state ^= sim_rng_state >> 12; sim_rng_state ^= sim_rng_state << 25; sim_rng_state ^= sim_rng_state >> 27;
+    return (int)((sim_rng_state * 0x2545F4914F6CDD1Dull) >> 33);
+}
+
+/* The persistent world is raw structs: galaxy.dat and session logs share this layout */
+long world_size() {
+    return sizeof(StarTrekGame) + sizeof(NPCShip)*MAX_NPC + sizeof(NPCStar)*MAX_STARS + sizeof(NPCBlackHole)*MAX_BH +
+           sizeof(NPCPlanet)*MAX_PLANETS + sizeof(NPCBase)*MAX_BASES + sizeof(ConnectedPlayer)*MAX_CLIENTS;
+}
+
+void world_write(FILE *f) {
+    fwrite(&galaxy_master, sizeof(StarTrekGame), 1, f);
+    fwrite(npcs, sizeof(NPCShip), MAX_NPC, f);
+    fwrite(stars_data, sizeof(NPCStar), MAX_STARS, f);
+    fwrite(black_holes, sizeof(NPCBlackHole), MAX_BH, f);
+    fwrite(planets, sizeof(NPCPlanet), MAX_PLANETS, f);
+    fwrite(bases, sizeof(NPCBase), MAX_BASES, f);
+    fwrite(players, sizeof(ConnectedPlayer), MAX_CLIENTS, f);
+}
+
+int world_read(FILE *f) {
+    size_t n = fread(&galaxy_master, sizeof(StarTrekGame), 1, f);
+    n += fread(npcs, sizeof(NPCShip), MAX_NPC, f);
+    n += fread(stars_data, sizeof(NPCStar), MAX_STARS, f);
+    n += fread(black_holes, sizeof(NPCBlackHole), MAX_BH, f);
+    n += fread(planets, sizeof(NPCPlanet), MAX_PLANETS, f);
+    n += fread(bases, sizeof(NPCBase), MAX_BASES, f);
+    n += fread(players, sizeof(ConnectedPlayer), MAX_CLIENTS, f);
+    return n == 1 + MAX_NPC + MAX_STARS + MAX_BH + MAX_PLANETS + MAX_BASES + MAX_CLIENTS;
+}
+
+/* FNV-1a over the simulated fields only: sockets, padding and the per-tick
+ * packet scratch (objects, beams, effects) are left out, so two runs hash
+ * equal exactly when their worlds evolve identically. */
+#define HASH(x) (h = fnv1a(h, &(x), sizeof(x)))
+static uint64_t fnv1a(uint64_t h, const void *p, size_t n) {
+    const unsigned char *b = p;
+    while (n--) { h ^= *b++; h *= 0x100000001B3ull; }
+    return h;
+}
+
+uint64_t sim_state_hash() {
+    uint64_t h = 0xCBF29CE484222325ull;
+    HASH(server_tick); HASH(sim_rng_state); HASH(galaxy_master.k9); HASH(projectile_count);
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        ConnectedPlayer *p = &players[i];
+        HASH(p->active);
+        if (!p->active) continue;
+        StarTrekGame *s = &p->state;
+        HASH(p->nav_state); HASH(p->nav_timer); HASH(p->warp_speed); HASH(p->dx); HASH(p->dy); HASH(p->dz);
+        HASH(s->q1); HASH(s->q2); HASH(s->q3); HASH(s->s1); HASH(s->s2); HASH(s->s3); HASH(s->ent_h); HASH(s->ent_m);
+        HASH(s->energy); HASH(s->torpedoes); HASH(s->crew_count); HASH(s->inventory); HASH(s->shields);
+        HASH(s->system_health); HASH(s->life_support); HASH(s->lock_target); HASH(s->is_cloaked);
+    }
+    for (int n = 0; n < MAX_NPC; n++) {
+        NPCShip *e = &npcs[n];
+        HASH(e->active);
+        if (!e->active) continue;
+        HASH(e->q1); HASH(e->q2); HASH(e->q3); HASH(e->x); HASH(e->y); HASH(e->z); HASH(e->energy);
+        HASH(e->ai_state); HASH(e->target_player_idx); HASH(e->fire_cooldown); HASH(e->nav_timer);
+    }
+    for (int k = 0; k < projectile_count; k++) {
+        Projectile *pr = &projectiles[k];
+        HASH(pr->type); HASH(pr->owner); HASH(pr->gx); HASH(pr->gy); HASH(pr->gz); HASH(pr->ttl);
+    }
+    for (int b = 0; b < MAX_BASES; b++) { HASH(bases[b].active); HASH(bases[b].health); }
+    for (int p = 0; p < MAX_PLANETS; p++) { HASH(planets[p].active); HASH(planets[p].amount); }
+    return h;
+}
+#undef HASH
+
+void save_galaxy() {
+    FILE *f = fopen(galaxy_path, "wb");
+    if (!f) { perror(galaxy_path); return; }
+    world_write(f);
+    fclose(f);
+    printf("--- GALAXY STATE PERSISTED TO DISK ---\n");
+}
+
+int load_galaxy() {
+    FILE *f = fopen(galaxy_path, "rb");
+    if (!f) return 0;
+
+    /* The dump is raw structs: refuse files written with a different layout */
+    fseek(f, 0, SEEK_END);
+    if (ftell(f) != world_size()) {
+        printf("%s layout does not match this build, generating a new galaxy.\n", galaxy_path);
+        fclose(f); return 0;
+    }
+    rewind(f);
+    int ok = world_read(f);
+    fclose(f);
+    if (!ok) return 0;
+    
+    /* Reset transient network data for loaded players */
+    for(int i=0; i<MAX_CLIENTS; i++) {
+        players[i].active = 0;
+        players[i].socket = 0;
+    }
+    
+    printf("--- PERSISTENT GALAXY LOADED SUCCESSFULLY ---\n");
+    return 1;
+}
+
+const char* get_species_name(int s) {
+    switch(s) {
+        case 1: return "Federation"; case 4: return "Star"; case 5: return "Planet"; case 6: return "Black Hole";
+        case 10: return "Klingon"; case 11: return "Romulan"; case 12: return "Borg";
+        case 13: return "Cardassian"; case 14: return "Jem'Hadar"; case 15: return "Tholian";
+        case 16: return "Gorn"; case 17: return "Ferengi"; case 18: return "Species 8472";
+        case 19: return "Breen"; case 20: return "Hirogen";
+        default: return "Unknown";
+    }
+}
+
+void generate_galaxy() {
+    printf("Generating Master Galaxy...\n");
+    memset(&galaxy_master, 0, sizeof(StarTrekGame));
+    int n_count = 0, b_count = 0, p_count = 0, s_count = 0, bh_count = 0;
+    
+    for(int i=1; i<=10; i++)
+        for(int j=1; j<=10; j++)
+            for(int l=1; l<=10; l++) {
+                int r = sim_rand()%100;
+                int kling = (r > 96) ? 3 : (r > 92) ? 2 : (r > 85) ? 1 : 0;
+                int base = (sim_rand()%100 > 98) ? 1 : 0;
+                int planets_cnt = (sim_rand()%100 > 90) ? (sim_rand()%2 + 1) : 0;
+                int star = (sim_rand()%100 < 40) ? (sim_rand()%3 + 1) : 0;
+                int bh = (sim_rand()%100 < 5) ? 1 : 0;
+                
+                int actual_k = 0, actual_b = 0, actual_p = 0, actual_s = 0, actual_bh = 0;
+                
+                for(int e=0; e<kling && n_count < MAX_NPC; e++) {
+                    npcs[n_count] = (NPCShip){n_count, 10+(sim_rand()%11), i,j,l, (sim_rand()%100)/10.0, (sim_rand()%100)/10.0, (sim_rand()%100)/10.0, 0,0, 1000, 1, 60 + sim_rand()%241, AI_STATE_PATROL, -1, 0, 0,0,0}; n_count++; actual_k++;
+                }
+                for(int b=0; b<base && b_count < MAX_BASES; b++) {
+                    bases[b_count] = (NPCBase){b_count, FACTION_FEDERATION, i,j,l, (sim_rand()%100)/10.0, (sim_rand()%100)/10.0, (sim_rand()%100)/10.0, 5000, 1}; b_count++; actual_b++;
+                }
+                for(int p=0; p<planets_cnt && p_count < MAX_PLANETS; p++) {
+                    planets[p_count] = (NPCPlanet){p_count, i,j,l, (sim_rand()%100)/10.0, (sim_rand()%100)/10.0, (sim_rand()%100)/10.0, (sim_rand()%6)+1, 1000, 1}; p_count++; actual_p++;
+                }
+                for(int s=0; s<star && s_count < MAX_STARS; s++) {
+                    stars_data[s_count] = (NPCStar){s_count, 4, i,j,l, (sim_rand()%100)/10.0, (sim_rand()%100)/10.0, (sim_rand()%100)/10.0, 1}; s_count++; actual_s++;
+                }
+                for(int h=0; h<bh && bh_count < MAX_BH; h++) {
+                    black_holes[bh_count] = (NPCBlackHole){bh_count, i,j,l, (sim_rand()%100)/10.0, (sim_rand()%100)/10.0, (sim_rand()%100)/10.0, 1}; bh_count++; actual_bh++;
+                }
+
+                galaxy_master.g[i][j][l] = actual_bh * 10000 + actual_p * 1000 + actual_k * 100 + actual_b * 10 + actual_s;
+                galaxy_master.k9 += actual_k;
+                galaxy_master.b9 += actual_b;
+            }
+    printf("Galaxy generated: %d NPCs, %d Stars, %d Planets, %d Bases, %d Black Holes.\n", n_count, s_count, p_count, b_count, bh_count);
+}
+
+/* Every outbound packet goes through here so the profiler and tracer see bytes and syscalls */
+ssize_t server_send(int p_idx, const void *buf, size_t len) {
+    if (players[p_idx].socket < 0) return len; /* Headless captain */
+    PROF_COUNT(PROF_CTR_SYSCALLS, 1);
+    TRACE_BEGIN(ts);
+    ssize_t r = send(players[p_idx].socket, buf, len, 0);
+    TRACE_END(ts, TRACE_CAT_IO, trace_thread(), "send", p_idx, r);
+    if (r > 0) PROF_COUNT(PROF_CTR_BYTES_SENT, r);
+    return r;
+}
+
+void broadcast_message(PacketMessage *msg) {
+    for (int i = 0; i < MAX_CLIENTS; i++) if (players[i].active) {
+        if (msg->scope == SCOPE_FACTION && players[i].faction != msg->faction) continue;
+        if (msg->scope == SCOPE_PRIVATE) {
+            /* Send to target (ID matches) or sender (echo) */
+            /* msg->target_id is 1-based Player ID. players index is 0-based. */
+            bool is_target = ((i + 1) == msg->target_id);
+            bool is_sender = (strcmp(players[i].name, msg->from) == 0);
+            if (!is_target && !is_sender) continue;
+        }
+        server_send(i, msg, sizeof(PacketMessage));
+    }
+}
+
+void send_server_msg(int p_idx, const char *from, const char *text) {
+    PacketMessage msg = {PKT_MESSAGE, "", 0, 0, 0, ""};
+    strncpy(msg.from, from, 63); strncpy(msg.text, text, 4095);
+    server_send(p_idx, &msg, sizeof(PacketMessage));
+}
+
+void build_quadrant_index() {
+    int cur[QUAD_CELLS];
+    memset(quad_npc_start, 0, sizeof(quad_npc_start));
+    memset(quad_player_start, 0, sizeof(quad_player_start));
+    PROF_COUNT(PROF_CTR_SCANNED, 2 * (MAX_NPC + MAX_CLIENTS));
+    for (int n=0; n<MAX_NPC; n++) if (npcs[n].active) quad_npc_start[QUAD_CELL(npcs[n].q1, npcs[n].q2, npcs[n].q3) + 1]++;
+    for (int p=0; p<MAX_CLIENTS; p++) if (players[p].active) quad_player_start[QUAD_CELL(players[p].state.q1, players[p].state.q2, players[p].state.q3) + 1]++;
+    for (int c=0; c<QUAD_CELLS; c++) { quad_npc_start[c+1] += quad_npc_start[c]; quad_player_start[c+1] += quad_player_start[c]; }
+
+    memcpy(cur, quad_npc_start, sizeof(cur));
+    for (int n=0; n<MAX_NPC; n++) if (npcs[n].active) quad_npc_list[cur[QUAD_CELL(npcs[n].q1, npcs[n].q2, npcs[n].q3)]++] = n;
+    memcpy(cur, quad_player_start, sizeof(cur));
+    for (int p=0; p<MAX_CLIENTS; p++) if (players[p].active) quad_player_list[cur[QUAD_CELL(players[p].state.q1, players[p].state.q2, players[p].state.q3)]++] = p;
+}
+
+/* Live sensor code BPEST for one quadrant: black hole flag, planets, hostiles
+ * (NPCs and captains), bases, stars. Counted from the entity tables, not the
+ * static galaxy_master cube. */
+int quadrant_census(int q1, int q2, int q3) {
+    PROF_COUNT(PROF_CTR_SCANNED, MAX_BH + MAX_PLANETS + MAX_NPC + MAX_BASES + MAX_CLIENTS + MAX_STARS);
+    int bh_cnt = 0; for(int h=0;h<MAX_BH;h++) if(black_holes[h].active && black_holes[h].q1==q1 && black_holes[h].q2==q2 && black_holes[h].q3==q3) bh_cnt++;
+    int p_cnt = 0; for(int p=0;p<MAX_PLANETS;p++) if(planets[p].active && planets[p].q1==q1 && planets[p].q2==q2 && planets[p].q3==q3) p_cnt++;
+    int e_cnt = 0; for(int n=0;n<MAX_NPC;n++) if(npcs[n].active && npcs[n].q1==q1 && npcs[n].q2==q2 && npcs[n].q3==q3) e_cnt++;
+    int b_cnt = 0; for(int b=0;b<MAX_BASES;b++) if(bases[b].active && bases[b].q1==q1 && bases[b].q2==q2 && bases[b].q3==q3) b_cnt++;
+    int u_cnt = 0; for(int u=0;u<MAX_CLIENTS;u++) if(players[u].active && players[u].state.q1==q1 && players[u].state.q2==q2 && players[u].state.q3==q3) u_cnt++;
+    int s_cnt = 0; for(int st=0;st<MAX_STARS;st++) if(stars_data[st].active && stars_data[st].q1==q1 && stars_data[st].q2==q2 && stars_data[st].q3==q3) s_cnt++;
+    return (bh_cnt > 0 ? 1 : 0)*10000 + p_cnt*1000 + (e_cnt + u_cnt)*100 + b_cnt*10 + s_cnt;
+}
+
+/* Holes are inactive slots below a table's high-water mark; the galaxy map
+ * (galaxy_master.g, sent at login) is compared with one counting pass per table. */
+void world_audit(WorldAudit *a) {
+    static int live[QUAD_CELLS][5];
+    memset(a, 0, sizeof(*a)); memset(live, 0, sizeof(live));
+#define AUDIT(t, tab, n, digit) for (int e = 0; e < (n); e++) if ((tab)[e].active) { \
+        a->active[t]++; a->high[t] = e + 1; live[QUAD_CELL((tab)[e].q1, (tab)[e].q2, (tab)[e].q3)][digit]++; }
+    AUDIT(0, npcs, MAX_NPC, 2);
+    AUDIT(1, planets, MAX_PLANETS, 3);
+    AUDIT(2, bases, MAX_BASES, 1);
+    AUDIT(3, stars_data, MAX_STARS, 0);
+    AUDIT(4, black_holes, MAX_BH, 4);
+#undef AUDIT
+    for (int c = 0; c < QUAD_CELLS; c++) {
+        int g = galaxy_master.g[c / 100 + 1][(c / 10) % 10 + 1][c % 10 + 1];
+        int now = (live[c][4] > 0 ? 1 : 0) * 10000 + live[c][3] * 1000 + live[c][2] * 100 + live[c][1] * 10 + live[c][0];
+        if (g != now) a->census_stale++;
+        a->census_enemies_off += abs((g / 100) % 10 - live[c][2]);
+    }
+    a->k9_off = galaxy_master.k9 - a->active[0];
+}
+
+Projectile *launch_projectile(ProjectileType type, int owner, double dx, double dy, double dz, double speed, int ttl) {
+    if (projectile_count >= MAX_PROJECTILES) return NULL;
+    Projectile *pr = &projectiles[projectile_count++];
+    memset(pr, 0, sizeof(Projectile));
+    pr->type = type; pr->owner = owner;
+    pr->gx = (players[owner].state.q1-1)*10.0 + players[owner].state.s1;
+    pr->gy = (players[owner].state.q2-1)*10.0 + players[owner].state.s2;
+    pr->gz = (players[owner].state.q3-1)*10.0 + players[owner].state.s3;
+    pr->dx = dx; pr->dy = dy; pr->dz = dz;
+    pr->speed = speed; pr->ttl = ttl;
+    return pr;
+}
+
+/* A captain's slot changes hands: torpedoes and probes still in flight go
+ * with the old captain, so they cannot hit, report or credit the next one */
+void expire_projectiles(int owner) {
+    for (int p = 0; p < projectile_count; )
+        if (projectiles[p].owner == owner) projectiles[p] = projectiles[--projectile_count];
+        else p++;
+}
+
+/* Swept-sphere test: earliest t in [0,1] at which the segment p + t*v enters
+ * the sphere (c, r), or -1 when it misses. Fast projectiles cannot tunnel. */
+double sweep_sphere(double px, double py, double pz, double vx, double vy, double vz, double cx, double cy, double cz, double r) {
+    double mx = px - cx, my = py - cy, mz = pz - cz;
+    double c = mx*mx + my*my + mz*mz - r*r;
+    if (c <= 0) return 0.0;
+    double a = vx*vx + vy*vy + vz*vz;
+    double b = mx*vx + my*vy + mz*vz;
+    if (a <= 0 || b >= 0) return -1.0;
+    double disc = b*b - a*c;
+    if (disc < 0) return -1.0;
+    double t = (-b - sqrt(disc)) / a;
+    return (t <= 1.0) ? t : -1.0;
+}
+
+void torpedo_hit_player(int owner, int k) {
+    /* Danno agli scudi e travaso su energia/sistemi */
+    int dmg = 500 + sim_rand()%500;
+    for(int s=0; s<6; s++) {
+        players[k].state.shields[s] -= dmg/6;
+        if (players[k].state.shields[s] < 0) {
+            players[k].state.energy += players[k].state.shields[s]; /* Sottrae il residuo */
+            players[k].state.shields[s] = 0;
+            if (sim_rand()%100 > 70) {
+                int sys = sim_rand()%8; players[k].state.system_health[sys] -= 10.0 + (sim_rand()%20);
+                if (players[k].state.system_health[sys] < 0) players[k].state.system_health[sys] = 0;
+                send_server_msg(k, "DAMAGE CONTROL", "Direct hit! System damage reported.");
+            }
+        }
+    }
+    if (players[owner].active) send_server_msg(owner, "TACTICAL", "Impact confirmed on player vessel.");
+    send_server_msg(k, "BRIDGE", "Hull breach! Torpedo impact.");
+}
+
+void torpedo_hit_npc(int owner, int n) {
+    players[owner].state.boom = (NetPoint){(float)npcs[n].x, (float)npcs[n].y, (float)npcs[n].z, 1};
+    npcs[n].energy -= 800;
+    if (npcs[n].energy <= 0) {
+        npcs[n].active = 0;
+        char kill_msg[128]; sprintf(kill_msg, "%s vessel destroyed at [%.1f, %.1f, %.1f].", get_species_name(npcs[n].faction), npcs[n].x, npcs[n].y, npcs[n].z);
+        if (players[owner].active) send_server_msg(owner, "TACTICAL", kill_msg);
+        /* Notifica perdita lock globale */
+        int npc_tid = ID_NPC + n;
+        for(int p_idx=0; p_idx<MAX_CLIENTS; p_idx++) {
+            if(players[p_idx].active && players[p_idx].state.lock_target == npc_tid) {
+                players[p_idx].state.lock_target = 0;
+                send_server_msg(p_idx, "TACTICAL", "Target destroyed. Lock released.");
+            }
+        }
+    } else if (players[owner].active) send_server_msg(owner, "TACTICAL", "Target hit.");
+}
+
+void probe_report(Projectile *pr) {
+    if (!players[pr->owner].active) return;
+    char b[512]; int val = galaxy_master.g[pr->target_q1][pr->target_q2][pr->target_q3];
+    sprintf(b, "Probe Report Q[%d,%d,%d]: %05d (B:%d P:%d E:%d S:%d T:%d)", pr->target_q1, pr->target_q2, pr->target_q3, val, (val/10000)%10, (val/1000)%10, (val/100)%10, (val/10)%10, val%10);
+    send_server_msg(pr->owner, "SCIENCE", b);
+}
+
+/* Batched projectile pass: one sweep per projectile against the candidates of
+ * every quadrant its path touches, using the per-tick quadrant index. */
+void update_projectiles() {
+    for (int p = 0; p < projectile_count; ) {
+        Projectile *pr = &projectiles[p];
+        double vx = pr->dx * pr->speed, vy = pr->dy * pr->speed, vz = pr->dz * pr->speed;
+        bool expired = false;
+
+        if (pr->type == PROJ_TORPEDO) {
+            int lo[3], hi[3];
+            double a[3] = {pr->gx, pr->gy, pr->gz}, b[3] = {pr->gx+vx, pr->gy+vy, pr->gz+vz};
+            for (int ax=0; ax<3; ax++) {
+                double mn = fmin(a[ax], b[ax]) - TORP_RADIUS_NPC, mx = fmax(a[ax], b[ax]) + TORP_RADIUS_NPC;
+                lo[ax] = (int)floor(mn / 10.0) + 1; hi[ax] = (int)floor(mx / 10.0) + 1;
+                if (lo[ax] < 1) lo[ax] = 1;
+                if (hi[ax] > 10) hi[ax] = 10;
+            }
+            int hit_player = -1, hit_npc = -1; double best_t = 2.0;
+            for (int q1=lo[0]; q1<=hi[0]; q1++) for (int q2=lo[1]; q2<=hi[1]; q2++) for (int q3=lo[2]; q3<=hi[2]; q3++) {
+                int c = QUAD_CELL(q1, q2, q3);
+                PROF_COUNT(PROF_CTR_SCANNED, quad_player_start[c+1] - quad_player_start[c] + quad_npc_start[c+1] - quad_npc_start[c]);
+                for (int e=quad_player_start[c]; e<quad_player_start[c+1]; e++) {
+                    int k = quad_player_list[e];
+                    if (k == pr->owner || !players[k].active) continue;
+                    double t = sweep_sphere(pr->gx, pr->gy, pr->gz, vx, vy, vz, (q1-1)*10.0+players[k].state.s1, (q2-1)*10.0+players[k].state.s2, (q3-1)*10.0+players[k].state.s3, TORP_RADIUS_PLAYER);
+                    if (t >= 0 && t < best_t) { best_t = t; hit_player = k; hit_npc = -1; }
+                }
+                for (int e=quad_npc_start[c]; e<quad_npc_start[c+1]; e++) {
+                    int n = quad_npc_list[e];
+                    if (!npcs[n].active) continue;
+                    double t = sweep_sphere(pr->gx, pr->gy, pr->gz, vx, vy, vz, (q1-1)*10.0+npcs[n].x, (q2-1)*10.0+npcs[n].y, (q3-1)*10.0+npcs[n].z, TORP_RADIUS_NPC);
+                    if (t >= 0 && t < best_t) { best_t = t; hit_npc = n; hit_player = -1; }
+                }
+            }
+            if (hit_player != -1) { torpedo_hit_player(pr->owner, hit_player); expired = true; }
+            else if (hit_npc != -1) { torpedo_hit_npc(pr->owner, hit_npc); expired = true; }
+        }
+
+        if (!expired) {
+            pr->gx += vx; pr->gy += vy; pr->gz += vz;
+            pr->ttl--;
+            if (pr->type == PROJ_PROBE && pr->ttl <= 0) { probe_report(pr); expired = true; }
+            else if (pr->ttl <= 0) expired = true;
+            else if (pr->gx < 0 || pr->gx >= 100.0 || pr->gy < 0 || pr->gy >= 100.0 || pr->gz < 0 || pr->gz >= 100.0) {
+                if (pr->type == PROJ_PROBE && players[pr->owner].active) send_server_msg(pr->owner, "SCIENCE", "Probe lost at the Galactic Barrier.");
+                expired = true;
+            }
+        }
+
+        /* Swap-remove keeps the pool dense */
+        if (expired) projectiles[p] = projectiles[--projectile_count];
+        else p++;
+    }
+}
+
+/* Torpedo shown in the Tactical View: own torpedoes first, then any other in the quadrant */
+NetPoint quadrant_torpedo(int i) {
+    NetPoint np = {0, 0, 0, 0};
+    for (int p=0; p<projectile_count; p++) {
+        Projectile *pr = &projectiles[p];
+        if (pr->type != PROJ_TORPEDO) continue;
+        int q1 = (int)(pr->gx / 10.0) + 1, q2 = (int)(pr->gy / 10.0) + 1, q3 = (int)(pr->gz / 10.0) + 1;
+        if (q1 != players[i].state.q1 || q2 != players[i].state.q2 || q3 != players[i].state.q3) continue;
+        np = (NetPoint){(float)fmod(pr->gx, 10.0), (float)fmod(pr->gy, 10.0), (float)fmod(pr->gz, 10.0), 1};
+        if (pr->owner == i) break;
+    }
+    return np;
+}
+
+void phase_navigation() {
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        if (!players[i].active) continue;
+        PROF_COUNT(PROF_CTR_SCANNED, 1);
+
+        /* Unified Navigation State Machine */
+        if (players[i].nav_state == NAV_STATE_ALIGN) {
+            players[i].nav_timer--;
+            /* Interpolazione rotazione (2 secondi = 60 frame a 30 FPS) */
+            double t = 1.0 - (double)players[i].nav_timer / 60.0;
+            players[i].state.ent_h = players[i].start_h + (players[i].target_h - players[i].start_h) * t;
+            players[i].state.ent_m = players[i].start_m + (players[i].target_m - players[i].start_m) * t;
+            
+            if (players[i].nav_timer <= 0) {
+                players[i].nav_state = NAV_STATE_WARP;
+                /* Il timer del warp dipende dalla distanza (3s per quadrante = 90 frame per 10 unità) */
+                double dist = sqrt(pow(players[i].target_gx - ((players[i].state.q1-1)*10+players[i].state.s1), 2) + 
+                                   pow(players[i].target_gy - ((players[i].state.q2-1)*10+players[i].state.s2), 2) + 
+                                   pow(players[i].target_gz - ((players[i].state.q3-1)*10+players[i].state.s3), 2));
+                players[i].nav_timer = (int)(dist / 10.0 * 90.0);
+                if (players[i].nav_timer < 30) players[i].nav_timer = 30; /* Minimo 1 secondo */
+                players[i].warp_speed = dist / players[i].nav_timer;
+                send_server_msg(i, "HELMSMAN", "Entering Warp drive.");
+            }
+        } 
+        else if (players[i].nav_state == NAV_STATE_WARP) {
+            players[i].nav_timer--;
+            double cur_gx = (players[i].state.q1 - 1) * 10.0 + players[i].state.s1;
+            double cur_gy = (players[i].state.q2 - 1) * 10.0 + players[i].state.s2;
+            double cur_gz = (players[i].state.q3 - 1) * 10.0 + players[i].state.s3;
+
+            /* Warp Safety Interlock: Proactive collision detection */
+            bool emergency_stop = false;
+            
+            /* Check for Black Holes in current quadrant */
+            PROF_COUNT(PROF_CTR_SCANNED, MAX_BH + MAX_STARS);
+            for(int h=0; h<MAX_BH; h++) if(black_holes[h].active && black_holes[h].q1==players[i].state.q1 && black_holes[h].q2==players[i].state.q2 && black_holes[h].q3==players[i].state.q3) {
+                double dx = black_holes[h].x - players[i].state.s1;
+                double dy = black_holes[h].y - players[i].state.s2;
+                double dz = black_holes[h].z - players[i].state.s3;
+                if((dx*dx + dy*dy + dz*dz) < 2.25) { /* 1.5 units safety margin */
+                    /* Check if moving AWAY: dot product < 0 */
+                    double dot = dx * players[i].dx + dy * players[i].dy + dz * players[i].dz;
+                    if (dot > 0) { /* Moving towards or perpendicular */
+                        send_server_msg(i, "COMPUTER", "EMERGENCY: Gravitational shear detected. Dropping out of Warp.");
+                        emergency_stop = true; break;
+                    }
+                }
+            }
+            /* Check for Stars in current quadrant */
+            if (!emergency_stop) {
+                for(int s=0; s<MAX_STARS; s++) if(stars_data[s].active && stars_data[s].q1==players[i].state.q1 && stars_data[s].q2==players[i].state.q2 && stars_data[s].q3==players[i].state.q3) {
+                    double dx = stars_data[s].x - players[i].state.s1;
+                    double dy = stars_data[s].y - players[i].state.s2;
+                    double dz = stars_data[s].z - players[i].state.s3;
+                    if((dx*dx + dy*dy + dz*dz) < 1.44) { /* 1.2 units safety margin */
+                        /* Check if moving AWAY */
+                        double dot = dx * players[i].dx + dy * players[i].dy + dz * players[i].dz;
+                        if (dot > 0) {
+                            send_server_msg(i, "COMPUTER", "EMERGENCY: Solar proximity warning. Warp drive disengaged.");
+                            emergency_stop = true; break;
+                        }
+                    }
+                }
+            }
+
+            if (emergency_stop) {
+                players[i].nav_state = NAV_STATE_REALIGN;
+                players[i].nav_timer = 30; /* Faster recovery (1s) */
+                players[i].start_h = players[i].state.ent_h;
+                players[i].start_m = players[i].state.ent_m;
+            } else {
+                cur_gx += players[i].dx * players[i].warp_speed;
+                cur_gy += players[i].dy * players[i].warp_speed;
+                cur_gz += players[i].dz * players[i].warp_speed;
+
+                /* Galaxy Boundary Check */
+                bool barrier_hit = false;
+                if (cur_gx < 0) { cur_gx = 0.1; barrier_hit = true; } else if (cur_gx >= 100.0) { cur_gx = 99.9; barrier_hit = true; }
+                if (cur_gy < 0) { cur_gy = 0.1; barrier_hit = true; } else if (cur_gy >= 100.0) { cur_gy = 99.9; barrier_hit = true; }
+                if (cur_gz < 0) { cur_gz = 0.1; barrier_hit = true; } else if (cur_gz >= 100.0) { cur_gz = 99.9; barrier_hit = true; }
+
+                if (barrier_hit) {
+                    send_server_msg(i, "HELMSMAN", "Galactic Barrier reached. Disengaging Warp.");
+                    players[i].nav_state = NAV_STATE_REALIGN;
+                    players[i].nav_timer = 30;
+                }
+
+                players[i].state.q1 = (int)(cur_gx / 10.0) + 1;
+                players[i].state.q2 = (int)(cur_gy / 10.0) + 1;
+                players[i].state.q3 = (int)(cur_gz / 10.0) + 1;
+                players[i].state.s1 = fmod(cur_gx, 10.0);
+                players[i].state.s2 = fmod(cur_gy, 10.0);
+                players[i].state.s3 = fmod(cur_gz, 10.0);
+
+                if (!barrier_hit && players[i].nav_timer <= 0) {
+                    players[i].nav_state = NAV_STATE_REALIGN;
+                    players[i].nav_timer = 60; /* 2 secondi per tornare a mark 0 */
+                    players[i].start_h = players[i].state.ent_h;
+                    players[i].start_m = players[i].state.ent_m;
+                    send_server_msg(i, "HELMSMAN", "Exiting Warp. Realigning ship.");
+                }
+            }
+        }
+        else if (players[i].nav_state == NAV_STATE_REALIGN) {
+            players[i].nav_timer--;
+            double t = 1.0 - (double)players[i].nav_timer / 60.0;
+            /* Torniamo a Mark 0, Heading rimane invariato */
+            players[i].state.ent_m = players[i].start_m * (1.0 - t);
+            
+                if (players[i].nav_timer <= 0) {
+                    players[i].state.ent_m = 0;
+                    players[i].nav_state = NAV_STATE_IDLE;
+                    send_server_msg(i, "HELMSMAN", "Stabilized at sub-light speed.");
+                }
+        }
+        else if (players[i].nav_state == NAV_STATE_IMPULSE) {
+            /* Impulse Engine Logic */
+            if (players[i].state.energy > 0) {
+                players[i].state.energy -= 1; /* Low consumption */
+                
+                double dx = players[i].dx * players[i].warp_speed; /* Reusing warp_speed var for impulse speed */
+                double dy = players[i].dy * players[i].warp_speed;
+                double dz = players[i].dz * players[i].warp_speed;
+                
+                /* Predict position */
+                double next_s1 = players[i].state.s1 + dx;
+                double next_s2 = players[i].state.s2 + dy;
+                double next_s3 = players[i].state.s3 + dz;
+                
+                /* Boundary Check - Wrap or Stop? Sector 0-10 */
+                /* Save previous state to revert if we hit the wall */
+                int old_q1 = players[i].state.q1, old_q2 = players[i].state.q2, old_q3 = players[i].state.q3;
+                double old_s1 = players[i].state.s1, old_s2 = players[i].state.s2, old_s3 = players[i].state.s3;
+
+                /* If leaving sector, update quadrant */
+                if (next_s1 >= 10.0) { players[i].state.q1++; next_s1 -= 10.0; }
+                else if (next_s1 < 0.0) { players[i].state.q1--; next_s1 += 10.0; }
+                if (next_s2 >= 10.0) { players[i].state.q2++; next_s2 -= 10.0; }
+                else if (next_s2 < 0.0) { players[i].state.q2--; next_s2 += 10.0; }
+                if (next_s3 >= 10.0) { players[i].state.q3++; next_s3 -= 10.0; }
+                else if (next_s3 < 0.0) { players[i].state.q3--; next_s3 += 10.0; }
+                
+                /* Galaxy Limits Check */
+                if (players[i].state.q1 < 1 || players[i].state.q1 > 10 || 
+                    players[i].state.q2 < 1 || players[i].state.q2 > 10 || 
+                    players[i].state.q3 < 1 || players[i].state.q3 > 10) {
+                    
+                    /* Hit the wall - Revert position */
+                    players[i].state.q1 = old_q1; players[i].state.q2 = old_q2; players[i].state.q3 = old_q3;
+                    players[i].state.s1 = old_s1; players[i].state.s2 = old_s2; players[i].state.s3 = old_s3;
+                    
+                    send_server_msg(i, "HELMSMAN", "Galactic Barrier reached. Course corrected.");
+                    players[i].nav_state = NAV_STATE_IDLE;
+                } else {
+                    /* Collision Check (Basic) */
+                    bool collision = false;
+                    for(int s=0; s<MAX_STARS; s++) if(stars_data[s].active && stars_data[s].q1==players[i].state.q1 && stars_data[s].q2==players[i].state.q2 && stars_data[s].q3==players[i].state.q3) {
+                        double d = sqrt(pow(stars_data[s].x-next_s1,2)+pow(stars_data[s].y-next_s2,2)+pow(stars_data[s].z-next_s3,2));
+                        if (d < 0.8) { collision = true; send_server_msg(i, "HELMSMAN", "Collision alert! All stop."); break; }
+                    }
+                    if (!collision) {
+                        players[i].state.s1 = next_s1;
+                        players[i].state.s2 = next_s2;
+                        players[i].state.s3 = next_s3;
+                    } else {
+                        players[i].nav_state = NAV_STATE_IDLE;
+                    }
+                }
+            } else {
+                send_server_msg(i, "ENGINEERING", "Impulse engines offline. Energy depleted.");
+                players[i].nav_state = NAV_STATE_IDLE;
+            }
+        }
+    }
+}
+
+void phase_hazards() {
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        if (!players[i].active) continue;
+
+        /* Collisioni e stress ambientali */
+        PROF_COUNT(PROF_CTR_SCANNED, MAX_STARS + MAX_BH);
+        for(int s=0; s<MAX_STARS; s++) if(stars_data[s].active && stars_data[s].q1==players[i].state.q1 && stars_data[s].q2==players[i].state.q2 && stars_data[s].q3==players[i].state.q3) {
+            double d=sqrt(pow(stars_data[s].x-players[i].state.s1,2)+pow(stars_data[s].y-players[i].state.s2,2)+pow(stars_data[s].z-players[i].state.s3,2));
+            if(d < 0.8) {
+                send_server_msg(i, "COMPUTER", "CRITICAL: Solar collision detected!");
+                for(int sh=0; sh<6; sh++) players[i].state.shields[sh] = 0;
+                players[i].state.energy -= 1000;
+            }
+        }
+        for(int h=0; h<MAX_BH; h++) if(black_holes[h].active && black_holes[h].q1==players[i].state.q1 && black_holes[h].q2==players[i].state.q2 && black_holes[h].q3==players[i].state.q3) {
+            double d=sqrt(pow(black_holes[h].x-players[i].state.s1,2)+pow(black_holes[h].y-players[i].state.s2,2)+pow(black_holes[h].z-players[i].state.s3,2));
+            if(d < 1.0) {
+                send_server_msg(i, "COMPUTER", "EVENT HORIZON CROSSED. Structural integrity failing.");
+                players[i].active = 0; /* Morte istantanea */
+            }
+        }
+
+        if (server_tick % 60 == 0) {
+            /* Effetti Power Distribution: 0:Engines, 1:Shields, 2:Weapons */
+            float p_shields = players[i].state.power_dist[1];
+
+            if (players[i].state.is_cloaked) {
+                players[i].state.energy -= 50; if (players[i].state.energy <= 0) { players[i].state.energy = 0; players[i].state.is_cloaked = false; }
+            } else if (players[i].state.energy < 3000) {
+                players[i].state.energy += 10;
+            }
+
+            /* Rigenerazione scudi basata su power allocation */
+            for(int s=0; s<6; s++) {
+                if (players[i].state.shields[s] < 1000 && players[i].state.energy > 20) {
+                    int reg = (int)(15 * p_shields);
+                    players[i].state.shields[s] += reg;
+                    players[i].state.energy -= reg/2;
+                }
+            }
+
+            for(int s=0; s<8; s++) if(players[i].state.system_health[s]<100) players[i].state.system_health[s]+=0.1;
+        }
+    }
+
+    /* Controllo vittoria globale (una volta ogni 60 tick) */
+    if (server_tick % 60 == 0) {
+        int current_k9 = 0;
+        for(int n=0; n<MAX_NPC; n++) if(npcs[n].active) current_k9++;
+        PROF_COUNT(PROF_CTR_SCANNED, MAX_NPC);
+        galaxy_master.k9 = current_k9;
+        
+        if (galaxy_master.k9 == 0) {
+            PacketMessage win_msg = {PKT_MESSAGE, "STARFLEET", 0, 0, 0, "\033[1;32mMISSION COMPLETE: All hostile entities neutralized. The galaxy is safe.\033[0m"};
+            broadcast_message(&win_msg);
+        }
+    }
+}
+
+void phase_projectiles() {
+    build_quadrant_index();
+    update_projectiles();
+}
+
+/* NPC AI: State Machine & Independent Fire. Each NPC runs once per tick, and
+ * only quadrants with at least one captain are simulated. */
+void phase_npc_ai() {
+    for (int c=0; c<QUAD_CELLS; c++) if (quad_player_start[c+1] > quad_player_start[c]) {
+        for (int e=quad_npc_start[c]; e<quad_npc_start[c+1]; e++) {
+            int n = quad_npc_list[e];
+            if (!npcs[n].active) continue;
+            PROF_COUNT(PROF_CTR_SCANNED, 1 + quad_player_start[c+1] - quad_player_start[c]);
+
+            /* Under load a patrolling NPC naps: it is stepped every NPC_NAP_STRIDE ticks with a scaled time step */
+            int dt = 1;
+            if (sched.level >= 2 && npcs[n].ai_state == AI_STATE_PATROL) {
+                if ((server_tick + n) % NPC_NAP_STRIDE != 0) { sched.npc_naps++; continue; }
+                dt = NPC_NAP_STRIDE;
+            }
+
+            /* 1. Sensing & State Transitions */
+            int closest_player = -1;
+            double min_dist2 = 100.0; /* 10 units sensor range */
+            
+            for(int pe=quad_player_start[c]; pe<quad_player_start[c+1]; pe++) if(players[quad_player_list[pe]].active && !players[quad_player_list[pe]].state.is_cloaked) {
+                int p = quad_player_list[pe];
+                double d2 = pow(npcs[n].x - players[p].state.s1, 2) + pow(npcs[n].y - players[p].state.s2, 2) + pow(npcs[n].z - players[p].state.s3, 2);
+                if (d2 < min_dist2) { min_dist2 = d2; closest_player = p; }
+            }
+            
+            if (npcs[n].energy < 200) npcs[n].ai_state = AI_STATE_FLEE;
+            else if (closest_player != -1) { npcs[n].ai_state = AI_STATE_CHASE; npcs[n].target_player_idx = closest_player; }
+            else npcs[n].ai_state = AI_STATE_PATROL;
+            
+            /* 2. State-Specific Logic (Movement) */
+            if (npcs[n].ai_state == AI_STATE_PATROL) {
+                if (npcs[n].nav_timer <= 0) {
+                    npcs[n].nav_timer = 100 + sim_rand()%200;
+                    npcs[n].dx = ((sim_rand()%100)-50)/1000.0; /* Slow drift */
+                    npcs[n].dy = ((sim_rand()%100)-50)/1000.0;
+                    npcs[n].dz = ((sim_rand()%100)-50)/1000.0;
+                }
+            } 
+            else if (npcs[n].ai_state == AI_STATE_CHASE && npcs[n].target_player_idx != -1) {
+                int p = npcs[n].target_player_idx;
+                double tx = players[p].state.s1, ty = players[p].state.s2, tz = players[p].state.s3;
+                double dxx = tx - npcs[n].x, dyy = ty - npcs[n].y, dzz = tz - npcs[n].z;
+                double d = sqrt(dxx*dxx + dyy*dyy + dzz*dzz);
+                if (d > 1.5) { /* Mantieni una minima distanza tattica */
+                    npcs[n].dx = (dxx/d) * 0.03; 
+                    npcs[n].dy = (dyy/d) * 0.03;
+                    npcs[n].dz = (dzz/d) * 0.03;
+                } else { npcs[n].dx = npcs[n].dy = npcs[n].dz = 0; }
+            }
+            else if (npcs[n].ai_state == AI_STATE_FLEE && closest_player != -1) {
+                int p = closest_player;
+                double tx = players[p].state.s1, ty = players[p].state.s2, tz = players[p].state.s3;
+                double dxx = npcs[n].x - tx, dyy = npcs[n].y - ty, dzz = npcs[n].z - tz; /* Move AWAY */
+                double d = sqrt(dxx*dxx + dyy*dyy + dzz*dzz);
+                if (d > 0.1) {
+                    npcs[n].dx = (dxx/d) * 0.05; 
+                    npcs[n].dy = (dyy/d) * 0.05;
+                    npcs[n].dz = (dzz/d) * 0.05;
+                }
+            }
+            
+            /* Apply Movement & Sector Limit Check */
+            npcs[n].x += npcs[n].dx * dt; npcs[n].y += npcs[n].dy * dt; npcs[n].z += npcs[n].dz * dt;
+            npcs[n].nav_timer -= dt;
+            if (npcs[n].x < 0.5 || npcs[n].x > 9.5) npcs[n].dx *= -1;
+            if (npcs[n].y < 0.5 || npcs[n].y > 9.5) npcs[n].dy *= -1;
+            if (npcs[n].z < 0.5 || npcs[n].z > 9.5) npcs[n].dz *= -1;
+
+            /* 3. Fire Logic */
+            if (npcs[n].fire_cooldown > 0) npcs[n].fire_cooldown -= dt;
+            
+            /* The nearest visible captain is the one in the line of fire */
+            if (npcs[n].fire_cooldown <= 0 && closest_player != -1) {
+                int i = closest_player;
+                double dx_fire = npcs[n].x-players[i].state.s1;
+                double dy_fire = npcs[n].y-players[i].state.s2;
+                double dz_fire = npcs[n].z-players[i].state.s3;
+                double d2_fire = dx_fire*dx_fire + dy_fire*dy_fire + dz_fire*dz_fire;
+                if (d2_fire < 36.0 && !players[i].state.is_cloaked) { 
+                    /* Il nemico spara! */
+                    players[i].state.beam_count = 1;
+                    players[i].state.beams[0] = (NetBeam){(float)npcs[n].x, (float)npcs[n].y, (float)npcs[n].z, 1};
+                    int dmg = (int)(200.0 / sqrt(d2_fire));
+                    
+                    int damage_remaining = dmg;
+                    for(int s=0; s<6; s++) {
+                        if (damage_remaining <= 0) break;
+                        int absorbed = (players[i].state.shields[s] >= damage_remaining/6) ? damage_remaining/6 : players[i].state.shields[s];
+                        players[i].state.shields[s] -= absorbed;
+                        if (players[i].state.shields[s] < 0) players[i].state.shields[s] = 0; 
+                        damage_remaining -= absorbed;
+                    }
+                    
+                    if (damage_remaining > 0) {
+                        players[i].state.energy -= damage_remaining;
+                        send_server_msg(i, "DAMAGE CONTROL", "Shields failing! Taking hull damage.");
+                        if (players[i].state.energy <= 0) {
+                            players[i].state.energy = 0; players[i].active = 0;
+                            players[i].state.boom = (NetPoint){(float)players[i].state.s1, (float)players[i].state.s2, (float)players[i].state.s3, 1};
+                            send_server_msg(i, "COMPUTER", "CRITICAL FAILURE. Ship destroyed.");
+                        }
+                    } else { send_server_msg(i, "WARNING", "Incoming phaser fire! Shields holding."); }
+                    npcs[n].fire_cooldown = 60 + sim_rand()%241;
+                }
+            }
+        }
+    }
+}
+
+void phase_updates() {
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        if (!players[i].active) continue;
+
+        /* First shedding level: idle captains receive updates at a reduced rate */
+        if (sched.level >= 1 && players[i].nav_state == NAV_STATE_IDLE && server_tick - players[i].last_cmd_tick > IDLE_TICKS &&
+            (server_tick + i) % IDLE_UPDATE_STRIDE != 0) { sched.updates_shed++; continue; }
+
+        PacketUpdate upd;
+        build_update(i, &upd);
+
+        /* Last shedding level: one-shot visual effects are dropped */
+        if (sched.level >= 3 && (upd.beam_count > 0 || upd.boom.active || upd.dismantle.active)) {
+            upd.beam_count = 0; upd.boom.active = 0; upd.dismantle.active = 0;
+            sched.events_shed++;
+        }
+
+        server_send(i, &upd, sizeof(PacketUpdate));
+        
+        /* Reset One-Shot Events after sending */
+        if (players[i].state.beam_count > 0) players[i].state.beam_count = 0;
+        if (players[i].state.boom.active) players[i].state.boom.active = 0;
+        if (players[i].state.dismantle.active) players[i].state.dismantle.active = 0;
+    }
+}
+
+/* Tactical View snapshot of captain i's quadrant */
+void build_update(int i, PacketUpdate *out) {
+    PROF_COUNT(PROF_CTR_SCANNED, MAX_CLIENTS + MAX_NPC + MAX_BASES + MAX_PLANETS + MAX_STARS + MAX_BH);
+
+    memset(out, 0, sizeof(PacketUpdate));
+    out->type = PKT_UPDATE;
+    static long long local_frame_counter = 0;
+    out->frame_id = local_frame_counter++;
+    out->server_tick = server_tick;
+    out->q1 = players[i].state.q1; out->q2 = players[i].state.q2; out->q3 = players[i].state.q3;
+    out->s1 = players[i].state.s1; out->s2 = players[i].state.s2; out->s3 = players[i].state.s3;
+    out->ent_h = players[i].state.ent_h; out->ent_m = players[i].state.ent_m;
+    out->energy = players[i].state.energy;
+    out->torpedoes = players[i].state.torpedoes;
+    for(int s=0; s<6; s++) out->shields[s] = players[i].state.shields[s];
+    out->lock_target = players[i].state.lock_target;
+    out->is_cloaked = players[i].state.is_cloaked;
+    
+    int obj_idx = 0;
+    /* Self */
+    out->objects[obj_idx++] = (NetObject){(float)players[i].state.s1,(float)players[i].state.s2,(float)players[i].state.s3,(float)players[i].state.ent_h,(float)players[i].state.ent_m,1,players[i].ship_class,1, 
+                                         (int)((players[i].state.energy / 3000.0) * 100), i+1};
+    
+    /* Other Players */
+    for(int j=0; j<MAX_CLIENTS; j++) if (i!=j && players[j].active && players[j].state.q1==players[i].state.q1 && players[j].state.q2==players[i].state.q2 && players[j].state.q3==players[i].state.q3 && !players[j].state.is_cloaked && obj_idx < MAX_NET_OBJECTS) {
+        out->objects[obj_idx++] = (NetObject){(float)players[j].state.s1,(float)players[j].state.s2,(float)players[j].state.s3,(float)players[j].state.ent_h,(float)players[j].state.ent_m,1,players[j].ship_class,1,
+                                             (int)((players[j].state.energy / 3000.0) * 100), j+1};
+    }
+    
+    /* NPCs */
+    for(int n=0; n<MAX_NPC; n++) if(npcs[n].active && npcs[n].q1==players[i].state.q1 && npcs[n].q2==players[i].state.q2 && npcs[n].q3==players[i].state.q3 && obj_idx < MAX_NET_OBJECTS)
+        out->objects[obj_idx++] = (NetObject){(float)npcs[n].x,(float)npcs[n].y,(float)npcs[n].z,0,0,npcs[n].faction,0,1,
+                                             (int)((npcs[n].energy / 1000.0) * 100), ID_NPC+n};
+    
+    /* Bases */
+    for(int b=0; b<MAX_BASES; b++) if(bases[b].active && bases[b].q1==players[i].state.q1 && bases[b].q2==players[i].state.q2 && bases[b].q3==players[i].state.q3 && obj_idx < MAX_NET_OBJECTS)
+        out->objects[obj_idx++] = (NetObject){(float)bases[b].x,(float)bases[b].y,(float)bases[b].z,0,0,3,0,1,
+                                             (int)((bases[b].health / 5000.0) * 100), ID_BASE+b};
+    
+    /* Planets, Stars, Black Holes (No health bar, but ID) */
+    for(int p=0; p<MAX_PLANETS; p++) if(planets[p].active && planets[p].q1==players[i].state.q1 && planets[p].q2==players[i].state.q2 && planets[p].q3==players[i].state.q3 && obj_idx < MAX_NET_OBJECTS)
+        out->objects[obj_idx++] = (NetObject){(float)planets[p].x,(float)planets[p].y,(float)planets[p].z,0,0,5,0,1, 0, ID_PLANET+p};
+    for(int s=0; s<MAX_STARS; s++) if(stars_data[s].active && stars_data[s].q1==players[i].state.q1 && stars_data[s].q2==players[i].state.q2 && stars_data[s].q3==players[i].state.q3 && obj_idx < MAX_NET_OBJECTS)
+        out->objects[obj_idx++] = (NetObject){(float)stars_data[s].x,(float)stars_data[s].y,(float)stars_data[s].z,0,0,4,0,1, 0, ID_STAR+s};
+    for(int h=0; h<MAX_BH; h++) if(black_holes[h].active && black_holes[h].q1==players[i].state.q1 && black_holes[h].q2==players[i].state.q2 && black_holes[h].q3==players[i].state.q3 && obj_idx < MAX_NET_OBJECTS)
+        out->objects[obj_idx++] = (NetObject){(float)black_holes[h].x,(float)black_holes[h].y,(float)black_holes[h].z,0,0,6,0,1, 0, ID_BH+h};
+    out->object_count = obj_idx;
+    
+    out->beam_count = players[i].state.beam_count;
+    for(int b=0; b<out->beam_count && b<MAX_NET_BEAMS; b++) out->beams[b] = players[i].state.beams[b];
+    out->torp = quadrant_torpedo(i);
+    out->boom = players[i].state.boom;
+    out->dismantle = players[i].state.dismantle;
+}
+
+void phase_autosave() {
+    /* Auto-save every 60 seconds (1800 ticks at 30 FPS) */
+    if (autosave_enabled && server_tick % 1800 == 0) save_galaxy();
+}
+
+double now_ms() {
+    struct timespec t; clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000.0 + t.tv_nsec / 1e6;
+}
+
+const char *sched_level_names[] = {"full service", "idle captains throttled", "far NPCs asleep", "cosmetic events skipped"};
+
+void sched_report(char *b, size_t len) {
+    snprintf(b, len, "level %d (%s) | tick %.2f ms avg, %.2f ms max, load %.0f%% | overruns %lld | catch-up %lld | dropped %lld | "
+             "updates shed %lld | NPC naps %lld | events shed %lld | degraded ticks %lld/%lld/%lld",
+             sched.level, sched_level_names[sched.level], sched.avg_ms, sched.max_ms, sched.load_ewma * 100.0, sched.overruns,
+             sched.catchup_ticks, sched.ticks_dropped, sched.updates_shed, sched.npc_naps, sched.events_shed,
+             sched.level_ticks[1], sched.level_ticks[2], sched.level_ticks[3]);
+}
+
+/* Overload controller: sustained load above 90% of the budget raises the
+ * shedding level one step at a time, sustained headroom lowers it again. */
+void sched_end_tick(double work_ms, double lag_ms) {
+    sched.avg_ms = sched.avg_ms * 0.95 + work_ms * 0.05;
+    if (work_ms > sched.max_ms) sched.max_ms = work_ms;
+    if (work_ms > TICK_MS) sched.overruns++;
+    sched.load_ewma = sched.load_ewma * 0.9 + (work_ms / TICK_MS) * 0.1;
+    sched.level_ticks[sched.level]++;
+
+    int old_level = sched.level;
+    if (sched_pinned) return;
+    if (sched.load_ewma > 0.9 || lag_ms > TICK_MS) {
+        sched.cool_ticks = 0;
+        if (++sched.hot_ticks >= SCHED_RAISE_TICKS && sched.level < 3) { sched.level++; sched.hot_ticks = 0; }
+    } else if (sched.load_ewma < 0.6 && lag_ms <= 0) {
+        sched.hot_ticks = 0;
+        if (++sched.cool_ticks >= SCHED_LOWER_TICKS && sched.level > 0) { sched.level--; sched.cool_ticks = 0; }
+    } else sched.hot_ticks = sched.cool_ticks = 0;
+
+    /* Shedding changes what the simulation does: the level is part of the input */
+    if (sched.level != old_level) slog_record(SLOG_LEVEL, 0, NULL, sched.level);
+    if (sched.level != old_level || (sched.level > 0 && server_tick % 300 == 0)) {
+        char b[512]; sched_report(b, sizeof(b));
+        printf("SCHEDULER: %s\n", b);
+    }
+}
+
+void run_tick(double lag_ms) {
+    double t0 = now_ms(), t = t0, t1;
+    server_tick++;
+#define RUN_PHASE(id, call) do { \
+        call; t1 = now_ms(); sched.phase_ms[id] = t1 - t; prof_phase(id, (uint64_t)((t1 - t) * 1e6)); \
+        if (trace_on) { trace_span(TRACE_CAT_PHASE, TRACE_TID_GAME, phase_names[id], (uint64_t)(t * 1e6), (uint64_t)(t1 * 1e6), -1, server_tick); } \
+        t = t1; \
+    } while (0)
+    RUN_PHASE(PHASE_NAV, phase_navigation());
+    RUN_PHASE(PHASE_HAZARDS, phase_hazards());
+    RUN_PHASE(PHASE_PROJECTILES, phase_projectiles());
+    RUN_PHASE(PHASE_NPC_AI, phase_npc_ai());
+    RUN_PHASE(PHASE_UPDATES, phase_updates());
+    RUN_PHASE(PHASE_AUTOSAVE, phase_autosave());
+#undef RUN_PHASE
+    sched_end_tick(t - t0, lag_ms);
+    prof_end_tick((uint64_t)((t - t0) * 1e6));
+    if (slog_out && server_tick % SLOG_HASH_STRIDE == 0) { uint64_t h = sim_state_hash(); slog_record(SLOG_HASH, 0, &h, sizeof(h)); }
+    if (trace_on) {
+        trace_span(TRACE_CAT_PHASE, TRACE_TID_GAME, "tick", (uint64_t)(t0 * 1e6), (uint64_t)(t * 1e6), -1, server_tick);
+        if (trace_dump_requested) { trace_dump_requested = 0; (void)trace_dump("signal", server_tick, NULL, 0); }
+        else if (t - t0 > TICK_MS && server_tick - trace_last_dump >= TRACE_DUMP_COOLDOWN) {
+            trace_last_dump = server_tick;
+            (void)trace_dump("overrun", server_tick, NULL, 0);
+        }
+    }
+}
@@ -0,0 +1,112 @@
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "server_sim.h"
+#include "session_log.h"
+
+FILE *slog_out = NULL;
+static long long slog_last_tick = 0;
+static long long slog_records = 0;
+
+static void put_varint(FILE *f, uint64_t v) {
+    while (v >= 0x80) { fputc((int)(v & 0x7F) | 0x80, f); v >>= 7; }
+    fputc((int)v, f);
+}
+
+static int get_varint(FILE *f, uint64_t *v) {
+    *v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int c = fgetc(f);
+        if (c == EOF) return 0;
+        *v |= (uint64_t)(c & 0x7F) << shift;
+        if (!(c & 0x80)) return 1;
+    }
+    return 0;
+}
+
+int slog_record_open(const char *path, uint64_t seed) {
+    FILE *f = fopen(path, "wb");
+    if (!f) { perror(path); return 0; }
+    SlogHeader h = {SLOG_MAGIC, SLOG_VERSION, MAX_CLIENTS, (uint32_t)world_size(), 0, seed, sim_rng_state, server_tick};
+    fwrite(&h, sizeof(h), 1, f);
+    world_write(f);
+    slog_out = f;
+    slog_last_tick = server_tick; slog_records = 0;
+    printf("--- SESSION LOG: recording to %s (seed %llu) ---\n", path, (unsigned long long)seed);
+    return 1;
+}
+
+void slog_record(SlogKind kind, int slot, const void *data, int len) {
+    if (!slog_out) return;
+    fputc(kind, slog_out);
+    put_varint(slog_out, (uint64_t)(server_tick - slog_last_tick));
+    put_varint(slog_out, (uint64_t)slot);
+    slog_last_tick = server_tick;
+    if (kind == SLOG_PACKET) {
+        /* Packets are zero-initialised structs: the trailing zeros of a command carry nothing */
+        const unsigned char *b = data;
+        while (len > 0 && b[len - 1] == 0) len--;
+        put_varint(slog_out, (uint64_t)len);
+        fwrite(b, 1, len, slog_out);
+    } else if (kind == SLOG_LEVEL) fputc(len, slog_out);
+    else if (kind == SLOG_HASH) {
+        fwrite(data, sizeof(uint64_t), 1, slog_out);
+        fflush(slog_out); /* A killed server loses at most one second of input */
+    }
+    slog_records++;
+}
+
+void slog_record_close() {
+    if (!slog_out) return;
+    fclose(slog_out); slog_out = NULL;
+    printf("--- SESSION LOG: %lld records written ---\n", slog_records);
+}
+
+FILE *slog_replay_open(const char *path, SlogHeader *hdr) {
+    FILE *f = fopen(path, "rb");
+    if (!f) { perror(path); return NULL; }
+    if (fread(hdr, sizeof(*hdr), 1, f) != 1 || memcmp(hdr->magic, SLOG_MAGIC, 8) != 0 || hdr->version != SLOG_VERSION) {
+        printf("%s is not a session log.\n", path);
+        fclose(f); return NULL;
+    }
+    if (hdr->max_clients != MAX_CLIENTS || hdr->world_size != world_size()) {
+        printf("%s was recorded by a build with a different world layout (%u slots, %u bytes).\n", path, hdr->max_clients, hdr->world_size);
+        fclose(f); return NULL;
+    }
+    if (!world_read(f)) { printf("%s: truncated world snapshot.\n", path); fclose(f); return NULL; }
+
+    /* Same transient reset as load_galaxy(): every captain reconnects through the log */
+    for (int i = 0; i < MAX_CLIENTS; i++) { players[i].active = 0; players[i].socket = -1; }
+    memset(projectiles, 0, sizeof(projectiles)); projectile_count = 0;
+    memset(&sched, 0, sizeof(sched));
+    sim_rng_state = hdr->rng_state;
+    server_tick = hdr->start_tick;
+    slog_last_tick = server_tick;
+    return f;
+}
+
+int slog_read(FILE *f, SlogRecord *r) {
+    uint64_t delta, slot, len;
+    int kind = fgetc(f);
+    if (kind == EOF) return 0;
+    if (!get_varint(f, &delta) || !get_varint(f, &slot) || slot >= MAX_CLIENTS) return 0;
+    r->kind = kind; r->tick = slog_last_tick + (long long)delta; r->slot = (int)slot; r->len = 0;
+    slog_last_tick = r->tick;
+    switch (kind) {
+        case SLOG_CONNECT: case SLOG_DISCONNECT: return 1;
+        case SLOG_PACKET:
+            if (!get_varint(f, &len) || len > sizeof(r->data) || fread(r->data, 1, len, f) != len) return 0;
+            memset(r->data + len, 0, sizeof(r->data) - len);
+            r->len = (int)len;
+            return 1;
+        case SLOG_LEVEL:
+            if ((r->level = fgetc(f)) == EOF || r->level > 3) return 0;
+            return 1;
+        case SLOG_HASH:
+            return fread(&r->hash, sizeof(r->hash), 1, f) == 1;
+        default:
+            printf("Session log: unknown record kind %d, replay stops here.\n", kind);
+            return 0;
+    }
+}
@@ -0,0 +1,123 @@
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "tracer.h"
+
+#ifdef TREK_TRACE
+
+typedef struct {
+    uint64_t seq;                   /* Ring position + 1, written last: 0 or stale means torn */
+    uint64_t t0, t1;
+    long long arg;
+    int16_t tid, player;
+    uint8_t cat;
+    char name[TRACE_NAME_LEN];
+} TraceEvent;
+
+typedef struct {
+    TraceEvent *events;
+    int count;
+    uint64_t head;                  /* Ring position when the dump was asked for: spans before it are written */
+    long long tick;
+    char reason[32];
+    char path[256];
+} TraceDump;
+
+int trace_on = 0;
+
+static TraceEvent ring[TRACE_RING];
+static uint64_t ring_head = 0;
+static int dumping = 0;
+static _Thread_local int thread_lane = TRACE_TID_NET;
+
+static const char *cat_names[TRACE_CAT_COUNT] = {"phase", "cmd", "io"};
+
+uint64_t trace_now(void) {
+    struct timespec t; clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000ull + t.tv_nsec;
+}
+
+void trace_set_thread(int tid) { thread_lane = tid; }
+int trace_thread(void) { return thread_lane; }
+
+void trace_span(TraceCategory cat, int tid, const char *name, uint64_t t0, uint64_t t1, int player, long long arg) {
+    uint64_t pos = __atomic_fetch_add(&ring_head, 1, __ATOMIC_RELAXED);
+    TraceEvent *e = &ring[pos & (TRACE_RING - 1)];
+    __atomic_store_n(&e->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    e->t0 = t0; e->t1 = t1; e->arg = arg;
+    e->tid = (int16_t)tid; e->player = (int16_t)player; e->cat = (uint8_t)cat;
+    /* Command spans are named after the verb only */
+    int n = 0;
+    while (n < TRACE_NAME_LEN - 1 && name[n] && name[n] != ' ') {
+        char c = name[n];
+        e->name[n] = ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_') ? c : '_';
+        n++;
+    }
+    e->name[n] = 0;
+    __atomic_store_n(&e->seq, pos + 1, __ATOMIC_RELEASE);
+}
+
+static void *dump_thread(void *arg) {
+    TraceDump *d = arg;
+    FILE *f = NULL;
+    if (!(d->events = malloc(sizeof(TraceEvent) * TRACE_RING))) { fprintf(stderr, "trace: no memory for a dump\n"); goto done; }
+    /* Oldest surviving span first; slots rewritten since the request are skipped */
+    for (uint64_t pos = d->head > TRACE_RING ? d->head - TRACE_RING : 0; pos < d->head; pos++) {
+        TraceEvent *e = &ring[pos & (TRACE_RING - 1)];
+        if (__atomic_load_n(&e->seq, __ATOMIC_ACQUIRE) != pos + 1) continue;
+        d->events[d->count] = *e;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&e->seq, __ATOMIC_RELAXED) == pos + 1) d->count++;
+    }
+    if (!(f = fopen(d->path, "w"))) { perror(d->path); goto done; }
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"reason\":\"%s\",\"tick\":%lld},\"traceEvents\":[\n", d->reason, d->tick);
+    fprintf(f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"trek_server\"}},\n");
+    fprintf(f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"game_loop\"}},\n", TRACE_TID_GAME);
+    fprintf(f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"network\"}}", TRACE_TID_NET);
+    uint64_t seen[4] = {0};         /* Bitmap of player lanes already named */
+    for (int i = 0; i < d->count; i++) {
+        TraceEvent *e = &d->events[i];
+        if (e->tid >= TRACE_TID_PLAYER && e->tid < TRACE_TID_PLAYER + 256 && !(seen[(e->tid - TRACE_TID_PLAYER) / 64] & (1ull << ((e->tid - TRACE_TID_PLAYER) % 64)))) {
+            seen[(e->tid - TRACE_TID_PLAYER) / 64] |= 1ull << ((e->tid - TRACE_TID_PLAYER) % 64);
+            fprintf(f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"captain %d\"}}", e->tid, e->tid - TRACE_TID_PLAYER + 1);
+        }
+        fprintf(f, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d,\"args\":{\"player\":%d,\"arg\":%lld}}",
+                e->name, cat_names[e->cat], e->t0 / 1e3, (e->t1 - e->t0) / 1e3, e->tid, e->player, e->arg);
+    }
+    fprintf(f, "\n]}\n");
+    fclose(f);
+    printf("--- TRACE: %d spans written to %s (%s) ---\n", d->count, d->path, d->reason);
+done:
+    free(d->events); free(d);
+    __atomic_store_n(&dumping, 0, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+int trace_dump(const char *reason, long long tick, char *path, size_t len) {
+    if (!trace_on || __atomic_exchange_n(&dumping, 1, __ATOMIC_ACQUIRE)) return -1;
+    /* Only the ring position is taken here, under the caller's lock: the copy is the thread's */
+    TraceDump *d = calloc(1, sizeof(TraceDump));
+    if (!d) { __atomic_store_n(&dumping, 0, __ATOMIC_RELEASE); return -1; }
+    d->head = __atomic_load_n(&ring_head, __ATOMIC_ACQUIRE);
+    d->tick = tick;
+    snprintf(d->reason, sizeof(d->reason), "%s", reason);
+    const char *dir = getenv("TREK_TRACE_DIR");
+    snprintf(d->path, sizeof(d->path), "%s/trek_trace_%lld.json", dir ? dir : ".", tick);
+    if (path) snprintf(path, len, "%s", d->path);
+
+    pthread_t tid;
+    pthread_attr_t attr; pthread_attr_init(&attr); pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    if (pthread_create(&tid, &attr, dump_thread, d) != 0) {
+        free(d);
+        __atomic_store_n(&dumping, 0, __ATOMIC_RELEASE);
+        return -1;
+    }
+    pthread_attr_destroy(&attr);
+    return 0;
+}
+
+#endif
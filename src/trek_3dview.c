@@ -1,6 +1,7 @@
 #define _DEFAULT_SOURCE
 #define GL_GLEXT_PROTOTYPES
 #include <GL/freeglut.h>
+#include <GL/glx.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
@@ -8,22 +9,35 @@
 #include <signal.h>
 #include <locale.h>
 #include <unistd.h>
+#include <pthread.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include "shared_state.h"
 #include "network.h"
-
-/* VBO Globals */
-GLuint vbo_stars = 0;
-GLuint vbo_grid = 0;
-int grid_vertex_count = 0;
+#include "view_mesh.h"
+#include "view_gl.h"
+#include "view_bench.h"
+#include "view_fx.h"
+#include "view_overlay.h"
+#include "view_trail.h"
+#include "view_quality.h"
+#include "view_pick.h"
+#include "view_capture.h"
+
+/* Static batcher lists */
+int list_stars = -1, list_sector = -1, list_compass = -1, list_grid = -1;
+int win_w = 1024, win_h = 768;
+int g_headless = 0;
+double g_bench_clock = 0;
+FILE *g_record = NULL;      /* --record: every acquired frame is appended here */
+const char *g_capture = NULL;  /* --capture: opened at the first window size, which then stays */
+volatile sig_atomic_t g_quit = 0;  /* SIGINT/SIGTERM (the client stops its viewer so): the timer closes the capture and exits */
 
 int shm_fd = -1;
 GameState *g_shared_state = NULL;
 
-volatile int g_data_dirty = 0;
-volatile int g_is_loading = 0;
+int g_is_cloaked = 0;
 float angleY = 0.0f;
 float angleX = 20.0f;
 float zoom = -14.0f;
@@ -34,71 +48,210 @@ int g_energy = 0, g_shields = 0, g_klingons = 0;
 int g_show_axes = 0;
 int g_show_grid = 0;
 int g_show_hud = 1; /* Default HUD ON */
+
+/* Redraw on demand: idle, the 16 ms timer only reads a few counters and draws nothing.
+   The default spin is ambient and rests VIEW_SPIN_REST_MS after anything else last moved */
+#define VIEW_SPIN_REST_MS 10000
+int spin_ambient = 1;       /* 0 once SPACE picks the spin: it then runs until turned off */
+double spin_rest_ms = 0;    /* When the ambient spin stops */
+int g_continuous = 0;       /* --continuous: a frame every 16 ms regardless */
+int g_redraw = 1;           /* Reshape: draw once even if nothing moves */
+uint32_t drawn_change_seq = 0;
+int trail_motion = 0;       /* Ticks until the newest moving trail segment has faded */
+int g_lock_id = -1;         /* Last target clicked, bracketed on the HUD */
 char g_quadrant[128] = "Scanning...";
 char g_last_quadrant[128] = "";
 
-#define MAX_TRAIL 40
+/*
+ * Jitter buffer: every entity keeps its last SNAP_RING samples keyed on
+ * server time. Entities are drawn SNAP_PLAYOUT_MS behind the newest server
+ * time the clock offset predicts, interpolated between the two samples
+ * bracketing that instant; when the buffer runs dry motion is extrapolated
+ * for at most SNAP_EXTRAP_MS, then held. The offset is the smallest
+ * (arrival - server time) seen over the last SNAP_OFFSET_WINDOW frames,
+ * i.e. the least delayed packet, so it follows route changes within about
+ * two seconds.
+ */
+#define SNAP_RING 16
+#define SNAP_PLAYOUT_MS 75.0        /* Two server ticks plus ~40 ms of jitter */
+#define SNAP_EXTRAP_MS 100.0
+#define SNAP_OFFSET_WINDOW 64
+#define SNAP_TICK_MS (1000.0 / NET_TICK_HZ)
+
+typedef struct { double t; float x, y, z, h, m; } SnapSample; /* t: server time in ms */
+
+/* Render side of an entity slot: pose at the playout time, trail and tag */
 typedef struct {
-    float x, y, z;
-    float tx, ty, tz; /* Interpolation targets */
+    float x, y, z;    /* Interpolated at the playout time every frame */
     float h, m;
-    float th, tm;     /* Target heading and mark */
     int type;
     int ship_class;
     int health_pct;   /* HUD */
-    int id;           /* HUD */
-    float trail[MAX_TRAIL][3];
-    int trail_ptr;
+    int id;           /* Universal id, key of the entity map */
+    float trail_last[3]; /* Newest trail point: the rest lives on the GPU (view_trail.c) */
     int trail_count;
-    double last_update_time;
+    OvLabel label;    /* Name tag, laid out again only when it changes */
 } GameObject;
 
+GameObject objects[MAX_OBJECTS]; /* Entity slots: an id keeps its slot from spawn to despawn */
+int scene[MAX_OBJECTS];          /* Slots in the order of the latest frame, scene[0] is our ship */
+int objectCount = 0;
+
+typedef struct { float x, y, z; int active; } ViewPoint;
+ViewPoint g_torp = {0,0,0,0};
+
+float enterpriseX = -100, enterpriseY = -100, enterpriseZ = -100;
+
+/*
+ * Ingest thread: sleeps on the segment's frame futex, matches every new
+ * frame's objects to entity slots, keeps their sample histories and the
+ * clock offset, and hands the render loop a ready-to-draw ViewState through
+ * a triple buffer (one atomic exchange per side, like the segment itself).
+ * The render loop only interpolates and draws. Happenings that must not be
+ * missed when the render loop skips a state (spawns, despawns, explosions,
+ * wrecks, beams) travel in a single-producer ring of ViewEvents instead.
+ * Headless, the bench runs ingestPoll() inline so runs stay reproducible.
+ */
 typedef struct {
-    float x, y, z;
-    float vx, vy, vz;
-    float r, g, b;
-    int active;
-} Particle;
+    int slot, id, type, ship_class, health_pct;
+    SnapSample hist[SNAP_RING];
+    int hist_head, hist_count;  /* hist_head: next sample written */
+} EntState;
 
 typedef struct {
-    float x, y, z;
-    int species;
-    int timer;
-    Particle particles[100];
-} Dismantle;
+    EntState ents[MAX_OBJECTS];     /* Frame order: ents[0] is our ship */
+    int count;
+    double clock_offset;
+    int energy, shields, klingons, is_cloaked;
+    char quadrant[128];
+    ViewPoint torp;
+    double change_ms;               /* Arrival of the latest frame that moved or changed anything */
+} ViewState;
+
+enum { EV_CUT, EV_WARP, EV_BOOM, EV_DISMANTLE, EV_PHASER };
+typedef struct { int kind, slot; float x, y, z; } ViewEvent;
+#define VIEW_EVENT_RING 1024            /* Power of two */
+
+ViewState view_states[3];
+uint32_t view_latest = 1;               /* State index | SHM_FRESH, as GameState.latest */
+int view_back = 0;                      /* Ingest side */
+int view_front = 2;                     /* Render side */
+ViewEvent view_events[VIEW_EVENT_RING];
+uint32_t view_event_head = 0, view_event_tail = 0;
+uint32_t view_change_seq = 0;           /* Bumped with every state that changed something: wakes an idle view */
+
+static void viewEvent(int kind, int slot, float x, float y, float z) {
+    uint32_t head = view_event_head;
+    if (head - __atomic_load_n(&view_event_tail, __ATOMIC_ACQUIRE) >= VIEW_EVENT_RING) return; /* Render stalled: drop */
+    view_events[head & (VIEW_EVENT_RING - 1)] = (ViewEvent){kind, slot, x, y, z};
+    __atomic_store_n(&view_event_head, head + 1, __ATOMIC_RELEASE);
+}
 
-GameObject objects[200];
-int objectCount = 0;
-Dismantle g_dismantle = {-100, -100, -100, 0, 0};
+/* Everything below up to the render side belongs to the ingest thread */
+EntState ent_state[MAX_OBJECTS];        /* By slot */
+long long ent_seen[MAX_OBJECTS];        /* Last frame that listed the slot's entity */
+
+/*
+ * Entity map: universal id -> slot, open addressing with linear probing.
+ * Twice as many buckets as slots keeps probes short; a removal shifts the
+ * rest of its cluster back instead of leaving tombstones.
+ */
+#define ENT_MAP_BITS 9
+#define ENT_MAP_SIZE (1 << ENT_MAP_BITS)
+typedef struct { int id; int slot; } EntEntry; /* slot -1: empty bucket */
+EntEntry ent_map[ENT_MAP_SIZE];
+int free_slots[MAX_OBJECTS], free_count = 0;
+
+void initEntities() {
+    for (int i = 0; i < ENT_MAP_SIZE; i++) ent_map[i].slot = -1;
+    for (int i = 0; i < MAX_OBJECTS; i++) free_slots[i] = MAX_OBJECTS - 1 - i;
+    free_count = MAX_OBJECTS;
+}
+
+static inline unsigned entHash(int id) { return ((unsigned)id * 2654435761u) >> (32 - ENT_MAP_BITS); }
+
+int entFind(int id) {
+    for (unsigned b = entHash(id);; b = (b + 1) & (ENT_MAP_SIZE - 1)) {
+        if (ent_map[b].slot < 0) return -1;
+        if (ent_map[b].id == id) return ent_map[b].slot;
+    }
+}
+
+/* A new id gets a free slot with empty history and trail: -1 if all slots are taken */
+int entSpawn(int id) {
+    if (!free_count) return -1;
+    int slot = free_slots[--free_count];
+    unsigned b = entHash(id);
+    while (ent_map[b].slot >= 0) b = (b + 1) & (ENT_MAP_SIZE - 1);
+    ent_map[b] = (EntEntry){id, slot};
+    EntState *e = &ent_state[slot];
+    e->slot = slot;
+    e->id = id;
+    e->hist_head = e->hist_count = 0;
+    viewEvent(EV_CUT, slot, 0, 0, 0);
+    return slot;
+}
+
+void entDespawn(int id) {
+    unsigned b = entHash(id);
+    while (ent_map[b].slot >= 0 && ent_map[b].id != id) b = (b + 1) & (ENT_MAP_SIZE - 1);
+    if (ent_map[b].slot < 0) return;
+    viewEvent(EV_CUT, ent_map[b].slot, 0, 0, 0);
+    free_slots[free_count++] = ent_map[b].slot;
+    /* Backward shift: an entry further down may fill the hole unless its home bucket lies after the hole */
+    for (unsigned j = b;;) {
+        ent_map[b].slot = -1;
+        for (;;) {
+            j = (j + 1) & (ENT_MAP_SIZE - 1);
+            if (ent_map[j].slot < 0) return;
+            unsigned home = entHash(ent_map[j].id);
+            if (((j - home) & (ENT_MAP_SIZE - 1)) >= ((j - b) & (ENT_MAP_SIZE - 1))) break;
+        }
+        ent_map[b] = ent_map[j];
+        b = j;
+    }
+}
 
-/* Rimosse variabili globali scia singola per scia universale */
-typedef struct { float x, y, z, alpha; } PhaserBeam;
-PhaserBeam beams[10];
-int beamCount = 0;
+double offset_samples[SNAP_OFFSET_WINDOW];
+int offset_count = 0;
+double clock_offset = 0;
+double last_server_ms = -1;
+
+void pushOffset(double server_ms, double recv_ms) {
+    if (server_ms < last_server_ms) offset_count = 0; /* Server restarted */
+    last_server_ms = server_ms;
+    offset_samples[offset_count++ % SNAP_OFFSET_WINDOW] = recv_ms - server_ms;
+    int n = offset_count < SNAP_OFFSET_WINDOW ? offset_count : SNAP_OFFSET_WINDOW;
+    clock_offset = offset_samples[0];
+    for (int i = 1; i < n; i++) if (offset_samples[i] < clock_offset) clock_offset = offset_samples[i];
+}
 
-typedef struct { float x, y, z; int active; int timer; } ViewPoint;
-ViewPoint g_torp = {0,0,0,0,0};
-ViewPoint g_boom = {0,0,0,0,0};
+static inline const SnapSample *histAt(const EntState *e, int age) { return &e->hist[(e->hist_head + SNAP_RING - 1 - age) % SNAP_RING]; }
 
-float enterpriseX = -100, enterpriseY = -100, enterpriseZ = -100;
+void pushSample(EntState *e, const SnapSample *smp) {
+    if (e->hist_count && smp->t <= e->hist[(e->hist_head + SNAP_RING - 1) % SNAP_RING].t) e->hist_count = 0;
+    e->hist[e->hist_head] = *smp;
+    e->hist_head = (e->hist_head + 1) % SNAP_RING;
+    if (e->hist_count < SNAP_RING) e->hist_count++;
+}
 
 float stars[1000][3];
 
 /* Prototypes */
-void drawStarbase(float x, float y, float z);
-void drawPlanet(float x, float y, float z);
+void drawStarbase();
+void drawPlanet();
 void drawGrid();
-void drawKlingon(float x, float y, float z);
-void drawRomulan(float x, float y, float z);
-void drawBorg(float x, float y, float z);
-void drawCardassian(float x, float y, float z);
-void drawJemHadar(float x, float y, float z);
-void drawTholian(float x, float y, float z);
-void drawGorn(float x, float y, float z);
-void drawFerengi(float x, float y, float z);
-void drawSpecies8472(float x, float y, float z);
-void drawBreen(float x, float y, float z);
-void drawHirogen(float x, float y, float z);
+void drawKlingon();
+void drawRomulan();
+void drawBorg();
+void drawCardassian();
+void drawJemHadar();
+void drawTholian();
+void drawGorn();
+void drawFerengi();
+void drawSpecies8472();
+void drawBreen();
+void drawHirogen();
 void drawNacelle(float len, float width, float r, float g, float b);
 void drawDeflector(float r, float g, float b);
 void drawConstitution();
@@ -118,12 +271,10 @@ void drawGlow(float radius, float r, float g, float b, float alpha);
 void drawHullDetail(void (*drawFunc)(void), float r, float g, float b);
 void drawNavLights(float x, float y, float z);
 void drawStarfleetSaucer(float sx, float sy, float sz);
-void glutSolidSphere_wrapper_saucer();
-void glutSolidSphere_wrapper_hull();
-void glutSolidSphere_wrapper_defiant();
-void glutSolidCube_wrapper();
-
-void handle_signal(int sig) { if (sig == SIGUSR1) g_data_dirty = 1; }
+void hullSaucer();
+void hullSecondary();
+void hullDefiant();
+void hullCube();
 
 void initStars() {
     for(int i=0; i<1000; i++) {
@@ -136,147 +287,229 @@ void initStars() {
     }
 }
 
-void initVBOs() {
-    glGenBuffers(1, &vbo_stars);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo_stars);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(stars), stars, GL_STATIC_DRAW);
-    int max_verts = 12 * 12 * 3 * 2; 
-    float *grid_data = malloc(max_verts * 3 * sizeof(float));
-    int idx = 0;
+/* Fixed scenery goes into static lists: one upload, replayed every frame */
+void initLists() {
+    list_stars = vgl_list_begin();
+    vgl_begin(VGL_POINTS, 1.0f, 0); vgl_color3(0.7, 0.7, 0.7);
+    for(int i=0; i<1000; i++) vgl_vertex(stars[i][0], stars[i][1], stars[i][2]);
+    vgl_end(); vgl_list_end();
+
+    /* Sector box, as glutWireCube(11.0) */
+    list_sector = vgl_list_begin();
+    vgl_begin(VGL_LINES, 1.0f, 0); vgl_color3(0.2, 0.2, 0.5);
+    for(int a=0; a<3; a++)
+        for(int k=0; k<4; k++) {
+            float p[3], q[3];
+            p[a] = -5.5f; q[a] = 5.5f;
+            p[(a+1)%3] = q[(a+1)%3] = (k & 1) ? 5.5f : -5.5f;
+            p[(a+2)%3] = q[(a+2)%3] = (k & 2) ? 5.5f : -5.5f;
+            vgl_vertex(p[0], p[1], p[2]); vgl_vertex(q[0], q[1], q[2]);
+        }
+    vgl_end(); vgl_list_end();
+
+    list_compass = vgl_list_begin();
+    vgl_begin(VGL_LINES, 1.0f, 0);
+    vgl_color3(0, 1, 0); vgl_vertex(-5.5,0,0); vgl_vertex(5.5,0,0);
+    vgl_color3(0, 0, 1); vgl_vertex(0,0,-5.5); vgl_vertex(0,0,5.5);
+    vgl_color3(1, 0, 0); vgl_vertex(0,-5.5,0); vgl_vertex(0,5.5,0);
+    vgl_end(); vgl_list_end();
+
+    list_grid = vgl_list_begin();
+    vgl_begin(VGL_LINES, 1.0f, 0); vgl_color4(0.5f, 0.5f, 0.5f, 0.2f);
     for(int i=0; i<=11; i++) {
         float p = -5.5f + (float)i;
         for(int j=0; j<=11; j++) {
             float q = -5.5f + (float)j;
-            grid_data[idx++] = p; grid_data[idx++] = q; grid_data[idx++] = -5.5f;
-            grid_data[idx++] = p; grid_data[idx++] = q; grid_data[idx++] = 5.5f;
-            grid_data[idx++] = p; grid_data[idx++] = -5.5f; grid_data[idx++] = q;
-            grid_data[idx++] = p; grid_data[idx++] = 5.5f; grid_data[idx++] = q;
-            grid_data[idx++] = -5.5f; grid_data[idx++] = p; grid_data[idx++] = q;
-            grid_data[idx++] = 5.5f; grid_data[idx++] = p; grid_data[idx++] = q;
+            vgl_vertex(p, q, -5.5f); vgl_vertex(p, q, 5.5f);
+            vgl_vertex(p, -5.5f, q); vgl_vertex(p, 5.5f, q);
+            vgl_vertex(-5.5f, p, q); vgl_vertex(5.5f, p, q);
         }
     }
-    grid_vertex_count = idx / 3;
-    glGenBuffers(1, &vbo_grid);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo_grid);
-    glBufferData(GL_ARRAY_BUFFER, idx * sizeof(float), grid_data, GL_STATIC_DRAW);
-    free(grid_data);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    vgl_end(); vgl_list_end();
 }
 
 long long last_frame_id = -1;
+int shm_front = 2; /* Triple buffer frame owned by the ingest thread */
+uint32_t last_boom_seq = 0, last_dismantle_seq = 0;
+char ingest_quadrant[128] = "";
 
-void loadGameState() {
+/* One ingest step: beams, then the freshest frame if there is one. Without news this is two atomic loads */
+void ingestPoll() {
     if (!g_shared_state) return;
-    pthread_mutex_lock(&g_shared_state->mutex);
-    if (g_shared_state->frame_id == last_frame_id) { pthread_mutex_unlock(&g_shared_state->mutex); return; }
-    last_frame_id = g_shared_state->frame_id;
-    g_is_loading = 1;
-    g_energy = g_shared_state->shm_energy;
+    /* Beams are queued independently of frames */
+    SharedBeam beam;
+    while (shm_pop_beam(g_shared_state, &beam)) viewEvent(EV_PHASER, -1, beam.shm_tx - 5.5f, beam.shm_tz - 5.5f, 5.5f - beam.shm_ty);
+
+    ShmFrame *f = shm_acquire(g_shared_state, &shm_front);
+    if (!f || f->frame_id == last_frame_id) return;
+    last_frame_id = f->frame_id;
+    if (g_record) bench_record(g_record, f);
+    ViewState *v = &view_states[view_back];
+    v->energy = f->shm_energy;
     int total_s = 0;
-    for(int s=0; s<6; s++) total_s += g_shared_state->shm_shields[s];
-    g_shields = total_s / 6;
-    g_klingons = g_shared_state->klingons;
+    for(int s=0; s<6; s++) total_s += f->shm_shields[s];
+    v->shields = total_s / 6;
+    v->klingons = f->klingons;
+    v->is_cloaked = f->is_cloaked;
+    /* Anything a redraw would show differently: an idle view wakes up for it */
+    static int hud[4];
+    int changed = hud[0] != v->energy || hud[1] != v->shields || hud[2] != v->klingons || hud[3] != v->is_cloaked;
+    hud[0] = v->energy; hud[1] = v->shields; hud[2] = v->klingons; hud[3] = v->is_cloaked;
     
     int quadrant_changed = 0;
-    if (strcmp(g_quadrant, g_shared_state->quadrant) != 0) {
-        quadrant_changed = 1;
-        strcpy(g_quadrant, g_shared_state->quadrant);
+    if (strcmp(ingest_quadrant, f->quadrant) != 0) {
+        quadrant_changed = changed = 1;
+        strcpy(ingest_quadrant, f->quadrant);
     }
+    strcpy(v->quadrant, ingest_quadrant);
     
-    g_show_axes = g_shared_state->shm_show_axes;
-    g_show_grid = g_shared_state->shm_show_grid;
-    objectCount = g_shared_state->object_count;
-    for(int i=0; i<objectCount; i++) {
-        float next_x = g_shared_state->objects[i].shm_x - 5.5f;
-        float next_y = g_shared_state->objects[i].shm_z - 5.5f;
-        float next_z = 5.5f - g_shared_state->objects[i].shm_y;
-        
-        /* Se è la prima volta che vediamo l'oggetto o se ha fatto un salto enorme (cambio quadrante) */
-        float dx = next_x - objects[i].x;
-        float dy = next_y - objects[i].y;
-        float dz = next_z - objects[i].z;
-        
-        if (quadrant_changed || objects[i].x < -50.0f || (dx*dx + dy*dy + dz*dz) > 25.0f) {
-            objects[i].x = objects[i].tx = next_x;
-            objects[i].y = objects[i].ty = next_y;
-            objects[i].z = objects[i].tz = next_z;
-            /* Reset trails on quadrant jump */
-            objects[i].trail_count = 0;
-            objects[i].trail_ptr = 0;
-        } else {
-            objects[i].tx = next_x;
-            objects[i].ty = next_y;
-            objects[i].tz = next_z;
-        }
+    /* Entities are matched by id: new ids spawn, ids missing from the frame despawn */
+    double server_ms = f->server_tick * SNAP_TICK_MS;
+    pushOffset(server_ms, f->recv_ms);
+    v->clock_offset = clock_offset;
+    static long long scene_frame = 0;
+    static int prev[MAX_OBJECTS], prev_count = 0;
+    scene_frame++;
+    int count = 0;
+    for(int i=0; i<f->object_count; i++) {
+        const SharedObject *so = &f->objects[i];
+        int slot = entFind(so->id);
+        int spawned = slot < 0;
+        if (spawned && (slot = entSpawn(so->id)) < 0) continue;
+        EntState *e = &ent_state[slot];
+        if (ent_seen[slot] == scene_frame) continue;             /* Duplicate id */
+        /* Un nuovo quadrante non si interpola col precedente */
+        if (quadrant_changed) { e->hist_count = 0; viewEvent(EV_CUT, slot, 0, 0, 0); }
+        ent_seen[slot] = scene_frame;
+        SnapSample smp = {server_ms, so->shm_x - 5.5f, so->shm_z - 5.5f, 5.5f - so->shm_y, so->h, so->m};
+        const SnapSample *last = e->hist_count ? histAt(e, 0) : NULL;
+        if (!last || last->x != smp.x || last->y != smp.y || last->z != smp.z || last->h != smp.h || last->m != smp.m ||
+            e->type != so->type || e->ship_class != so->ship_class || e->health_pct != so->health_pct) changed = 1;
+        e->type = so->type;
+        e->ship_class = so->ship_class;
+        e->health_pct = so->health_pct;
+        pushSample(e, &smp);
+        /* A ship appearing inside the quadrant we are in has just dropped out of warp */
+        if (spawned && !quadrant_changed && (so->type == 1 || so->type >= 10))
+            viewEvent(EV_WARP, slot, so->shm_x - 5.5f, so->shm_z - 5.5f, 5.5f - so->shm_y);
+        v->ents[count++] = *e;
+    }
+    v->count = count;
+    for (int i = 0; i < prev_count; i++)
+        if (ent_seen[prev[i]] != scene_frame) { entDespawn(ent_state[prev[i]].id); changed = 1; }
+    for (int i = 0; i < count; i++) prev[i] = v->ents[i].slot;
+    prev_count = count;
+    if (f->torp.active) v->torp = (ViewPoint){f->torp.shm_x - 5.5f, f->torp.shm_z - 5.5f, 5.5f - f->torp.shm_y, 1};
+    else v->torp.active = 0;
+    static int torp_was = 0;
+    if (v->torp.active || torp_was) changed = 1;
+    torp_was = v->torp.active;
+    static double change_ms = 0;
+    if (changed) change_ms = f->recv_ms;
+    v->change_ms = change_ms;
+    /* Explosions and wrecks stack in the effects pool instead of replacing each other */
+    if (f->boom_seq != last_boom_seq) {
+        last_boom_seq = f->boom_seq;
+        viewEvent(EV_BOOM, -1, f->boom.shm_x - 5.5f, f->boom.shm_z - 5.5f, 5.5f - f->boom.shm_y);
+    }
+    if (f->dismantle_seq != last_dismantle_seq) {
+        last_dismantle_seq = f->dismantle_seq;
+        viewEvent(EV_DISMANTLE, -1, f->dismantle.shm_x - 5.5f, f->dismantle.shm_z - 5.5f, 5.5f - f->dismantle.shm_y);
+    }
+
+    uint32_t prev_state = __atomic_exchange_n(&view_latest, (uint32_t)view_back | SHM_FRESH, __ATOMIC_ACQ_REL);
+    view_back = prev_state & 3;
+    if (changed) __atomic_fetch_add(&view_change_seq, 1, __ATOMIC_RELEASE);
+}
 
-        objects[i].th = g_shared_state->objects[i].h;
-        objects[i].tm = g_shared_state->objects[i].m;
-        objects[i].last_update_time = glutGet(GLUT_ELAPSED_TIME);
-        objects[i].type = g_shared_state->objects[i].type;
-        objects[i].ship_class = g_shared_state->objects[i].ship_class;
-        objects[i].health_pct = g_shared_state->objects[i].health_pct;
-        objects[i].id = g_shared_state->objects[i].id; 
-        if (i == 0) { enterpriseX = objects[i].x; enterpriseY = objects[i].y; enterpriseZ = objects[i].z; }
-    }
-    if (g_shared_state->beam_count > 0) {
-        for(int i=0; i<g_shared_state->beam_count; i++) {
-            int slot = -1;
-            for(int j=0; j<10; j++) if(beams[j].alpha <= 0) { slot = j; break; }
-            if (slot == -1) slot = rand()%10;
-            beams[slot].x = g_shared_state->beams[i].shm_tx - 5.5f;
-            beams[slot].y = g_shared_state->beams[i].shm_tz - 5.5f;
-            beams[slot].z = 5.5f - g_shared_state->beams[i].shm_ty;
-            beams[slot].alpha = 1.5f;
+void *ingestMain(void *arg) {
+    for (;;) {
+        uint32_t seen = __atomic_load_n(&g_shared_state->frame_seq, __ATOMIC_ACQUIRE);
+        ingestPoll();
+        struct timespec timeout = {0, 16 * 1000000}; /* Beams don't bump frame_seq: poll them once a tick */
+        shm_wait_frame(g_shared_state, seen, &timeout);
+    }
+    return NULL;
+}
+
+/* Render side: the state being drawn, kept until a fresher one arrives */
+const ViewState *view_cur = NULL;
+
+/* Takes the freshest state and the queued events: never waits for the ingest thread */
+void consumeView() {
+    if (__atomic_load_n(&view_latest, __ATOMIC_ACQUIRE) & SHM_FRESH) {
+        view_front = __atomic_exchange_n(&view_latest, (uint32_t)view_front, __ATOMIC_ACQ_REL) & 3;
+        view_cur = &view_states[view_front];
+        const ViewState *view = view_cur;
+        g_energy = view->energy;
+        g_shields = view->shields;
+        g_klingons = view->klingons;
+        g_is_cloaked = view->is_cloaked;
+        strcpy(g_quadrant, view->quadrant);
+        g_torp = view->torp;
+        objectCount = view->count;
+        for (int i = 0; i < view->count; i++) {
+            const EntState *e = &view->ents[i];
+            GameObject *o = &objects[e->slot];
+            o->type = e->type;
+            o->ship_class = e->ship_class;
+            o->health_pct = e->health_pct;
+            o->id = e->id;
+            scene[i] = e->slot;
         }
-        /* Consume events */
-        g_shared_state->beam_count = 0;
-    }
-    if (g_shared_state->torp.active) {
-        g_torp.x = g_shared_state->torp.shm_x - 5.5f;
-        g_torp.y = g_shared_state->torp.shm_z - 5.5f;
-        g_torp.z = 5.5f - g_shared_state->torp.shm_y;
-        g_torp.active = 1;
-    } else g_torp.active = 0;
-    if (g_shared_state->boom.active) {
-        g_boom.x = g_shared_state->boom.shm_x - 5.5f;
-        g_boom.y = g_shared_state->boom.shm_z - 5.5f;
-        g_boom.z = 5.5f - g_shared_state->boom.shm_y;
-        g_boom.active = 1;
-        g_boom.timer = 40; /* 1.3 seconds approx */
-        /* Consume event */
-        g_shared_state->boom.active = 0;
-    }
-
-    /* Dismantle */
-    if (g_shared_state->dismantle.active) {
-        g_dismantle.x = g_shared_state->dismantle.shm_x - 5.5f;
-        g_dismantle.y = g_shared_state->dismantle.shm_z - 5.5f;
-        g_dismantle.z = 5.5f - g_shared_state->dismantle.shm_y;
-        g_dismantle.species = g_shared_state->dismantle.species;
-        g_dismantle.timer = 60;
-        for(int i=0; i<100; i++) {
-            g_dismantle.particles[i].x = g_dismantle.x;
-            g_dismantle.particles[i].y = g_dismantle.y;
-            g_dismantle.particles[i].z = g_dismantle.z;
-            g_dismantle.particles[i].vx = ((rand()%100)-50)/500.0f;
-            g_dismantle.particles[i].vy = ((rand()%100)-50)/500.0f;
-            g_dismantle.particles[i].vz = ((rand()%100)-50)/500.0f;
-            g_dismantle.particles[i].r = (rand()%100)/100.0f;
-            g_dismantle.particles[i].g = (rand()%100)/100.0f;
-            g_dismantle.particles[i].b = (rand()%100)/100.0f;
-            g_dismantle.particles[i].active = 1;
+    }
+    uint32_t tail = view_event_tail, head = __atomic_load_n(&view_event_head, __ATOMIC_ACQUIRE);
+    for (; tail != head; tail++) {
+        const ViewEvent *ev = &view_events[tail & (VIEW_EVENT_RING - 1)];
+        float at[3] = {ev->x, ev->y, ev->z};
+        switch (ev->kind) {
+            case EV_CUT: objects[ev->slot].trail_count = 0; trail_cut(ev->slot); break;
+            case EV_WARP: fx_warp_flash(ev->x, ev->y, ev->z); break;
+            case EV_BOOM: fx_explosion(ev->x, ev->y, ev->z); break;
+            case EV_DISMANTLE: fx_dismantle(ev->x, ev->y, ev->z); break;
+            case EV_PHASER: { float from[3] = {enterpriseX, enterpriseY, enterpriseZ}; fx_phaser(from, at); break; } /* From where our ship is now */
         }
-        /* Reset event to prevent re-triggering */
-        g_shared_state->dismantle.active = 0;
     }
-    pthread_mutex_unlock(&g_shared_state->mutex);
-    kill(getppid(), SIGUSR2);
-    g_is_loading = 0;
+    __atomic_store_n(&view_event_tail, tail, __ATOMIC_RELEASE);
 }
 
-void drawText3D(float x, float y, float z, const char* text) {
-    glRasterPos3f(x, y, z);
-    for(int i=0; i<strlen(text); i++) glutBitmapCharacter(GLUT_BITMAP_HELVETICA_12, text[i]);
+/* Places every entity at the playout time `now` - offset - delay */
+void interpolateObjects(double now) {
+    const ViewState *view = view_cur;
+    if (!view) return;
+    double t0 = now - view->clock_offset - SNAP_PLAYOUT_MS;
+    for (int i = 0; i < view->count; i++) {
+        const EntState *e = &view->ents[i];
+        GameObject *o = &objects[e->slot];
+        if (!e->hist_count) continue;
+        /* a.t <= t < b.t; past the newest b is the newest (extrapolation), before the oldest a = b */
+        int age = 0;
+        while (age + 1 < e->hist_count && histAt(e, age + 1)->t > t0) age++;
+        const SnapSample *pb = histAt(e, age), *pa = age + 1 < e->hist_count ? histAt(e, age + 1) : pb;
+        float dx = pb->x - pa->x, dy = pb->y - pa->y, dz = pb->z - pa->z;
+        if (dx*dx + dy*dy + dz*dz > 25.0f) pa = pb;              /* Jump: no sweep across the sector */
+        float k = 0;
+        if (pb != pa) {
+            double t = t0 > pb->t + SNAP_EXTRAP_MS ? pb->t + SNAP_EXTRAP_MS : t0;
+            k = (float)((t - pa->t) / (pb->t - pa->t));
+        }
+        float dh = pb->h - pa->h;
+        if (dh > 180.0f) dh -= 360.0f;
+        if (dh < -180.0f) dh += 360.0f;
+        float h = pa->h + dh * k;
+        o->x = pa->x + (pb->x - pa->x) * k;
+        o->y = pa->y + (pb->y - pa->y) * k;
+        o->z = pa->z + (pb->z - pa->z) * k;
+        o->h = h - 360.0f * floorf(h / 360.0f);
+        o->m = pa->m + (pb->m - pa->m) * k;
+    }
+    if (objectCount > 0) { enterpriseX = objects[scene[0]].x; enterpriseY = objects[scene[0]].y; enterpriseZ = objects[scene[0]].z; }
+}
+
+/* Status text at (x, y) on a 1000x1000 grid over the window */
+void drawText2D(OvLabel *l, float x, float y, const char *text) {
+    ov_label(l, OV_FONT_NORMAL, text);
+    ov_draw_label(l, x * win_w / 1000.0f, y * win_h / 1000.0f);
 }
 
 const char* getSpeciesName(int s) {
@@ -290,267 +523,237 @@ const char* getSpeciesName(int s) {
     }
 }
 
-void drawHUD(float x, float y, float z, int type, int id, int hp) {
-    GLdouble model[16], proj[16];
-    GLint view[4];
-    GLdouble winX, winY, winZ;
-
-    glGetDoublev(GL_MODELVIEW_MATRIX, model);
-    glGetDoublev(GL_PROJECTION_MATRIX, proj);
-    glGetIntegerv(GL_VIEWPORT, view);
-
-    if (gluProject(x, y, z + 0.8f, model, proj, view, &winX, &winY, &winZ) == GL_TRUE) {
-        /* Check if behind camera */
-        if (winZ > 1.0) return;
-
-        glMatrixMode(GL_PROJECTION); glPushMatrix(); glLoadIdentity();
-        gluOrtho2D(0, view[2], 0, view[3]);
-        glMatrixMode(GL_MODELVIEW); glPushMatrix(); glLoadIdentity();
-        glDisable(GL_LIGHTING); glDisable(GL_DEPTH_TEST);
-
-        /* Draw Name/ID */
-        char buf[64];
-        if (type == 1) sprintf(buf, "Vessel %d (Player)", id);
-        else sprintf(buf, "%s [%d]", getSpeciesName(type), id);
-        
-        glColor3f(0.0f, 1.0f, 1.0f);
-        glRasterPos2f(winX - (strlen(buf)*4), winY + 15);
-        for(int i=0; i<strlen(buf); i++) glutBitmapCharacter(GLUT_BITMAP_HELVETICA_10, buf[i]);
-
-        /* Draw Health Bar (Only for ships/bases) */
-        if (type == 1 || type == 3 || type >= 10) {
-            float w = 40.0f;
-            float h = 4.0f;
-            float bar = (hp / 100.0f) * w;
-            if (bar < 0) bar = 0; 
-            if (bar > w) bar = w;
-
-            /* Border */
-            glColor3f(0.5f, 0.5f, 0.5f);
-            glBegin(GL_LINE_LOOP);
-            glVertex2f(winX - w/2, winY);
-            glVertex2f(winX + w/2, winY);
-            glVertex2f(winX + w/2, winY + h);
-            glVertex2f(winX - w/2, winY + h);
-            glEnd();
-
-            /* Fill */
-            if (hp > 50) glColor3f(0.0f, 1.0f, 0.0f);
-            else if (hp > 25) glColor3f(1.0f, 1.0f, 0.0f);
-            else glColor3f(1.0f, 0.0f, 0.0f);
-
-            glBegin(GL_QUADS);
-            glVertex2f(winX - w/2, winY);
-            glVertex2f(winX - w/2 + bar, winY);
-            glVertex2f(winX - w/2 + bar, winY + h);
-            glVertex2f(winX - w/2, winY + h);
-            glEnd();
-        }
+/* Per-object overlay: name tag and health bar above the object */
+void drawHUD(GameObject *o) {
+    float win[3];
+    if (!vgl_project(o->x, o->y, o->z + 0.8f, win)) return; /* Behind camera */
+    float winX = floorf(win[0] + 0.5f), winY = floorf(win[1] + 0.5f);
+
+    /* Draw Name/ID */
+    char buf[64];
+    if (o->type == 1) sprintf(buf, "Vessel %d (Player)", o->id);
+    else sprintf(buf, "%s [%d]", getSpeciesName(o->type), o->id);
+    int width = ov_label(&o->label, OV_FONT_SMALL, buf);
+    ov_color(0.0f, 1.0f, 1.0f, 1.0f);
+    ov_draw_label(&o->label, winX - width / 2, winY + 15);
+
+    /* Target we asked to lock: brackets around the object itself */
+    float c[3];
+    if (o->id == g_lock_id && vgl_project(o->x, o->y, o->z, c)) {
+        ov_color(1.0f, 0.6f, 0.0f, 1.0f);
+        ov_frame(floorf(c[0]) - 14, floorf(c[1]) - 14, floorf(c[0]) + 15, floorf(c[1]) + 15);
+    }
 
-        glEnable(GL_DEPTH_TEST); glEnable(GL_LIGHTING);
-        glMatrixMode(GL_PROJECTION); glPopMatrix();
-        glMatrixMode(GL_MODELVIEW); glPopMatrix();
+    /* Draw Health Bar (Only for ships/bases) */
+    if (o->type == 1 || o->type == 3 || o->type >= 10) {
+        float w = 40.0f;
+        float h = 4.0f;
+        float bar = (o->health_pct / 100.0f) * w;
+        if (bar < 0) bar = 0; 
+        if (bar > w) bar = w;
+
+        /* Border */
+        ov_color(0.5f, 0.5f, 0.5f, 1.0f);
+        ov_frame(winX - w/2, winY, winX + w/2 + 1, winY + h + 1);
+        /* Fill */
+        if (o->health_pct > 50) ov_color(0.0f, 1.0f, 0.0f, 1.0f);
+        else if (o->health_pct > 25) ov_color(1.0f, 1.0f, 0.0f, 1.0f);
+        else ov_color(1.0f, 0.0f, 0.0f, 1.0f);
+        ov_rect(winX - w/2, winY, winX - w/2 + bar, winY + h);
     }
 }
 
-void drawCompass() {
-    glDisable(GL_LIGHTING);
-    glColor3f(0, 1, 0); glBegin(GL_LINES); glVertex3f(-5.5,0,0); glVertex3f(5.5,0,0); glEnd();
-    glColor3f(0, 0, 1); glBegin(GL_LINES); glVertex3f(0,0,-5.5); glVertex3f(0,0,5.5); glEnd();
-    glColor3f(1, 0, 0); glBegin(GL_LINES); glVertex3f(0,-5.5,0); glVertex3f(0,5.5,0); glEnd();
-    glEnable(GL_LIGHTING);
-}
+void drawCompass() { vgl_call(list_compass); }
 
 void drawGlow(float radius, float r, float g, float b, float alpha) {
-    glDisable(GL_LIGHTING);
+    if (mesh_level() > 0) { mesh_halo(radius, r, g, b, alpha); return; } /* Same profile on one quad */
+    mesh_lighting(0);
     for (int i = 1; i <= 5; i++) {
         float s = radius * (1.0f + i * 0.2f);
-        glColor4f(r, g, b, alpha / (i * 1.5f));
-        glutSolidSphere(s, 16, 16);
+        mesh_color4(r, g, b, alpha / (i * 1.5f));
+        mesh_sphere(s, 16, 16);
     }
-    glEnable(GL_LIGHTING);
+    mesh_lighting(1);
 }
 
-void glutSolidSphere_wrapper_saucer() { glutSolidSphere(0.5, 40, 40); }
-void glutSolidSphere_wrapper_hull() { glutSolidSphere(0.15, 20, 20); }
-void glutSolidSphere_wrapper_defiant() { glutSolidSphere(0.35, 30, 30); }
-void glutSolidCube_wrapper() { glutSolidCube(0.5); }
+void hullSaucer() { mesh_sphere(0.5, 40, 40); }
+void hullSecondary() { mesh_sphere(0.15, 20, 20); }
+void hullDefiant() { mesh_sphere(0.35, 30, 30); }
+void hullCube() { mesh_cube(0.5); }
 
 void drawHullDetail(void (*drawFunc)(void), float r, float g, float b) {
-    glColor3f(r, g, b); drawFunc();
-    glDisable(GL_LIGHTING); glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-    glColor4f(r*1.2f, g*1.2f, b*1.2f, 0.15f); drawFunc();
-    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL); glEnable(GL_LIGHTING);
+    mesh_color3(r, g, b); drawFunc();
+    mesh_lighting(0); mesh_wireframe(1);
+    mesh_color4(r*1.2f, g*1.2f, b*1.2f, 0.15f); drawFunc();
+    mesh_wireframe(0); mesh_lighting(1);
 }
 
 void drawNavLights(float x, float y, float z) {
-    glDisable(GL_LIGHTING);
-    glColor3f(1, 0, 0); glPushMatrix(); glTranslatef(x, y, z); glutSolidSphere(0.03, 8, 8); glPopMatrix();
-    glColor3f(0, 1, 0); glPushMatrix(); glTranslatef(x, y, -z); glutSolidSphere(0.03, 8, 8); glPopMatrix();
-    glEnable(GL_LIGHTING);
+    mesh_lighting(0);
+    mesh_color3(1, 0, 0); mesh_push(); mesh_translate(x, y, z); mesh_sphere(0.03, 8, 8); mesh_pop();
+    mesh_color3(0, 1, 0); mesh_push(); mesh_translate(x, y, -z); mesh_sphere(0.03, 8, 8); mesh_pop();
+    mesh_lighting(1);
 }
 
 void drawNacelle(float len, float width, float r, float g, float b) {
     /* Corpo della gondola (Scalato) */
-    glPushMatrix(); 
-    glScalef(len, width, width); 
-    glColor3f(0.4f, 0.4f, 0.45f); 
-    glutSolidSphere(0.1, 16, 16); 
-    glPopMatrix();
+    mesh_push(); 
+    mesh_scale(len, width, width); 
+    mesh_color3(0.4f, 0.4f, 0.45f); 
+    mesh_sphere(0.1, 16, 16); 
+    mesh_pop();
 
     /* Glow posteriore (Non deformato, posizionato alla fine) */
-    glPushMatrix(); 
-    glTranslatef(-0.1f * len, 0, 0); 
+    mesh_push(); 
+    mesh_translate(-0.1f * len, 0, 0); 
     drawGlow(0.07f, r, g, b, 0.3f); 
-    glPopMatrix();
+    mesh_pop();
 
     /* Collettore di Bussard anteriore (Non deformato, sferico, posizionato in punta) */
-    glPushMatrix(); 
-    glTranslatef(0.1f * len, 0, 0); 
-    glColor3f(0.8f, 0.0f, 0.0f); 
-    glutSolidSphere(0.04, 12, 12); 
+    mesh_push(); 
+    mesh_translate(0.1f * len, 0, 0); 
+    mesh_color3(0.8f, 0.0f, 0.0f); 
+    mesh_sphere(0.04, 12, 12); 
     drawGlow(0.05f, 1.0f, 0.2f, 0.0f, 0.3f); 
-    glPopMatrix();
+    mesh_pop();
 }
 
 void drawDeflector(float r, float g, float b) {
-    glDisable(GL_LIGHTING); glColor3f(r, g, b); glutSolidSphere(0.12, 16, 16); glEnable(GL_LIGHTING);
+    mesh_lighting(0); mesh_color3(r, g, b); mesh_sphere(0.12, 16, 16); mesh_lighting(1);
 }
 
 void drawStarfleetSaucer(float sx, float sy, float sz) {
-    glPushMatrix(); glScalef(sx, sy, sz); drawHullDetail(glutSolidSphere_wrapper_saucer, 0.88f, 0.88f, 0.92f); glPopMatrix();
+    mesh_push(); mesh_scale(sx, sy, sz); drawHullDetail(hullSaucer, 0.88f, 0.88f, 0.92f); mesh_pop();
     
     /* Luci di posizione superiori */
-    glDisable(GL_LIGHTING);
-    glColor3f(1.0f, 0.0f, 0.0f); /* Rosso (Port) */
-    glPushMatrix(); glTranslatef(0, 0.12f, 0.2f); glutSolidSphere(0.02, 8, 8); glPopMatrix();
-    glColor3f(0.0f, 1.0f, 0.0f); /* Verde (Starboard) */
-    glPushMatrix(); glTranslatef(0, 0.12f, -0.2f); glutSolidSphere(0.02, 8, 8); glPopMatrix();
-    glEnable(GL_LIGHTING);
+    mesh_lighting(0);
+    mesh_color3(1.0f, 0.0f, 0.0f); /* Rosso (Port) */
+    mesh_push(); mesh_translate(0, 0.12f, 0.2f); mesh_sphere(0.02, 8, 8); mesh_pop();
+    mesh_color3(0.0f, 1.0f, 0.0f); /* Verde (Starboard) */
+    mesh_push(); mesh_translate(0, 0.12f, -0.2f); mesh_sphere(0.02, 8, 8); mesh_pop();
+    mesh_lighting(1);
 }
 
 void drawConstitution() {
     drawStarfleetSaucer(1.0f, 0.15f, 1.0f);
-    glDisable(GL_LIGHTING); glColor3f(0.0f, 0.5f, 1.0f); glPushMatrix(); glTranslatef(0, 0.1f, 0); glutSolidSphere(0.08, 12, 12); drawGlow(0.06, 0, 0.5, 1, 0.4); glPopMatrix(); glEnable(GL_LIGHTING);
-    glPushMatrix(); glTranslatef(-0.2f, -0.1f, 0); glScalef(0.4f, 0.3f, 0.1f); glColor3f(0.8f, 0.8f, 0.85f); glutSolidCube(0.5); glPopMatrix();
-    glPushMatrix(); glTranslatef(-0.45f, -0.25f, 0); glScalef(1.8f, 0.8f, 0.8f); drawHullDetail(glutSolidSphere_wrapper_hull, 0.8f, 0.8f, 0.85f); glPopMatrix();
-    glPushMatrix(); glTranslatef(-0.15f, -0.25f, 0); drawDeflector(1.0f, 0.4f, 0.0f); drawGlow(0.1f, 1.0f, 0.3f, 0.0f, 0.5f); glPopMatrix();
+    mesh_lighting(0); mesh_color3(0.0f, 0.5f, 1.0f); mesh_push(); mesh_translate(0, 0.1f, 0); mesh_sphere(0.08, 12, 12); drawGlow(0.06, 0, 0.5, 1, 0.4); mesh_pop(); mesh_lighting(1);
+    mesh_push(); mesh_translate(-0.2f, -0.1f, 0); mesh_scale(0.4f, 0.3f, 0.1f); mesh_color3(0.8f, 0.8f, 0.85f); mesh_cube(0.5); mesh_pop();
+    mesh_push(); mesh_translate(-0.45f, -0.25f, 0); mesh_scale(1.8f, 0.8f, 0.8f); drawHullDetail(hullSecondary, 0.8f, 0.8f, 0.85f); mesh_pop();
+    mesh_push(); mesh_translate(-0.15f, -0.25f, 0); drawDeflector(1.0f, 0.4f, 0.0f); drawGlow(0.1f, 1.0f, 0.3f, 0.0f, 0.5f); mesh_pop();
     for(int side=-1; side<=1; side+=2) {
-        glPushMatrix(); glTranslatef(-0.5f, -0.1f, side * 0.15f); glRotatef(side*30, 1, 0, 0); glScalef(0.1f, 0.4f, 0.1f); glutSolidCube(1.0); glPopMatrix();
-        glPushMatrix(); glTranslatef(-0.6f, 0.15f, side * 0.38f); drawNacelle(4.8, 0.28, 0.2, 0.5, 1.0); glPopMatrix();
+        mesh_push(); mesh_translate(-0.5f, -0.1f, side * 0.15f); mesh_rotate(side*30, 1, 0, 0); mesh_scale(0.1f, 0.4f, 0.1f); mesh_cube(1.0); mesh_pop();
+        mesh_push(); mesh_translate(-0.6f, 0.15f, side * 0.38f); drawNacelle(4.8, 0.28, 0.2, 0.5, 1.0); mesh_pop();
     }
 }
 
 void drawMiranda() { 
     drawStarfleetSaucer(1.2f, 0.18f, 1.1f);
-    glPushMatrix(); glTranslatef(-0.25f, 0.2f, 0); glScalef(0.3f, 0.5f, 0.9f); glColor3f(0.75f, 0.75f, 0.8f); glutSolidCube(0.5); glPopMatrix();
+    mesh_push(); mesh_translate(-0.25f, 0.2f, 0); mesh_scale(0.3f, 0.5f, 0.9f); mesh_color3(0.75f, 0.75f, 0.8f); mesh_cube(0.5); mesh_pop();
     for(int side=-1; side<=1; side+=2) {
-        glPushMatrix(); glTranslatef(-0.25f, 0.1f, side * 0.3f); glScalef(0.1f, 0.4f, 0.1f); glutSolidCube(1.0); glPopMatrix();
-        glPushMatrix(); glTranslatef(-0.35f, -0.15f, side * 0.45f); drawNacelle(3.8, 0.4, 0.3, 0.4, 0.8); glPopMatrix();
+        mesh_push(); mesh_translate(-0.25f, 0.1f, side * 0.3f); mesh_scale(0.1f, 0.4f, 0.1f); mesh_cube(1.0); mesh_pop();
+        mesh_push(); mesh_translate(-0.35f, -0.15f, side * 0.45f); drawNacelle(3.8, 0.4, 0.3, 0.4, 0.8); mesh_pop();
     }
 }
 
 void drawExcelsior() { 
     drawStarfleetSaucer(1.4f, 0.12f, 1.3f);
-    glPushMatrix(); glTranslatef(-0.35f, -0.15f, 0); glScalef(0.7f, 0.2f, 0.1f); glutSolidCube(0.5); glPopMatrix();
-    glPushMatrix(); glTranslatef(-0.7f, -0.3f, 0); glScalef(2.8f, 0.7f, 0.7f); drawHullDetail(glutSolidSphere_wrapper_hull, 0.8f, 0.8f, 0.85f); glPopMatrix();
-    glPushMatrix(); glTranslatef(-0.3f, -0.3f, 0); drawDeflector(0.0f, 0.6f, 1.0f); drawGlow(0.1f, 0.2f, 0.7f, 1.0f, 0.4f); glPopMatrix();
+    mesh_push(); mesh_translate(-0.35f, -0.15f, 0); mesh_scale(0.7f, 0.2f, 0.1f); mesh_cube(0.5); mesh_pop();
+    mesh_push(); mesh_translate(-0.7f, -0.3f, 0); mesh_scale(2.8f, 0.7f, 0.7f); drawHullDetail(hullSecondary, 0.8f, 0.8f, 0.85f); mesh_pop();
+    mesh_push(); mesh_translate(-0.3f, -0.3f, 0); drawDeflector(0.0f, 0.6f, 1.0f); drawGlow(0.1f, 0.2f, 0.7f, 1.0f, 0.4f); mesh_pop();
     for(int side=-1; side<=1; side+=2) {
-        glPushMatrix(); glTranslatef(-0.8f, -0.15f, side * 0.35f); drawNacelle(5.5, 0.25, 0.2, 0.6, 1.0); glPopMatrix();
+        mesh_push(); mesh_translate(-0.8f, -0.15f, side * 0.35f); drawNacelle(5.5, 0.25, 0.2, 0.6, 1.0); mesh_pop();
     }
 }
 
 void drawConstellation() {
-    glPushMatrix(); glScalef(1.2f, 0.4f, 0.9f); drawHullDetail(glutSolidCube_wrapper, 0.75f, 0.75f, 0.8f); glPopMatrix();
+    mesh_push(); mesh_scale(1.2f, 0.4f, 0.9f); drawHullDetail(hullCube, 0.75f, 0.75f, 0.8f); mesh_pop();
     for(int updown=-1; updown<=1; updown+=2) {
         for(int side=-1; side<=1; side+=2) {
-            glPushMatrix(); glTranslatef(-0.2f, updown * 0.25f, side * 0.35f); drawNacelle(3.5, 0.3, 0.5, 0.5, 0.6); glPopMatrix();
+            mesh_push(); mesh_translate(-0.2f, updown * 0.25f, side * 0.35f); drawNacelle(3.5, 0.3, 0.5, 0.5, 0.6); mesh_pop();
         }
     }
 }
 
 void drawDefiant() {
-    glPushMatrix(); glTranslatef(0.3f, 0, 0); glScalef(0.5f, 0.4f, 0.4f); drawDeflector(1.0f, 0.3f, 0.0f); drawGlow(0.15f, 1.0f, 0.2f, 0.0f, 0.4f); glPopMatrix();
-    glPushMatrix(); glScalef(1.5f, 0.5f, 1.8f); drawHullDetail(glutSolidSphere_wrapper_defiant, 0.6f, 0.6f, 0.65f); glPopMatrix();
+    mesh_push(); mesh_translate(0.3f, 0, 0); mesh_scale(0.5f, 0.4f, 0.4f); drawDeflector(1.0f, 0.3f, 0.0f); drawGlow(0.15f, 1.0f, 0.2f, 0.0f, 0.4f); mesh_pop();
+    mesh_push(); mesh_scale(1.5f, 0.5f, 1.8f); drawHullDetail(hullDefiant, 0.6f, 0.6f, 0.65f); mesh_pop();
     for(int side=-1; side<=1; side+=2) {
-        glPushMatrix(); glTranslatef(-0.1f, -0.05f, side * 0.4f); drawNacelle(2.5, 0.6, 0.2, 0.3, 0.7); glPopMatrix();
+        mesh_push(); mesh_translate(-0.1f, -0.05f, side * 0.4f); drawNacelle(2.5, 0.6, 0.2, 0.3, 0.7); mesh_pop();
     }
 }
 
 void drawGalaxy() {
     drawStarfleetSaucer(1.6f, 0.15f, 2.4f);
-    glPushMatrix(); glTranslatef(-0.4f, -0.15f, 0); glColor3f(0.85f, 0.85f, 0.9f); glScalef(0.6f, 0.5f, 0.4f); glutSolidCube(0.5); glPopMatrix();
-    glPushMatrix(); glTranslatef(-0.7f, -0.3f, 0); glScalef(2.0f, 1.0f, 1.0f); drawHullDetail(glutSolidSphere_wrapper_hull, 0.85f, 0.85f, 0.9f); glPopMatrix();
-    glPushMatrix(); glTranslatef(-0.4f, -0.35f, 0); glScalef(1.0f, 0.7f, 1.5f); drawDeflector(0.9f, 0.6f, 0.1f); drawGlow(0.12f, 0.8f, 0.5f, 0.0f, 0.5f); glPopMatrix();
+    mesh_push(); mesh_translate(-0.4f, -0.15f, 0); mesh_color3(0.85f, 0.85f, 0.9f); mesh_scale(0.6f, 0.5f, 0.4f); mesh_cube(0.5); mesh_pop();
+    mesh_push(); mesh_translate(-0.7f, -0.3f, 0); mesh_scale(2.0f, 1.0f, 1.0f); drawHullDetail(hullSecondary, 0.85f, 0.85f, 0.9f); mesh_pop();
+    mesh_push(); mesh_translate(-0.4f, -0.35f, 0); mesh_scale(1.0f, 0.7f, 1.5f); drawDeflector(0.9f, 0.6f, 0.1f); drawGlow(0.12f, 0.8f, 0.5f, 0.0f, 0.5f); mesh_pop();
     for(int side=-1; side<=1; side+=2) {
-        glPushMatrix(); glTranslatef(-0.8f, -0.05f, side * 0.65f); drawNacelle(4.0, 0.4, 0.4, 0.6, 1.0); glPopMatrix();
+        mesh_push(); mesh_translate(-0.8f, -0.05f, side * 0.65f); drawNacelle(4.0, 0.4, 0.4, 0.6, 1.0); mesh_pop();
     }
 }
 
 void drawSovereign() {
     drawStarfleetSaucer(2.2f, 0.12f, 1.3f);
-    glPushMatrix(); glTranslatef(-0.7f, -0.15f, 0); glScalef(2.5f, 0.5f, 0.6f); drawHullDetail(glutSolidSphere_wrapper_hull, 0.9f, 0.9f, 0.95f); glPopMatrix();
-    glPushMatrix(); glTranslatef(-0.3f, -0.15f, 0); drawDeflector(0.0f, 0.4f, 0.8f); drawGlow(0.1f, 0.2f, 0.6f, 1.0f, 0.4f); glPopMatrix();
+    mesh_push(); mesh_translate(-0.7f, -0.15f, 0); mesh_scale(2.5f, 0.5f, 0.6f); drawHullDetail(hullSecondary, 0.9f, 0.9f, 0.95f); mesh_pop();
+    mesh_push(); mesh_translate(-0.3f, -0.15f, 0); drawDeflector(0.0f, 0.4f, 0.8f); drawGlow(0.1f, 0.2f, 0.6f, 1.0f, 0.4f); mesh_pop();
     for(int side=-1; side<=1; side+=2) {
-        glPushMatrix(); glTranslatef(-1.0f, 0.05f, side * 0.45f); drawNacelle(6.0, 0.2, 0.2, 0.5, 1.0); glPopMatrix();
+        mesh_push(); mesh_translate(-1.0f, 0.05f, side * 0.45f); drawNacelle(6.0, 0.2, 0.2, 0.5, 1.0); mesh_pop();
     }
 }
 
 void drawIntrepid() {
     drawStarfleetSaucer(2.0f, 0.15f, 1.0f);
-    glPushMatrix(); glTranslatef(-0.6f, -0.15f, 0); glScalef(1.8f, 0.4f, 0.5f); drawHullDetail(glutSolidSphere_wrapper_hull, 0.85f, 0.85f, 0.95f); glPopMatrix();
-    glPushMatrix(); glTranslatef(-0.25f, -0.15f, 0); drawDeflector(0.0f, 0.5f, 0.9f); drawGlow(0.1f, 0.3f, 0.7f, 1.0f, 0.4f); glPopMatrix();
+    mesh_push(); mesh_translate(-0.6f, -0.15f, 0); mesh_scale(1.8f, 0.4f, 0.5f); drawHullDetail(hullSecondary, 0.85f, 0.85f, 0.95f); mesh_pop();
+    mesh_push(); mesh_translate(-0.25f, -0.15f, 0); drawDeflector(0.0f, 0.5f, 0.9f); drawGlow(0.1f, 0.3f, 0.7f, 1.0f, 0.4f); mesh_pop();
     for(int side=-1; side<=1; side+=2) {
-        glPushMatrix(); glTranslatef(-0.8f, 0.1f, side * 0.4f); glRotatef(side*25, 1, 0, 0);
-        drawNacelle(3.5, 0.25, 0.3, 0.6, 1.0); glPopMatrix();
+        mesh_push(); mesh_translate(-0.8f, 0.1f, side * 0.4f); mesh_rotate(side*25, 1, 0, 0);
+        drawNacelle(3.5, 0.25, 0.3, 0.6, 1.0); mesh_pop();
     }
 }
 
 void drawAkira() {
-    glColor3f(0.6f, 0.6f, 0.7f); glPushMatrix(); glScalef(1.4f, 0.2f, 1.8f); drawHullDetail(glutSolidSphere_wrapper_saucer, 0.6f, 0.6f, 0.7f); glPopMatrix();
+    mesh_color3(0.6f, 0.6f, 0.7f); mesh_push(); mesh_scale(1.4f, 0.2f, 1.8f); drawHullDetail(hullSaucer, 0.6f, 0.6f, 0.7f); mesh_pop();
     for(int side=-1; side<=1; side+=2) {
-        glPushMatrix(); glTranslatef(-0.6f, -0.2f, side * 0.7f); drawNacelle(4.5, 0.4, 0.4, 0.4, 0.8); glPopMatrix();
-        glPushMatrix(); glTranslatef(-0.2f, -0.1f, side * 0.5f); glRotatef(side*30, 1,0,0); glScalef(0.2f, 0.6f, 0.2f); glutSolidCube(1.0); glPopMatrix();
+        mesh_push(); mesh_translate(-0.6f, -0.2f, side * 0.7f); drawNacelle(4.5, 0.4, 0.4, 0.4, 0.8); mesh_pop();
+        mesh_push(); mesh_translate(-0.2f, -0.1f, side * 0.5f); mesh_rotate(side*30, 1,0,0); mesh_scale(0.2f, 0.6f, 0.2f); mesh_cube(1.0); mesh_pop();
     }
 }
 
 void drawNebula() {
     drawGalaxy();
-    glPushMatrix(); glTranslatef(-0.6f, 0.4f, 0); glColor3f(0.7f, 0.7f, 0.75f);
-    glPushMatrix(); glScalef(0.8f, 0.15f, 0.8f); glutSolidSphere(0.5, 24, 24); glPopMatrix();
-    glPushMatrix(); glTranslatef(0, -0.2f, 0); glScalef(0.1f, 0.4f, 0.4f); glutSolidCube(1.0); glPopMatrix();
-    glPopMatrix();
+    mesh_push(); mesh_translate(-0.6f, 0.4f, 0); mesh_color3(0.7f, 0.7f, 0.75f);
+    mesh_push(); mesh_scale(0.8f, 0.15f, 0.8f); mesh_sphere(0.5, 24, 24); mesh_pop();
+    mesh_push(); mesh_translate(0, -0.2f, 0); mesh_scale(0.1f, 0.4f, 0.4f); mesh_cube(1.0); mesh_pop();
+    mesh_pop();
 }
 
 void drawAmbassador() {
     drawStarfleetSaucer(1.4f, 0.2f, 1.4f);
-    glPushMatrix(); glTranslatef(-0.45f, -0.25f, 0); glScalef(1.6f, 0.8f, 0.8f); drawHullDetail(glutSolidSphere_wrapper_hull, 0.8f, 0.8f, 0.85f); glPopMatrix();
-    glPushMatrix(); glTranslatef(-0.15f, -0.25f, 0); drawDeflector(0.0f, 0.3f, 0.7f); drawGlow(0.1f, 0.2f, 0.5f, 1.0f, 0.4f); glPopMatrix();
+    mesh_push(); mesh_translate(-0.45f, -0.25f, 0); mesh_scale(1.6f, 0.8f, 0.8f); drawHullDetail(hullSecondary, 0.8f, 0.8f, 0.85f); mesh_pop();
+    mesh_push(); mesh_translate(-0.15f, -0.25f, 0); drawDeflector(0.0f, 0.3f, 0.7f); drawGlow(0.1f, 0.2f, 0.5f, 1.0f, 0.4f); mesh_pop();
     for(int side=-1; side<=1; side+=2) {
-        glPushMatrix(); glTranslatef(-0.7f, 0.05f, side * 0.45f); drawNacelle(4.5, 0.35, 0.3, 0.4, 0.9); glPopMatrix();
+        mesh_push(); mesh_translate(-0.7f, 0.05f, side * 0.45f); drawNacelle(4.5, 0.35, 0.3, 0.4, 0.9); mesh_pop();
     }
 }
 
 void drawOberth() {
-    glColor3f(0.9f, 0.9f, 0.9f); glPushMatrix(); glScalef(1.1f, 0.15f, 0.9f); drawHullDetail(glutSolidSphere_wrapper_saucer, 0.9f, 0.9f, 0.9f); glPopMatrix();
-    glPushMatrix(); glTranslatef(0, -0.5f, 0); glScalef(1.2f, 0.3f, 0.6f); glutSolidSphere(0.2, 12, 12); glPopMatrix();
+    mesh_color3(0.9f, 0.9f, 0.9f); mesh_push(); mesh_scale(1.1f, 0.15f, 0.9f); drawHullDetail(hullSaucer, 0.9f, 0.9f, 0.9f); mesh_pop();
+    mesh_push(); mesh_translate(0, -0.5f, 0); mesh_scale(1.2f, 0.3f, 0.6f); mesh_sphere(0.2, 12, 12); mesh_pop();
     for(int side=-1; side<=1; side+=2) {
-        glPushMatrix(); glTranslatef(0, -0.25f, side * 0.35f); glScalef(0.15f, 0.6f, 0.1f); glutSolidCube(1.0); glPopMatrix();
-        glPushMatrix(); glTranslatef(-0.35f, -0.25f, side * 0.4f); drawNacelle(2.5, 0.2, 0.4, 0.4, 0.7); glPopMatrix();
+        mesh_push(); mesh_translate(0, -0.25f, side * 0.35f); mesh_scale(0.15f, 0.6f, 0.1f); mesh_cube(1.0); mesh_pop();
+        mesh_push(); mesh_translate(-0.35f, -0.25f, side * 0.4f); drawNacelle(2.5, 0.2, 0.4, 0.4, 0.7); mesh_pop();
     }
 }
 
 void drawSteamrunner() {
-    glColor3f(0.6f, 0.6f, 0.65f); glPushMatrix(); glScalef(1.6f, 0.25f, 1.5f); drawHullDetail(glutSolidSphere_wrapper_saucer, 0.6f, 0.6f, 0.65f); glPopMatrix();
+    mesh_color3(0.6f, 0.6f, 0.65f); mesh_push(); mesh_scale(1.6f, 0.25f, 1.5f); drawHullDetail(hullSaucer, 0.6f, 0.6f, 0.65f); mesh_pop();
     for(int side=-1; side<=1; side+=2) {
-        glPushMatrix(); glTranslatef(-0.7f, -0.05f, side * 0.55f); drawNacelle(3.5, 0.3, 0.2, 0.3, 0.6); glPopMatrix();
-        glPushMatrix(); glTranslatef(-0.8f, 0, 0); glScalef(0.1f, 0.1f, 1.0f); glutSolidCube(1.0); glPopMatrix();
+        mesh_push(); mesh_translate(-0.7f, -0.05f, side * 0.55f); drawNacelle(3.5, 0.3, 0.2, 0.3, 0.6); mesh_pop();
+        mesh_push(); mesh_translate(-0.8f, 0, 0); mesh_scale(0.1f, 0.1f, 1.0f); mesh_cube(1.0); mesh_pop();
     }
 }
 
-void drawFederationShip(int class, float h, float m) {
-    glRotatef(h - 90.0f, 0, 1, 0);
-    glRotatef(m, 0, 0, 1);
+void drawFederationShip(int class) {
     switch(class) {
         case SHIP_CLASS_CONSTITUTION: drawConstitution(); break;
         case SHIP_CLASS_MIRANDA:      drawMiranda(); break;
@@ -569,371 +772,450 @@ void drawFederationShip(int class, float h, float m) {
     }
 }
 
-void drawKlingon(float x, float y, float z) {
-    glPushMatrix(); glColor3f(0.6f, 0.1f, 0.0f); glScalef(1.0f, 0.3f, 1.5f); glutSolidSphere(0.3, 16, 16); glPopMatrix();
-    glPushMatrix(); glTranslatef(0.4f, 0, 0); glScalef(2.0f, 0.2f, 0.2f); glutSolidSphere(0.15, 8, 8); glPopMatrix();
-    glColor3f(0.8f, 0.0f, 0.0f); glPushMatrix(); glTranslatef(0.7f, 0, 0); glScalef(1.0f, 0.5f, 1.2f); glutSolidSphere(0.15, 12, 12); glPopMatrix();
+void drawKlingon() {
+    mesh_push(); mesh_color3(0.6f, 0.1f, 0.0f); mesh_scale(1.0f, 0.3f, 1.5f); mesh_sphere(0.3, 16, 16); mesh_pop();
+    mesh_push(); mesh_translate(0.4f, 0, 0); mesh_scale(2.0f, 0.2f, 0.2f); mesh_sphere(0.15, 8, 8); mesh_pop();
+    mesh_color3(0.8f, 0.0f, 0.0f); mesh_push(); mesh_translate(0.7f, 0, 0); mesh_scale(1.0f, 0.5f, 1.2f); mesh_sphere(0.15, 12, 12); mesh_pop();
 }
 
-void drawRomulan(float x, float y, float z) {
-    glColor3f(0.0f, 0.5f, 0.0f); glPushMatrix(); glScalef(1.5f, 0.2f, 1.0f); glutSolidSphere(0.4, 16, 16); glPopMatrix();
-    glPushMatrix(); glTranslatef(0, 0.25f, 0); glScalef(1.5f, 0.2f, 0.8f); glutSolidSphere(0.35, 16, 16); glPopMatrix();
-    glPushMatrix(); glTranslatef(0.4f, 0.1f, 0); glScalef(1.0f, 0.5f, 0.2f); glutSolidCube(0.3); glPopMatrix();
-    glColor3f(0.0f, 0.7f, 0.2f); glPushMatrix(); glTranslatef(0.7f, 0.1f, 0); glutSolidCone(0.1, 0.3, 8, 8); glPopMatrix();
+void drawRomulan() {
+    mesh_color3(0.0f, 0.5f, 0.0f); mesh_push(); mesh_scale(1.5f, 0.2f, 1.0f); mesh_sphere(0.4, 16, 16); mesh_pop();
+    mesh_push(); mesh_translate(0, 0.25f, 0); mesh_scale(1.5f, 0.2f, 0.8f); mesh_sphere(0.35, 16, 16); mesh_pop();
+    mesh_push(); mesh_translate(0.4f, 0.1f, 0); mesh_scale(1.0f, 0.5f, 0.2f); mesh_cube(0.3); mesh_pop();
+    mesh_color3(0.0f, 0.7f, 0.2f); mesh_push(); mesh_translate(0.7f, 0.1f, 0); mesh_cone(0.1, 0.3, 8, 8); mesh_pop();
 }
 
-void drawBorg(float x, float y, float z) {
-    glRotatef(pulse*5, 1, 1, 1); glColor3f(0.15f, 0.15f, 0.15f); glutWireCube(0.85);
-    glColor3f(0.05f, 0.05f, 0.05f); glutSolidCube(0.75); glDisable(GL_LIGHTING);
-    float p = (sin(pulse)+1.0f)*0.5f; glColor4f(0.0f, 0.8f * p, 0.0f, 0.6f); glutWireCube(0.8);
+void drawBorg() {
+    mesh_color3(0.15f, 0.15f, 0.15f); mesh_wire_cube(0.85);
+    mesh_color3(0.05f, 0.05f, 0.05f); mesh_cube(0.75); mesh_lighting(0);
+    mesh_animate(1, 0); mesh_color4(0.0f, 0.8f, 0.0f, 0.6f); mesh_wire_cube(0.8); mesh_animate(0, 0); /* Pulses green */
     for(int i=0; i<6; i++) {
-        glPushMatrix(); if(i==0) glTranslatef(0.38,0,0); else if(i==1) glTranslatef(-0.38,0,0); else if(i==2) glTranslatef(0,0.38,0); else if(i==3) glTranslatef(0,-0.38,0); else if(i==4) glTranslatef(0,0,0.38); else if(i==5) glTranslatef(0,0,-0.38);
-        glColor3f(0, 1, 0); glutSolidSphere(0.04, 8, 8); drawGlow(0.03, 0, 1, 0, 0.4); glPopMatrix();
+        mesh_push(); if(i==0) mesh_translate(0.38,0,0); else if(i==1) mesh_translate(-0.38,0,0); else if(i==2) mesh_translate(0,0.38,0); else if(i==3) mesh_translate(0,-0.38,0); else if(i==4) mesh_translate(0,0,0.38); else if(i==5) mesh_translate(0,0,-0.38);
+        mesh_color3(0, 1, 0); mesh_sphere(0.04, 8, 8); drawGlow(0.03, 0, 1, 0, 0.4); mesh_pop();
     }
-    glEnable(GL_LIGHTING);
+    mesh_lighting(1);
 }
 
-void drawCardassian(float x, float y, float z) {
-    glColor3f(0.6f, 0.5f, 0.3f); glPushMatrix(); glScalef(2.0f, 0.2f, 1.2f); glutSolidSphere(0.4, 16, 16); glPopMatrix();
-    glColor3f(0.8f, 0.7f, 0.2f); glPushMatrix(); glTranslatef(0.5f, 0, 0); glScalef(1.0f, 0.4f, 0.4f); glutSolidSphere(0.2, 12, 12); glPopMatrix();
+void drawCardassian() {
+    mesh_color3(0.6f, 0.5f, 0.3f); mesh_push(); mesh_scale(2.0f, 0.2f, 1.2f); mesh_sphere(0.4, 16, 16); mesh_pop();
+    mesh_color3(0.8f, 0.7f, 0.2f); mesh_push(); mesh_translate(0.5f, 0, 0); mesh_scale(1.0f, 0.4f, 0.4f); mesh_sphere(0.2, 12, 12); mesh_pop();
 }
 
-void drawJemHadar(float x, float y, float z) {
-    glColor3f(0.4f, 0.4f, 0.6f); glPushMatrix(); glScalef(1.2f, 0.5f, 1.0f); glutSolidSphere(0.35, 12, 12); glPopMatrix();
-    glPushMatrix(); glTranslatef(0.4f, 0, 0.15f); glutSolidCone(0.05, 0.3, 8, 8); glPopMatrix();
-    glPushMatrix(); glTranslatef(0.4f, 0, -0.15f); glutSolidCone(0.05, 0.3, 8, 8); glPopMatrix();
+void drawJemHadar() {
+    mesh_color3(0.4f, 0.4f, 0.6f); mesh_push(); mesh_scale(1.2f, 0.5f, 1.0f); mesh_sphere(0.35, 12, 12); mesh_pop();
+    mesh_push(); mesh_translate(0.4f, 0, 0.15f); mesh_cone(0.05, 0.3, 8, 8); mesh_pop();
+    mesh_push(); mesh_translate(0.4f, 0, -0.15f); mesh_cone(0.05, 0.3, 8, 8); mesh_pop();
 }
 
-void drawTholian(float x, float y, float z) {
-    glRotatef(pulse*15, 0, 1, 0); glColor4f(1.0f, 0.5f, 0.0f, 0.6f); glDisable(GL_LIGHTING); glutWireOctahedron();
-    glColor4f(1.0f, 0.2f, 0.0f, 0.4f); glutSolidOctahedron(); glEnable(GL_LIGHTING);
+void drawTholian() {
+    mesh_color4(1.0f, 0.5f, 0.0f, 0.6f); mesh_lighting(0); mesh_wire_octahedron();
+    mesh_color4(1.0f, 0.2f, 0.0f, 0.4f); mesh_octahedron(); mesh_lighting(1);
 }
 
-void drawGorn(float x, float y, float z) {
-    glColor3f(0.3f, 0.4f, 0.1f); glPushMatrix(); glScalef(1.5f, 0.6f, 0.6f); glutSolidCube(0.4); glPopMatrix();
-    glPushMatrix(); glTranslatef(-0.3f, 0, 0); glScalef(0.5f, 1.2f, 1.5f); glutSolidCube(0.3); glPopMatrix();
+void drawGorn() {
+    mesh_color3(0.3f, 0.4f, 0.1f); mesh_push(); mesh_scale(1.5f, 0.6f, 0.6f); mesh_cube(0.4); mesh_pop();
+    mesh_push(); mesh_translate(-0.3f, 0, 0); mesh_scale(0.5f, 1.2f, 1.5f); mesh_cube(0.3); mesh_pop();
 }
 
-void drawFerengi(float x, float y, float z) {
-    glColor3f(0.7f, 0.3f, 0.1f); glPushMatrix(); glScalef(1.0f, 0.2f, 2.0f); glutSolidSphere(0.4, 16, 16); glPopMatrix();
-    glPushMatrix(); glTranslatef(0.3f, 0, 0); glScalef(1.2f, 0.4f, 0.6f); glutSolidSphere(0.3, 12, 12); glPopMatrix();
+void drawFerengi() {
+    mesh_color3(0.7f, 0.3f, 0.1f); mesh_push(); mesh_scale(1.0f, 0.2f, 2.0f); mesh_sphere(0.4, 16, 16); mesh_pop();
+    mesh_push(); mesh_translate(0.3f, 0, 0); mesh_scale(1.2f, 0.4f, 0.6f); mesh_sphere(0.3, 12, 12); mesh_pop();
 }
 
-void drawSpecies8472(float x, float y, float z) {
-    glRotatef(pulse*10, 1, 0, 1); glColor3f(0.8f, 0.8f, 0.2f); for(int i=0; i<3; i++) { glPushMatrix(); glRotatef(i*120, 0, 1, 0); glTranslatef(0.3f, 0, 0); glScalef(2.0f, 0.3f, 0.3f); glutSolidSphere(0.15, 12, 12); glPopMatrix(); }
-    glutSolidSphere(0.2, 12, 12);
+void drawSpecies8472() {
+    mesh_color3(0.8f, 0.8f, 0.2f); for(int i=0; i<3; i++) { mesh_push(); mesh_rotate(i*120, 0, 1, 0); mesh_translate(0.3f, 0, 0); mesh_scale(2.0f, 0.3f, 0.3f); mesh_sphere(0.15, 12, 12); mesh_pop(); }
+    mesh_sphere(0.2, 12, 12);
 }
 
-void drawBreen(float x, float y, float z) {
-    glColor3f(0.4f, 0.5f, 0.4f); glPushMatrix(); glScalef(1.8f, 0.2f, 0.8f); glutSolidCube(0.4); glPopMatrix();
-    glPushMatrix(); glTranslatef(0.2f, 0.1f, 0.2f); glScalef(0.5f, 0.5f, 1.2f); glutSolidSphere(0.2, 8, 8); glPopMatrix();
+void drawBreen() {
+    mesh_color3(0.4f, 0.5f, 0.4f); mesh_push(); mesh_scale(1.8f, 0.2f, 0.8f); mesh_cube(0.4); mesh_pop();
+    mesh_push(); mesh_translate(0.2f, 0.1f, 0.2f); mesh_scale(0.5f, 0.5f, 1.2f); mesh_sphere(0.2, 8, 8); mesh_pop();
 }
 
-void drawHirogen(float x, float y, float z) {
-    glColor3f(0.5f, 0.5f, 0.5f); glPushMatrix(); glScalef(2.5f, 0.15f, 0.4f); glutSolidSphere(0.35, 12, 12); glPopMatrix();
-    glPushMatrix(); glTranslatef(-0.4f, 0, 0); glScalef(0.5f, 0.8f, 1.5f); glutSolidCube(0.2); glPopMatrix();
+void drawHirogen() {
+    mesh_color3(0.5f, 0.5f, 0.5f); mesh_push(); mesh_scale(2.5f, 0.15f, 0.4f); mesh_sphere(0.35, 12, 12); mesh_pop();
+    mesh_push(); mesh_translate(-0.4f, 0, 0); mesh_scale(0.5f, 0.8f, 1.5f); mesh_cube(0.2); mesh_pop();
 }
 
-void drawStarbase(float x, float y, float z) {
-    glRotatef(pulse*10, 0, 1, 0); glColor3f(0.9f, 0.9f, 0.1f); glutWireSphere(0.4, 12, 12);
-    glColor3f(0.5f, 0.5f, 0.5f); glPushMatrix(); glScalef(1.5f, 0.1f, 1.5f); glutSolidCube(0.6); glPopMatrix();
+void drawStarbase() {
+    mesh_color3(0.9f, 0.9f, 0.1f); mesh_wire_sphere(0.4, 12, 12);
+    mesh_color3(0.5f, 0.5f, 0.5f); mesh_push(); mesh_scale(1.5f, 0.1f, 1.5f); mesh_cube(0.6); mesh_pop();
 }
 
-void drawStar(float x, float y, float z) {
-    glPushMatrix();
+void drawStar() {
+    mesh_push();
     /* Core (Bright White-Yellow) */
-    glDisable(GL_LIGHTING);
-    glColor3f(1.0f, 1.0f, 0.8f); 
-    glutSolidSphere(0.2, 16, 16);
+    mesh_lighting(0);
+    mesh_color3(1.0f, 1.0f, 0.8f); 
+    mesh_sphere(0.2, 16, 16);
     
     /* Corona / Halo (Pulsing Yellow-Orange) */
-    float p = 1.0f + sin(pulse * 3.0f) * 0.1f; /* Pulsazione */
+    mesh_animate(0, 1);
     
     /* Inner Corona */
-    glColor4f(1.0f, 0.8f, 0.0f, 0.4f);
-    glutSolidSphere(0.35 * p, 24, 24);
+    mesh_color4(1.0f, 0.8f, 0.0f, 0.4f);
+    mesh_sphere(0.35, 24, 24);
     
     /* Outer Corona (Fading) */
-    glColor4f(1.0f, 0.6f, 0.0f, 0.2f);
-    glutSolidSphere(0.6 * p, 24, 24);
+    mesh_color4(1.0f, 0.6f, 0.0f, 0.2f);
+    mesh_sphere(0.6, 24, 24);
+    mesh_animate(0, 0);
 
-    glEnable(GL_LIGHTING);
-    glPopMatrix();
+    mesh_lighting(1);
+    mesh_pop();
 }
 
-void drawPlanet(float x, float y, float z) {
-    glRotatef(pulse*5, 0, 1, 0); glColor3f(0.2f, 0.6f, 0.3f); glutSolidSphere(0.6, 24, 24);
-    glDisable(GL_LIGHTING); glColor4f(0.4f, 0.8f, 1.0f, 0.3f); glutSolidSphere(0.65, 24, 24); glEnable(GL_LIGHTING);
+void drawPlanet() {
+    mesh_color3(0.2f, 0.6f, 0.3f); mesh_sphere(0.6, 24, 24);
+    mesh_lighting(0); mesh_color4(0.4f, 0.8f, 1.0f, 0.3f); mesh_sphere(0.65, 24, 24); mesh_lighting(1);
 }
 
-void drawBlackHole(float x, float y, float z) {
-    glPushMatrix();
-    glTranslatef(x, y, z);
+void drawBlackHole() {
+    mesh_push();
     
     /* Event Horizon - Solid Black */
-    glDisable(GL_LIGHTING);
-    glColor3f(0.0f, 0.0f, 0.0f);
-    glutSolidSphere(0.4, 32, 32);
+    mesh_lighting(0);
+    mesh_color3(0.0f, 0.0f, 0.0f);
+    mesh_sphere(0.4, 32, 32);
     
-    /* Accretion Disk - Rotating Rings */
-    glRotatef(pulse*20, 1, 1, 0);
+    /* Accretion Disk - Rotating Rings (the whole model spins: the spheres don't show it) */
+    mesh_animate(0, 1);
     for(int i=0; i<5; i++) {
-        float r = 0.5f + i*0.15f + sin(pulse*2)*0.05f;
-        glColor4f(0.6f - i*0.1f, 0.0f, 0.8f, 0.5f - i*0.1f);
-        glutWireTorus(0.02, r, 10, 40);
+        float r = 0.5f + i*0.15f;
+        mesh_color4(0.6f - i*0.1f, 0.0f, 0.8f, 0.5f - i*0.1f);
+        mesh_wire_torus(0.02, r, 10, 40);
     }
+    mesh_animate(0, 0);
     
     /* Gravitational Lensing / Glow */
-    glColor4f(0.3f, 0.0f, 0.5f, 0.2f);
-    glutSolidSphere(1.2, 20, 20);
+    mesh_color4(0.3f, 0.0f, 0.5f, 0.2f);
+    mesh_sphere(1.2, 20, 20);
     
-    glEnable(GL_LIGHTING);
-    glPopMatrix();
-}
-
-void drawGrid() {
-    glDisable(GL_LIGHTING); glColor4f(0.5f, 0.5f, 0.5f, 0.2f);
-    if (vbo_grid != 0) { glEnableClientState(GL_VERTEX_ARRAY); glBindBuffer(GL_ARRAY_BUFFER, vbo_grid); glVertexPointer(3, GL_FLOAT, 0, 0); glDrawArrays(GL_LINES, 0, grid_vertex_count); glBindBuffer(GL_ARRAY_BUFFER, 0); glDisableClientState(GL_VERTEX_ARRAY); }
-    glEnable(GL_LIGHTING);
-}
-
-void drawShipTrail(int obj_idx) {
-    glDisable(GL_LIGHTING);
-    glLineWidth(2.0f);
-    glBegin(GL_LINE_STRIP);
-    
-    float r=0.4, g=0.7, b=1.0; /* Default Starfleet Blue */
-    if (objects[obj_idx].type == 10) { r=1.0; g=0.1; b=0.0; } /* Klingon Red */
-    if (objects[obj_idx].type == 11) { r=0.0; g=1.0; b=0.2; } /* Romulan Green */
-    if (objects[obj_idx].type == 12) { r=0.0; g=0.8; b=0.8; } /* Borg Cyan */
-
-    for (int i = 0; i < objects[obj_idx].trail_count; i++) {
-        int idx = (objects[obj_idx].trail_ptr - 1 - i + MAX_TRAIL) % MAX_TRAIL;
-        float alpha = (1.0f - (float)i / objects[obj_idx].trail_count) * 0.5f;
-        glColor4f(r, g, b, alpha);
-        glVertex3f(objects[obj_idx].trail[idx][0], objects[obj_idx].trail[idx][1], objects[obj_idx].trail[idx][2]);
-    }
-    glEnd();
-    glEnable(GL_LIGHTING);
-}
-
-void drawPhaserBeams() {
-    glDisable(GL_LIGHTING);
-    for (int i = 0; i < 10; i++) {
-        if (beams[i].alpha > 0) {
-            glLineWidth(4.0f); glColor4f(1.0f, 0.8f, 0.0f, (beams[i].alpha > 1.0f) ? 1.0f : beams[i].alpha);
-            glBegin(GL_LINES); glVertex3f(enterpriseX, enterpriseY, enterpriseZ); glVertex3f(beams[i].x, beams[i].y, beams[i].z); glEnd();
-        }
-    }
-    glEnable(GL_LIGHTING);
-}
-
-void drawExplosion() {
-    if (g_boom.timer <= 0) return;
-    glDisable(GL_LIGHTING);
-    glPushMatrix(); glTranslatef(g_boom.x, g_boom.y, g_boom.z);
-    /* Pulsing expansion */
-    float s = 0.5f + (40 - g_boom.timer) * 0.05f;
-    float alpha = g_boom.timer / 40.0f;
-    glColor4f(1.0f, 0.5f, 0.0f, alpha); 
-    glutSolidSphere(s, 16, 16);
-    glPopMatrix(); glEnable(GL_LIGHTING);
+    mesh_lighting(1);
+    mesh_pop();
 }
 
 void drawTorpedo() {
-    if (!g_torp.active) return;
-    glDisable(GL_LIGHTING);
-    glPushMatrix(); glTranslatef(g_torp.x, g_torp.y, g_torp.z);
+    mesh_lighting(0);
     
     /* Core */
-    glColor3f(1.0f, 0.8f, 0.6f); 
-    glutSolidSphere(0.08, 8, 8);
+    mesh_color3(1.0f, 0.8f, 0.6f); 
+    mesh_sphere(0.08, 8, 8);
     
     /* Glow */
     drawGlow(0.15f, 1.0f, 0.2f, 0.0f, 0.6f);
     
-    glPopMatrix(); glEnable(GL_LIGHTING);
-}
-
-void drawDismantle() {
-    if (g_dismantle.timer <= 0) return;
-    glDisable(GL_LIGHTING);
-    glPointSize(3.0f);
-    glBegin(GL_POINTS);
-    for(int i=0; i<100; i++) {
-        if (g_dismantle.particles[i].active) {
-            glColor4f(g_dismantle.particles[i].r, g_dismantle.particles[i].g, g_dismantle.particles[i].b, g_dismantle.timer/60.0f);
-            glVertex3f(g_dismantle.particles[i].x, g_dismantle.particles[i].y, g_dismantle.particles[i].z);
-        }
+    mesh_lighting(1);
+}
+
+/* Baked models: one per Starfleet class, then species 10-20, then the fixed bodies */
+enum {
+    MODEL_FED = 0,
+    MODEL_ALIEN = MODEL_FED + SHIP_CLASS_GENERIC_ALIEN,
+    MODEL_STARBASE = MODEL_ALIEN + 11,
+    MODEL_STAR,
+    MODEL_PLANET,
+    MODEL_BLACKHOLE,
+    MODEL_TORPEDO,
+    MODEL_COUNT
+};
+
+void bakeModels() {
+    void (*alien[11])() = {drawKlingon, drawRomulan, drawBorg, drawCardassian, drawJemHadar, drawTholian,
+                           drawGorn, drawFerengi, drawSpecies8472, drawBreen, drawHirogen};
+    void (*body[5])() = {drawStarbase, drawStar, drawPlanet, drawBlackHole, drawTorpedo};
+    for (int lod = 0; lod < MESH_LODS; lod++) {
+        for (int c = 0; c < SHIP_CLASS_GENERIC_ALIEN; c++) { mesh_begin(MODEL_FED + c, lod); drawFederationShip(c); mesh_end(); }
+        for (int i = 0; i < 11; i++) { mesh_begin(MODEL_ALIEN + i, lod); alien[i](); mesh_end(); }
+        for (int i = 0; i < 5; i++) { mesh_begin(MODEL_STARBASE + i, lod); body[i](); mesh_end(); }
     }
-    glEnd();
-    glEnable(GL_LIGHTING);
 }
 
+int objectModel(int type, int ship_class) {
+    if (type == 1) return MODEL_FED + ((ship_class >= 0 && ship_class < SHIP_CLASS_GENERIC_ALIEN) ? ship_class : SHIP_CLASS_CONSTITUTION);
+    if (type >= 3 && type <= 6) return MODEL_STARBASE + type - 3;
+    if (type >= 10 && type <= 20) return MODEL_ALIEN + type - 10;
+    return -1;
+}
+
+/* What the immediate-mode routines animated with `pulse`: whole-model spins, Borg glow, star and disk breathing */
+void modelAnimation(MeshInstance *in) {
+    in->anim[0] = in->anim[1] = 1.0f;
+    switch (in->model) {
+        case MODEL_ALIEN + 2: mat4_rotate(in->m, pulse*5, 1, 1, 1); in->anim[0] = (sin(pulse)+1.0f)*0.5f; break;
+        case MODEL_ALIEN + 5: mat4_rotate(in->m, pulse*15, 0, 1, 0); break;
+        case MODEL_ALIEN + 8: mat4_rotate(in->m, pulse*10, 1, 0, 1); break;
+        case MODEL_STARBASE:  mat4_rotate(in->m, pulse*10, 0, 1, 0); break;
+        case MODEL_STAR:      in->anim[1] = 1.0f + sin(pulse * 3.0f) * 0.1f; break;
+        case MODEL_PLANET:    mat4_rotate(in->m, pulse*5, 0, 1, 0); break;
+        case MODEL_BLACKHOLE: mat4_rotate(in->m, pulse*20, 1, 1, 0); in->anim[1] = 1.0f + sin(pulse*2) * 0.06f; break;
+    }
+}
+
+void drawGrid() { vgl_call(list_grid); }
+
+/* Instances of the frame on screen, kept for picking: batch_id is the universal id, -1 if not a target */
+MeshInstance batch[MAX_OBJECTS + 1];
+int batch_id[MAX_OBJECTS + 1], batch_count = 0;
+
+/* Click-to-lock: a ray from window pixel (x, y), top-left origin, through the frame on screen. Returns the id or -1 */
+int pickAt(int x, int y) {
+    static PickSphere spheres[MAX_OBJECTS + 1];
+    int n = 0;
+    for (int i = 0; i < batch_count; i++) {
+        const MeshInstance *in = &batch[i];
+        if (batch_id[i] < 0 || in->lod < 0) continue;
+        float r = mesh_radius(in->model) * sqrtf(in->m[0]*in->m[0] + in->m[1]*in->m[1] + in->m[2]*in->m[2]);
+        spheres[n++] = (PickSphere){{in->m[12], in->m[13], in->m[14]}, r, batch_id[i]};
+    }
+    pick_update(spheres, n);
+    /* Eye-space direction from the projection, then back through the rigid camera: transposed rotation */
+    const ViewFrame *fr = vgl_current();
+    const float *v = fr->view;
+    float nx = 2.0f * (x + 0.5f) / win_w - 1.0f, ny = 1.0f - 2.0f * (y + 0.5f) / win_h;
+    float eye[3] = {nx / fr->proj[0], ny / fr->proj[5], -1.0f}, org[3], dir[3];
+    for (int c = 0; c < 3; c++) {
+        dir[c] = v[c*4]*eye[0] + v[c*4 + 1]*eye[1] + v[c*4 + 2]*eye[2];
+        org[c] = -(v[c*4]*v[12] + v[c*4 + 1]*v[13] + v[c*4 + 2]*v[14]);
+    }
+    return pick_ray(org, dir, NULL);
+}
+
+typedef struct { float d2; int slot; } TagOrder;
+static int cmpTag(const void *a, const void *b) { float x = ((const TagOrder *)a)->d2, y = ((const TagOrder *)b)->d2; return (x > y) - (x < y); }
+
 void display() {
-    if (g_data_dirty) { loadGameState(); g_data_dirty = 0; }
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); glLoadIdentity(); glTranslatef(0, 0, zoom); glRotatef(angleX, 1, 0, 0); glRotatef(angleY, 0, 1, 0);
-    glDisable(GL_LIGHTING);
-    if (vbo_stars != 0) { glColor3f(0.7,0.7,0.7); glEnableClientState(GL_VERTEX_ARRAY); glBindBuffer(GL_ARRAY_BUFFER, vbo_stars); glVertexPointer(3, GL_FLOAT, 0, 0); glDrawArrays(GL_POINTS, 0, 1000); glBindBuffer(GL_ARRAY_BUFFER, 0); glDisableClientState(GL_VERTEX_ARRAY); }
-    glColor3f(0.2, 0.2, 0.5); glutWireCube(11.0);
+    if (g_shared_state) {
+        g_show_axes = __atomic_load_n(&g_shared_state->shm_show_axes, __ATOMIC_ACQUIRE);
+        g_show_grid = __atomic_load_n(&g_shared_state->shm_show_grid, __ATOMIC_ACQUIRE);
+    }
+    double t0 = shm_now_ms();
+    qual_frame_begin();
+    g_redraw = 0;
+    drawn_change_seq = __atomic_load_n(&view_change_seq, __ATOMIC_ACQUIRE);
+    if (g_headless) ingestPoll();
+    consumeView();
+    interpolateObjects(g_headless ? g_bench_clock : t0);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    qual_scene_begin(win_w, win_h);
+    /* Camera into the Frame uniform block: no matrix stack */
+    float view[16], proj[16];
+    mat4_identity(view); mat4_translate(view, 0, 0, zoom); mat4_rotate(view, angleX, 1, 0, 0); mat4_rotate(view, angleY, 0, 1, 0);
+    mat4_identity(proj); mat4_perspective(proj, 45, (float)win_w / win_h, 1, 500);
+    vgl_frame(view, proj, win_w, win_h);
+
+    vgl_call(list_stars);
+    vgl_call(list_sector);
     if (g_show_axes) drawCompass();
     if (g_show_grid) drawGrid();
-    
-    drawPhaserBeams();
-    drawExplosion();
-    drawTorpedo();
-    drawDismantle();
+    vgl_flush();
+    trail_draw();
 
-    /* Render Trails */
-    for(int k=0; k<objectCount; k++) {
-        if (objects[k].type == 1 || objects[k].type >= 10) drawShipTrail(k);
-    }
-
-    glEnable(GL_LIGHTING);
+    /* Every object of a model in one instanced draw per LOD, off-screen ones culled */
+    int n = 0, slot[MAX_OBJECTS];
     for(int i=0; i<objectCount; i++) {
-        glPushMatrix(); glTranslatef(objects[i].x, objects[i].y, objects[i].z);
-        if (objects[i].type == 1) { 
-            if (i == 0 && g_shared_state->is_cloaked) { glEnable(GL_BLEND); glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA); glColor4f(0.5f, 0.8f, 1.0f, 0.3f); }
-            drawFederationShip(objects[i].ship_class, objects[i].h, objects[i].m);
-            if (i == 0 && g_shared_state->is_cloaked) glDisable(GL_BLEND);
-        } else {
-            glRotatef(objects[i].h - 90.0f, 0, 1, 0); glRotatef(objects[i].m, 0, 0, 1);
-            switch(objects[i].type) {
-                case 3: drawStarbase(0,0,0); break;
-                case 4: drawStar(0,0,0); break;
-                case 5: drawPlanet(0,0,0); break;
-                case 6: drawBlackHole(0,0,0); break;
-                case 10: drawKlingon(0,0,0); break;
-                case 11: drawRomulan(0,0,0); break;
-                case 12: drawBorg(0,0,0); break;
-                case 13: drawCardassian(0,0,0); break;
-                case 14: drawJemHadar(0,0,0); break;
-                case 15: drawTholian(0,0,0); break;
-                case 16: drawGorn(0,0,0); break;
-                case 17: drawFerengi(0,0,0); break;
-                case 18: drawSpecies8472(0,0,0); break;
-                case 19: drawBreen(0,0,0); break;
-                case 20: drawHirogen(0,0,0); break;
-            }
-        }
-        glPopMatrix();
+        const GameObject *o = &objects[scene[i]];
+        int model = objectModel(o->type, o->ship_class);
+        slot[i] = -1;
+        if (model < 0) continue;
+        slot[i] = n;
+        batch_id[n] = i == 0 ? -1 : o->id;                       /* Our own ship is not a target */
+        MeshInstance *in = &batch[n++];
+        in->model = model;
+        mat4_identity(in->m); mat4_translate(in->m, o->x, o->y, o->z);
+        mat4_rotate(in->m, o->h - 90.0f, 0, 1, 0); mat4_rotate(in->m, o->m, 0, 0, 1);
+        modelAnimation(in);
+        float cloak[4] = {0.5f, 0.8f, 1.0f, 0.3f}, plain[4] = {1, 1, 1, 1};
+        memcpy(in->tint, (i == 0 && o->type == 1 && g_is_cloaked) ? cloak : plain, sizeof(in->tint));
     }
+    if (g_torp.active) {
+        batch_id[n] = -1;
+        MeshInstance *in = &batch[n++];
+        in->model = MODEL_TORPEDO;
+        mat4_identity(in->m); mat4_translate(in->m, g_torp.x, g_torp.y, g_torp.z);
+        in->tint[0] = in->tint[1] = in->tint[2] = in->tint[3] = 1.0f;
+        in->anim[0] = in->anim[1] = 1.0f;
+    }
+    mesh_cull(batch, n);
+    mesh_draw(batch, n);
+    batch_count = n;
+    fx_draw();
+    qual_scene_end(win_w, win_h);
     
-    /* Draw HUD Overlay */
+    /* Draw HUD Overlay: tags, bars and status text go out in one draw */
     if (g_show_hud) {
+        /* Under load only the tags nearest to our ship */
+        static TagOrder tags[MAX_OBJECTS];
+        int nt = 0;
         for(int i=0; i<objectCount; i++) {
-            if (objects[i].type != 0 && !g_is_loading) {
-                drawHUD(objects[i].x, objects[i].y, objects[i].z, objects[i].type, objects[i].id, objects[i].health_pct);
-            }
+            const GameObject *o = &objects[scene[i]];
+            if (o->type == 0 || (slot[i] >= 0 && batch[slot[i]].lod < 0)) continue;
+            float dx = o->x - enterpriseX, dy = o->y - enterpriseY, dz = o->z - enterpriseZ;
+            tags[nt++] = (TagOrder){dx*dx + dy*dy + dz*dz, scene[i]};
         }
+        if (nt > qual_knobs()->labels) { qsort(tags, nt, sizeof(TagOrder), cmpTag); nt = qual_knobs()->labels; }
+        for (int i = 0; i < nt; i++) drawHUD(&objects[tags[i].slot]);
     }
 
-    glMatrixMode(GL_PROJECTION); glPushMatrix(); glLoadIdentity(); gluOrtho2D(0, 1000, 0, 1000); glMatrixMode(GL_MODELVIEW); glPushMatrix(); glLoadIdentity();
-    glDisable(GL_LIGHTING); glColor3f(0, 1, 1); drawText3D(20, 960, 0, "STAR TREK ULTRA: MULTI-USER TACTICAL");
-    char buf[256]; sprintf(buf, "QUADRANT: %s", g_quadrant); drawText3D(20, 930, 0, buf);
-    sprintf(buf, "ENERGY: %d  SHIELDS: %d", g_energy, g_shields); drawText3D(20, 905, 0, buf);
-    sprintf(buf, "ENEMIES REMAINING: %d", g_klingons); drawText3D(20, 880, 0, buf);
+    static OvLabel status[5];
+    ov_color(0, 1, 1, 1); drawText2D(&status[0], 20, 960, "STAR TREK ULTRA: MULTI-USER TACTICAL");
+    char buf[256]; sprintf(buf, "QUADRANT: %s", g_quadrant); drawText2D(&status[1], 20, 930, buf);
+    sprintf(buf, "ENERGY: %d  SHIELDS: %d", g_energy, g_shields); drawText2D(&status[2], 20, 905, buf);
+    sprintf(buf, "ENEMIES REMAINING: %d", g_klingons); drawText2D(&status[3], 20, 880, buf);
     
-    glColor3f(1, 1, 1);
-    drawText3D(20, 50, 0, "Arrows: Rotate | W/S: Zoom | SPACE: Pause | H: Toggle HUD | ESC: Exit");
+    ov_color(1, 1, 1, 1);
+    drawText2D(&status[4], 20, 50, "Arrows: Rotate | W/S: Zoom | Click: Lock | SPACE: Pause | H: Toggle HUD | ESC: Exit");
+    ov_flush();
+    capture_frame(g_headless ? g_bench_clock : t0);    /* Before the swap: reads the back buffer, or the bench's framebuffer */
+    if (qual_finishes()) glFinish();  /* Software GL does its work here, not in the calls */
+    qual_frame_end(shm_now_ms() - t0);
+    if (!g_headless) glutSwapBuffers();
+}
 
-    glMatrixMode(GL_PROJECTION); glPopMatrix(); glMatrixMode(GL_MODELVIEW); glPopMatrix();
-    glEnable(GL_LIGHTING); glutSwapBuffers();
+void reshape(int w, int h) {
+    win_w = w; win_h = h > 0 ? h : 1; glViewport(0, 0, w, h); g_redraw = 1;
+    if (g_headless || !g_capture) return;
+    int cw, ch;
+    if (!capture_active()) { if (!capture_open(g_capture, win_w, win_h)) exit(1); }
+    else if (capture_size(&cw, &ch), w != cw || h != ch) glutReshapeWindow(cw, ch);  /* Held while recording */
 }
 
-void timer(int v) { 
+/* One 16 ms animation step: camera spin, effects, trails */
+void viewTick() {
     angleY += autoRotate; pulse += 0.05; 
+    if (trail_motion > 0) trail_motion--;
     
-    /* Fade out beams */
-    for (int i = 0; i < 10; i++) if (beams[i].alpha > 0) beams[i].alpha -= 0.05f;
-
-    /* Update Boom Timer */
-    if (g_boom.timer > 0) g_boom.timer--;
-
-    /* Update Dismantle */
-    if (g_dismantle.timer > 0) {
-        g_dismantle.timer--;
-        for(int i=0; i<100; i++) {
-            if (g_dismantle.particles[i].active) {
-                g_dismantle.particles[i].x += g_dismantle.particles[i].vx;
-                g_dismantle.particles[i].y += g_dismantle.particles[i].vy;
-                g_dismantle.particles[i].z += g_dismantle.particles[i].vz;
-            }
+    /* Effects age on the GPU: only the clock moves here */
+    if (g_torp.active) fx_torpedo_wake(g_torp.x, g_torp.y, g_torp.z);
+    fx_tick();
+
+    /* Trails follow the positions display() interpolated at the playout time: one segment per ship per tick */
+    trail_tick();
+    for (int k = 0; k < objectCount; k++) {
+        GameObject *o = &objects[scene[k]];
+        if (o->type != 1 && o->type < 10) continue;
+        float p[3] = {o->x, o->y, o->z};
+        if (o->trail_count > 0) {
+            /* Rilevamento salto (cambio quadrante o teletrasporto) */
+            float dx = p[0] - o->trail_last[0], dy = p[1] - o->trail_last[1], dz = p[2] - o->trail_last[2];
+            if (dx*dx + dy*dy + dz*dz > 25.0f) { o->trail_count = 0; trail_cut(scene[k]); }
+        }
+        if (o->trail_count > 0) {
+            float r=0.4, g=0.7, b=1.0; /* Default Starfleet Blue */
+            if (o->type == 10) { r=1.0; g=0.1; b=0.0; } /* Klingon Red */
+            if (o->type == 11) { r=0.0; g=1.0; b=0.2; } /* Romulan Green */
+            if (o->type == 12) { r=0.0; g=0.8; b=0.8; } /* Borg Cyan */
+            trail_append(scene[k], o->trail_last, p, r, g, b);
+            if (memcmp(o->trail_last, p, sizeof(p)) != 0) trail_motion = TRAIL_POINTS;
         }
+        memcpy(o->trail_last, p, sizeof(p));
+        if (o->trail_count < TRAIL_POINTS) o->trail_count++;
     }
+}
 
-    /* Update Objects with Interpolation */
-    for (int i = 0; i < objectCount; i++) {
-        /* Interpolazione fluida per la posizione (LERP) */
-        float interp_speed = 0.12f;
-        objects[i].x += (objects[i].tx - objects[i].x) * interp_speed;
-        objects[i].y += (objects[i].ty - objects[i].y) * interp_speed;
-        objects[i].z += (objects[i].tz - objects[i].z) * interp_speed;
-        
-        /* Interpolazione fluida per l'orientamento (Heading/Mark) */
-        float dh = objects[i].th - objects[i].h;
-        if (dh > 180.0f) dh -= 360.0f;
-        if (dh < -180.0f) dh += 360.0f;
-        objects[i].h += dh * 0.08f;
-        if (objects[i].h >= 360.0f) objects[i].h -= 360.0f;
-        if (objects[i].h < 0.0f) objects[i].h += 360.0f;
-
-        objects[i].m += (objects[i].tm - objects[i].m) * 0.08f;
-        
-        if (i == 0) { enterpriseX = objects[i].x; enterpriseY = objects[i].y; enterpriseZ = objects[i].z; }
-
-        if (objects[i].type == 1 || objects[i].type >= 10) {
-            /* Check for jump only if we have a history */
-            if (objects[i].trail_count > 0) {
-                float lastX = objects[i].trail[(objects[i].trail_ptr - 1 + MAX_TRAIL) % MAX_TRAIL][0];
-                float lastY = objects[i].trail[(objects[i].trail_ptr - 1 + MAX_TRAIL) % MAX_TRAIL][1];
-                float lastZ = objects[i].trail[(objects[i].trail_ptr - 1 + MAX_TRAIL) % MAX_TRAIL][2];
-
-                /* Rilevamento salto (cambio quadrante o teletrasporto) */
-                float dx = objects[i].x - lastX;
-                float dy = objects[i].y - lastY;
-                float dz = objects[i].z - lastZ;
-                float dist_sq = dx*dx + dy*dy + dz*dz;
-                if (dist_sq > 25.0f) {
-                    objects[i].trail_count = 0;
-                    objects[i].trail_ptr = 0;
-                }
-            }
-
-            static int trail_tick = 0;
-            if (trail_tick % 2 == 0) { /* Riduciamo la densità della scia per fluidità visiva */
-                objects[i].trail[objects[i].trail_ptr][0] = objects[i].x;
-                objects[i].trail[objects[i].trail_ptr][1] = objects[i].y;
-                objects[i].trail[objects[i].trail_ptr][2] = objects[i].z;
-                objects[i].trail_ptr = (objects[i].trail_ptr + 1) % MAX_TRAIL;
-                if (objects[i].trail_count < MAX_TRAIL) objects[i].trail_count++;
-            }
-        }
+/* Anything besides the camera spin that would make the next frame differ from the one on screen */
+int viewChanging(double now) {
+    if (g_continuous || g_redraw || g_torp.active || fx_busy() || trail_motion > 0) return 1;
+    if (__atomic_load_n(&view_change_seq, __ATOMIC_ACQUIRE) != drawn_change_seq) return 1;
+    if (__atomic_load_n(&view_event_head, __ATOMIC_ACQUIRE) != view_event_tail) return 1;
+    /* Interpolation reaches the last change one playout delay after it arrived, then may extrapolate */
+    if (view_cur && now < view_cur->change_ms + SNAP_PLAYOUT_MS + SNAP_EXTRAP_MS + 2 * SNAP_TICK_MS) return 1;
+    return g_shared_state && (__atomic_load_n(&g_shared_state->shm_show_axes, __ATOMIC_ACQUIRE) != g_show_axes ||
+                              __atomic_load_n(&g_shared_state->shm_show_grid, __ATOMIC_ACQUIRE) != g_show_grid);
+}
+
+/* Input and changes keep the ambient spin going */
+void viewWake(double now) { spin_rest_ms = now + VIEW_SPIN_REST_MS; }
+
+int viewActive(double now) {
+    if (viewChanging(now)) { viewWake(now); return 1; }
+    return autoRotate != 0 && (!spin_ambient || now < spin_rest_ms);
+}
+
+/* Every 16 ms: ticks and redraws while the view moves, so a new frame waits at most one tick */
+void timer(int v) {
+    if (g_quit) { capture_close(); exit(0); }
+    if (viewActive(shm_now_ms())) { viewTick(); glutPostRedisplay(); }
+    glutTimerFunc(16, timer, 0);
+}
+
+/* Swaps on vertical blank where the driver allows it */
+void enableVsync() {
+    Display *dpy = glXGetCurrentDisplay();
+    const char *ext = dpy ? glXQueryExtensionsString(dpy, DefaultScreen(dpy)) : NULL;
+    const char *how = "off";
+    if (ext && strstr(ext, "GLX_EXT_swap_control")) {
+        PFNGLXSWAPINTERVALEXTPROC swap = (PFNGLXSWAPINTERVALEXTPROC)glXGetProcAddressARB((const GLubyte *)"glXSwapIntervalEXT");
+        if (swap) { swap(dpy, glXGetCurrentDrawable(), 1); how = "GLX_EXT_swap_control"; }
+    } else if (ext && strstr(ext, "GLX_MESA_swap_control")) {
+        PFNGLXSWAPINTERVALMESAPROC swap = (PFNGLXSWAPINTERVALMESAPROC)glXGetProcAddressARB((const GLubyte *)"glXSwapIntervalMESA");
+        if (swap && swap(1) == 0) how = "GLX_MESA_swap_control";
+    } else if (ext && strstr(ext, "GLX_SGI_swap_control")) {
+        PFNGLXSWAPINTERVALSGIPROC swap = (PFNGLXSWAPINTERVALSGIPROC)glXGetProcAddressARB((const GLubyte *)"glXSwapIntervalSGI");
+        if (swap && swap(1) == 0) how = "GLX_SGI_swap_control";
     }
-    static int global_trail_tick = 0;
-    global_trail_tick++;
+    fprintf(stderr, "--- VSYNC: %s ---\n", how);
+}
 
-    glutPostRedisplay(); glutTimerFunc(16, timer, 0); 
+int viewInit() {
+    glEnable(GL_DEPTH_TEST); glEnable(GL_BLEND); glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    initStars(); initLists(); initEntities();
+    bakeModels();
+    return vgl_init() && mesh_upload() && fx_init() && ov_init() && trail_init();
+}
+void mouse(int button, int state, int x, int y) {
+    if (button != GLUT_LEFT_BUTTON || state != GLUT_DOWN) return;
+    int id = pickAt(x, y);
+    if (id < 0) return;
+    g_lock_id = id;
+    if (g_shared_state) shm_request_lock(g_shared_state, id);
+    viewWake(shm_now_ms()); glutPostRedisplay();
 }
 void keyboard(unsigned char k, int x, int y) { 
-    if(k==27) exit(0); 
-    if(k==' ') autoRotate=(autoRotate==0)?0.15:0; 
+    if(k==27) { capture_close(); exit(0); }
+    if(k==' ') { autoRotate=(autoRotate==0)?0.15:0; spin_ambient = 0; }
     if(k=='w' || k=='W') zoom += 0.5f;
     if(k=='s' || k=='S') zoom -= 0.5f;
     if(k=='h' || k=='H') g_show_hud = !g_show_hud;
+    viewWake(shm_now_ms()); glutPostRedisplay();
 }
-void special(int k, int x, int y) { if(k==GLUT_KEY_UP) angleX-=5; if(k==GLUT_KEY_DOWN) angleX+=5; if(k==GLUT_KEY_LEFT) angleY-=5; if(k==GLUT_KEY_RIGHT) angleY+=5; }
+void special(int k, int x, int y) { if(k==GLUT_KEY_UP) angleX-=5; if(k==GLUT_KEY_DOWN) angleX+=5; if(k==GLUT_KEY_LEFT) angleY-=5; if(k==GLUT_KEY_RIGHT) angleY+=5; viewWake(shm_now_ms()); glutPostRedisplay(); }
+
+void handle_quit(int sig) { g_quit = 1; }
 
 int main(int argc, char** argv) {
-    setlocale(LC_ALL, "C"); signal(SIGUSR1, handle_signal);
-    char *shm_name = SHM_NAME; if (argc > 1) shm_name = argv[1];
+    setlocale(LC_ALL, "C");
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) return view_bench(argc - 1, argv + 1);
+    int arg = 1, scaling = 1, quality_log = 0;
+    double fps = QUAL_DEFAULT_FPS;
+    for (; arg < argc && strncmp(argv[arg], "--", 2) == 0; arg++) {
+        if (strcmp(argv[arg], "--no-scale") == 0) scaling = 0;
+        else if (strcmp(argv[arg], "--continuous") == 0) g_continuous = 1;
+        else if (strcmp(argv[arg], "--quality-log") == 0) quality_log = 1;
+        else if (arg + 1 < argc && strcmp(argv[arg], "--fps") == 0) fps = atof(argv[++arg]);
+        else if (arg + 1 < argc && strcmp(argv[arg], "--capture") == 0) { g_capture = argv[++arg]; g_continuous = 1; } /* Gaps in the video only when drawing falls behind */
+        else if (arg + 1 < argc && strcmp(argv[arg], "--record") == 0) {
+            if (!(g_record = fopen(argv[++arg], "wb"))) { perror(argv[arg]); exit(1); }
+        } else { fprintf(stderr, "Usage: %s [--bench ...] [--record file] [--capture file.y4m] [--fps target (0: fixed quality)] [--no-scale] [--quality-log] [--continuous] [shm name]\n", argv[0]); exit(1); }
+    }
+    char *shm_name = SHM_NAME; if (argc > arg) shm_name = argv[arg];
     int retries = 0; while(shm_fd == -1 && retries < 10) { shm_fd = shm_open(shm_name, O_RDWR, 0666); if (shm_fd == -1) { usleep(100000); retries++; } }
     if (shm_fd == -1) exit(1);
     g_shared_state = mmap(NULL, sizeof(GameState), PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
-    glutInit(&argc, argv); glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH); glutInitWindowSize(1024, 768); glutCreateWindow("Trek 3DView - Multiuser");
-    glEnable(GL_DEPTH_TEST); glEnable(GL_BLEND); glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    GLfloat lp[] = {10, 10, 10, 1}; glEnable(GL_LIGHTING); glEnable(GL_LIGHT0); glLightfv(GL_LIGHT0, GL_POSITION, lp);
-    initStars(); initVBOs(); glMatrixMode(GL_PROJECTION); gluPerspective(45, 1.33, 1, 500); glMatrixMode(GL_MODELVIEW);
-    glutDisplayFunc(display); glutKeyboardFunc(keyboard); glutSpecialFunc(special); glutTimerFunc(16, timer, 0);
-    kill(getppid(), SIGUSR2); glutMainLoop(); return 0;
+    glutInit(&argc, argv); glutInitContextVersion(3, 3); glutInitContextProfile(GLUT_CORE_PROFILE); /* No fixed function left */
+    glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH); glutInitWindowSize(1024, 768); glutCreateWindow("Trek 3DView - Multiuser");
+    if (!viewInit()) exit(1);
+    enableVsync();
+    qual_target(fps, scaling);
+    qual_log(quality_log);
+    struct sigaction sa_quit = {0};
+    sa_quit.sa_handler = handle_quit;
+    sigemptyset(&sa_quit.sa_mask);
+    sigaction(SIGINT, &sa_quit, NULL);
+    sigaction(SIGTERM, &sa_quit, NULL);
+    pthread_t ingest;
+    if (pthread_create(&ingest, NULL, ingestMain, NULL) != 0) { perror("pthread_create"); exit(1); }
+    glutDisplayFunc(display); glutReshapeFunc(reshape); glutKeyboardFunc(keyboard); glutSpecialFunc(special); glutMouseFunc(mouse); glutCloseFunc(capture_close); glutTimerFunc(16, timer, 0);
+    __atomic_store_n(&g_shared_state->viewer_ready, 1, __ATOMIC_RELEASE); shm_futex(&g_shared_state->viewer_ready, FUTEX_WAKE, 1, NULL);
+    glutMainLoop(); return 0;
 }
\ No newline at end of file
@@ -0,0 +1,203 @@
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <math.h>
+#include "server_sim.h"
+
+/*
+ * TREK BENCH
+ * Microbenchmarks of the server simulation on a synthetic galaxy, no sockets:
+ * every captain is headless. Each sample restores the same world first, so
+ * every iteration does identical work and numbers compare across commits.
+ * Output: one JSON object per benchmark per line on stdout.
+ */
+
+typedef struct {
+    int quadrants, players_per_q, npcs_per_q, stars_per_q, torps_per_player;
+    int bg_npcs, bg_stars, iterations;
+    unsigned seed;
+    const char *label;
+} BenchConfig;
+
+BenchConfig cfg = {8, 4, 4, 2, 1, 200, 400, 2000, 1, ""};
+int player_count = 0;
+
+/* World snapshot restored before every sample */
+ConnectedPlayer snap_players[MAX_CLIENTS];
+NPCShip snap_npcs[MAX_NPC];
+NPCStar snap_stars[MAX_STARS];
+Projectile snap_projectiles[MAX_PROJECTILES];
+int snap_projectile_count;
+StarTrekGame snap_master;
+
+long long now_ns() {
+    struct timespec t; clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+double rand_sector() { return 0.5 + (rand() % 900) / 100.0; }
+
+void world_snapshot() {
+    memcpy(snap_players, players, sizeof(players)); memcpy(snap_npcs, npcs, sizeof(npcs));
+    memcpy(snap_stars, stars_data, sizeof(stars_data)); memcpy(snap_projectiles, projectiles, sizeof(projectiles));
+    snap_projectile_count = projectile_count; snap_master = galaxy_master;
+}
+
+void world_restore() {
+    memcpy(players, snap_players, sizeof(players)); memcpy(npcs, snap_npcs, sizeof(npcs));
+    memcpy(stars_data, snap_stars, sizeof(stars_data)); memcpy(projectiles, snap_projectiles, sizeof(projectiles));
+    projectile_count = snap_projectile_count; galaxy_master = snap_master;
+    memset(&sched, 0, sizeof(sched));
+    server_tick = 1; /* Off the 60-tick regen/census boundary */
+    sim_seed(cfg.seed);
+}
+
+/* Captains packed into the first quadrants, hostiles next to them, the rest
+ * of the tables filled with background entities spread over the galaxy. */
+void build_world() {
+    srand(cfg.seed);
+    memset(players, 0, sizeof(players)); memset(npcs, 0, sizeof(npcs)); memset(stars_data, 0, sizeof(stars_data));
+    memset(black_holes, 0, sizeof(black_holes)); memset(planets, 0, sizeof(planets)); memset(bases, 0, sizeof(bases));
+    memset(&galaxy_master, 0, sizeof(galaxy_master));
+    projectile_count = 0; player_count = 0;
+    int n_count = 0, s_count = 0;
+
+    for (int q = 0; q < cfg.quadrants; q++) {
+        int q1 = q % 10 + 1, q2 = (q / 10) % 10 + 1, q3 = (q / 100) % 10 + 1;
+        for (int p = 0; p < cfg.players_per_q && player_count < MAX_CLIENTS; p++) {
+            ConnectedPlayer *c = &players[player_count];
+            c->socket = -1; c->active = 1; c->faction = p % 5; c->ship_class = p % 14;
+            snprintf(c->name, sizeof(c->name), "bench%d", player_count);
+            c->state.q1 = q1; c->state.q2 = q2; c->state.q3 = q3;
+            c->state.s1 = rand_sector(); c->state.s2 = rand_sector(); c->state.s3 = rand_sector();
+            c->state.energy = 3000; c->state.torpedoes = 10;
+            for (int s = 0; s < 6; s++) c->state.shields[s] = 500;
+            for (int s = 0; s < 8; s++) c->state.system_health[s] = 100.0f;
+            c->state.ent_h = rand() % 360; c->state.ent_m = 0;
+            c->dx = sin(c->state.ent_h * M_PI / 180.0); c->dy = -cos(c->state.ent_h * M_PI / 180.0); c->dz = 0;
+            /* A mix of every navigation state */
+            switch (player_count % 4) {
+                case 0: c->nav_state = NAV_STATE_IMPULSE; c->warp_speed = 0.05; break;
+                case 1: c->nav_state = NAV_STATE_WARP; c->nav_timer = 1000; c->warp_speed = 0.05;
+                        c->target_gx = (q1-1)*10.0 + c->state.s1; c->target_gy = (q2-1)*10.0 + c->state.s2; c->target_gz = (q3-1)*10.0 + c->state.s3; break;
+                case 2: c->nav_state = NAV_STATE_ALIGN; c->nav_timer = 60; c->target_h = (c->state.ent_h + 90); break;
+                default: c->nav_state = NAV_STATE_IDLE; break;
+            }
+            c->last_cmd_tick = 1;
+            for (int t = 0; t < cfg.torps_per_player && projectile_count < MAX_PROJECTILES; t++) {
+                double h = rand() % 360 * M_PI / 180.0;
+                Projectile *pr = &projectiles[projectile_count++];
+                *pr = (Projectile){PROJ_TORPEDO, player_count, (q1-1)*10.0 + c->state.s1, (q2-1)*10.0 + c->state.s2, (q3-1)*10.0 + c->state.s3,
+                                   sin(h), -cos(h), 0, 0.8, 60, 0, 0, 0};
+            }
+            player_count++;
+        }
+        for (int e = 0; e < cfg.npcs_per_q && n_count < MAX_NPC; e++, n_count++)
+            npcs[n_count] = (NPCShip){n_count, 10 + rand() % 11, q1, q2, q3, rand_sector(), rand_sector(), rand_sector(), 0, 0, 1000, 1,
+                                      rand() % 300, AI_STATE_PATROL, -1, 0, 0, 0, 0};
+        for (int s = 0; s < cfg.stars_per_q && s_count < MAX_STARS; s++, s_count++)
+            stars_data[s_count] = (NPCStar){s_count, 4, q1, q2, q3, rand_sector(), rand_sector(), rand_sector(), 1};
+    }
+    for (int e = 0; e < cfg.bg_npcs && n_count < MAX_NPC; e++, n_count++)
+        npcs[n_count] = (NPCShip){n_count, 10 + rand() % 11, rand() % 10 + 1, rand() % 10 + 1, rand() % 10 + 1, rand_sector(), rand_sector(), rand_sector(),
+                                  0, 0, 1000, 1, rand() % 300, AI_STATE_PATROL, -1, 0, 0, 0, 0};
+    for (int s = 0; s < cfg.bg_stars && s_count < MAX_STARS; s++, s_count++)
+        stars_data[s_count] = (NPCStar){s_count, 4, rand() % 10 + 1, rand() % 10 + 1, rand() % 10 + 1, rand_sector(), rand_sector(), rand_sector(), 1};
+    galaxy_master.k9 = n_count;
+    world_snapshot();
+}
+
+int cmp_ll(const void *a, const void *b) {
+    long long x = *(const long long *)a, y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+/* Benchmark bodies: setup runs untimed after the world restore */
+PacketUpdate bench_upd;
+void census_lrs() {
+    for (int i = 0; i < player_count; i++)
+        for (int l = -1; l <= 1; l++) for (int y = -1; y <= 1; y++) for (int x = -1; x <= 1; x++) {
+            int q1 = players[i].state.q1 + x, q2 = players[i].state.q2 + y, q3 = players[i].state.q3 + l;
+            if (q1 >= 1 && q1 <= 10 && q2 >= 1 && q2 <= 10 && q3 >= 1 && q3 <= 10) (void)quadrant_census(q1, q2, q3);
+        }
+}
+void build_updates() { for (int i = 0; i < player_count; i++) build_update(i, &bench_upd); }
+void tick() { run_tick(0); }
+
+typedef struct {
+    const char *name;
+    void (*setup)();
+    void (*body)();
+    int items;                     /* Work units per call, for the per-item figure */
+} Bench;
+
+void run_bench(Bench *b) {
+    long long *ns = malloc(sizeof(long long) * cfg.iterations), sum = 0;
+    for (int it = 0; it < cfg.iterations; it++) {
+        world_restore();
+        if (b->setup) b->setup();
+        long long t0 = now_ns();
+        b->body();
+        ns[it] = now_ns() - t0; sum += ns[it];
+    }
+    qsort(ns, cfg.iterations, sizeof(long long), cmp_ll);
+    long long p50 = ns[(cfg.iterations - 1) / 2], p99 = ns[(cfg.iterations - 1) * 99 / 100];
+    printf("{\"bench\":\"%s\",\"label\":\"%s\",\"seed\":%u,\"quadrants\":%d,\"players\":%d,\"npcs_per_q\":%d,\"stars_per_q\":%d,"
+           "\"bg_npcs\":%d,\"bg_stars\":%d,\"torpedoes\":%d,\"iterations\":%d,\"items\":%d,"
+           "\"ns_min\":%lld,\"ns_p50\":%lld,\"ns_p99\":%lld,\"ns_max\":%lld,\"ns_mean\":%.1f,\"ns_per_item_p50\":%.1f}\n",
+           b->name, cfg.label, cfg.seed, cfg.quadrants, player_count, cfg.npcs_per_q, cfg.stars_per_q, cfg.bg_npcs, cfg.bg_stars,
+           snap_projectile_count, cfg.iterations, b->items, ns[0], p50, p99, ns[cfg.iterations - 1], (double)sum / cfg.iterations,
+           b->items > 0 ? (double)p50 / b->items : (double)p50);
+    fprintf(stderr, "%-14s p50 %10.2f us  p99 %10.2f us  (%d items, %.1f ns/item)\n", b->name, p50 / 1e3, p99 / 1e3, b->items,
+            b->items > 0 ? (double)p50 / b->items : (double)p50);
+    free(ns);
+}
+
+void usage(const char *prog) {
+    printf("Usage: %s [-q quadrants] [-p players/quadrant] [-n npcs/quadrant] [-s stars/quadrant] [-t torpedoes/captain]\n"
+           "          [-N background npcs] [-S background stars] [-i iterations] [-r seed] [-l label] [-b bench,...]\n", prog);
+}
+
+int main(int argc, char *argv[]) {
+    int opt; const char *only = NULL;
+    while ((opt = getopt(argc, argv, "q:p:n:s:t:N:S:i:r:l:b:h")) != -1) {
+        switch (opt) {
+            case 'q': cfg.quadrants = atoi(optarg); break;
+            case 'p': cfg.players_per_q = atoi(optarg); break;
+            case 'n': cfg.npcs_per_q = atoi(optarg); break;
+            case 's': cfg.stars_per_q = atoi(optarg); break;
+            case 't': cfg.torps_per_player = atoi(optarg); break;
+            case 'N': cfg.bg_npcs = atoi(optarg); break;
+            case 'S': cfg.bg_stars = atoi(optarg); break;
+            case 'i': cfg.iterations = atoi(optarg); break;
+            case 'r': cfg.seed = (unsigned)strtoul(optarg, NULL, 10); break;
+            case 'l': cfg.label = optarg; break;
+            case 'b': only = optarg; break;
+            default: usage(argv[0]); return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (cfg.quadrants < 1 || cfg.quadrants > QUAD_CELLS || cfg.iterations < 1) { usage(argv[0]); return 1; }
+
+    build_world();
+    int npc_total = 0; for (int n = 0; n < MAX_NPC; n++) if (npcs[n].active) npc_total++;
+    Bench benches[] = {
+        {"navigation", NULL, phase_navigation, player_count},
+        {"hazards", NULL, phase_hazards, player_count},
+        {"quad_index", NULL, build_quadrant_index, npc_total + player_count},
+        {"npc_ai", build_quadrant_index, phase_npc_ai, cfg.quadrants * cfg.npcs_per_q},
+        {"torpedoes", build_quadrant_index, update_projectiles, snap_projectile_count},
+        {"census_lrs", NULL, census_lrs, player_count * 27},
+        {"packet_build", NULL, build_updates, player_count},
+        {"tick", NULL, tick, 1},
+    };
+    fprintf(stderr, "--- TREK BENCH: %d captains in %d quadrants, %d NPCs, %d torpedoes, %d iterations ---\n",
+            player_count, cfg.quadrants, npc_total, snap_projectile_count, cfg.iterations);
+    for (size_t b = 0; b < sizeof(benches) / sizeof(benches[0]); b++) {
+        if (only && !strstr(only, benches[b].name)) continue;
+        run_bench(&benches[b]);
+    }
+    return 0;
+}
@@ -35,7 +35,7 @@ pid_t visualizer_pid = 0;
 GameState *g_shared_state = NULL;
 int shm_fd = -1;
 char shm_path[64];
-volatile sig_atomic_t g_visualizer_ready = 0;
+int shm_back = 0; /* Triple buffer frame owned by network_listener */
 
 /* Gestione Input Reattivo */
 char g_input_buf[256] = {0};
@@ -65,15 +65,26 @@ void reprint_prompt() {
     fflush(stdout);
 }
 
-void handle_ack(int sig) {
-    g_visualizer_ready = 1;
-}
-
 void handle_sigchld(int sig) {
     int status;
     while (waitpid(-1, &status, WNOHANG) > 0);
 }
 
+/* Tactical View options from TREK_VIEW_ARGS, e.g. "--record frames.rec --capture film.y4m": the segment has one reader, so recording goes through the viewer the client starts */
+#define VIEW_MAX_ARGS 16
+void exec_visualizer() {
+    char *args[VIEW_MAX_ARGS + 3];
+    int n = 0;
+    args[n++] = "trek_3dview";
+    char *opts = getenv("TREK_VIEW_ARGS");
+    if (opts) for (char *tok = strtok(opts, " \t"); tok && n <= VIEW_MAX_ARGS; tok = strtok(NULL, " \t")) args[n++] = tok;
+    args[n++] = shm_path;
+    args[n] = NULL;
+    execv("./trek_3dview", args);
+    perror("./trek_3dview");
+    _exit(1); /* Not exit(): atexit would unlink the parent's segment */
+}
+
 void init_shm() {
 
 
@@ -81,11 +92,7 @@ void init_shm() {
     shm_fd = shm_open(shm_path, O_CREAT | O_RDWR, 0666);
     ftruncate(shm_fd, sizeof(GameState));
     g_shared_state = mmap(NULL, sizeof(GameState), PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
-    
-    pthread_mutexattr_t attr;
-    pthread_mutexattr_init(&attr);
-    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
-    pthread_mutex_init(&g_shared_state->mutex, &attr);
+    shm_init(g_shared_state);
 }
 
 void cleanup() {
@@ -142,72 +149,61 @@ void *network_listener(void *arg) {
             PacketUpdate upd;
             upd.type = type;
             if (read_all(sock, ((char*)&upd) + sizeof(int), sizeof(PacketUpdate) - sizeof(int)) <= 0) break;
+            double recv_ms = shm_now_ms(); /* Arrival stamp for the viewer's jitter buffer */
             
             if (g_shared_state) {
-                pthread_mutex_lock(&g_shared_state->mutex);
+                /* Fill the back frame, then hand it over: the viewer is never waited for */
+                static ShmFrame *f = NULL;
+                static SharedPoint boom; static SharedDismantle dismantle;
+                static uint32_t boom_seq = 0, dismantle_seq = 0;
+                static long long frame_id = 0;
+                if (!f) f = &g_shared_state->frames[shm_back];
+
                 /* Sincronizziamo lo stato locale con i dati ottimizzati dal server */
-                g_shared_state->shm_energy = upd.energy;
-                int total_s = 0;
-                for(int s=0; s<6; s++) {
-                    g_shared_state->shm_shields[s] = upd.shields[s];
-                    total_s += upd.shields[s];
-                }
-                g_shared_state->is_cloaked = upd.is_cloaked;
-                sprintf(g_shared_state->quadrant, "Q-%d-%d-%d", upd.q1, upd.q2, upd.q3);
+                f->shm_energy = upd.energy;
+                for(int s=0; s<6; s++) f->shm_shields[s] = upd.shields[s];
+                f->is_cloaked = upd.is_cloaked;
+                sprintf(f->quadrant, "Q-%d-%d-%d", upd.q1, upd.q2, upd.q3);
 
-                g_shared_state->object_count = upd.object_count;
+                f->object_count = upd.object_count;
                 for (int o=0; o < upd.object_count; o++) {
-                    g_shared_state->objects[o].shm_x = upd.objects[o].net_x;
-                    g_shared_state->objects[o].shm_y = upd.objects[o].net_y;
-                    g_shared_state->objects[o].shm_z = upd.objects[o].net_z;
-                    g_shared_state->objects[o].h = upd.objects[o].h;
-                    g_shared_state->objects[o].m = upd.objects[o].m;
-                    g_shared_state->objects[o].type = upd.objects[o].type;
-                    g_shared_state->objects[o].ship_class = upd.objects[o].ship_class;
-                    g_shared_state->objects[o].health_pct = upd.objects[o].health_pct;
-                    g_shared_state->objects[o].id = upd.objects[o].id;
-                    g_shared_state->objects[o].active = 1;
+                    f->objects[o].shm_x = upd.objects[o].net_x;
+                    f->objects[o].shm_y = upd.objects[o].net_y;
+                    f->objects[o].shm_z = upd.objects[o].net_z;
+                    f->objects[o].h = upd.objects[o].h;
+                    f->objects[o].m = upd.objects[o].m;
+                    f->objects[o].type = upd.objects[o].type;
+                    f->objects[o].ship_class = upd.objects[o].ship_class;
+                    f->objects[o].health_pct = upd.objects[o].health_pct;
+                    f->objects[o].id = upd.objects[o].id;
+                    f->objects[o].active = 1;
                 }
                 
-                /* Append beams to shared state (Queue logic) */
-                if (upd.beam_count > 0) {
-                    for (int b=0; b < upd.beam_count; b++) {
-                        if (g_shared_state->beam_count < MAX_BEAMS) {
-                            int idx = g_shared_state->beam_count;
-                            g_shared_state->beams[idx].shm_tx = upd.beams[b].net_tx;
-                            g_shared_state->beams[idx].shm_ty = upd.beams[b].net_ty;
-                            g_shared_state->beams[idx].shm_tz = upd.beams[b].net_tz;
-                            g_shared_state->beams[idx].active = upd.beams[b].active;
-                            g_shared_state->beam_count++;
-                        }
-                    }
+                /* Beams are queued, not latched: a skipped frame loses none */
+                for (int b=0; b < upd.beam_count; b++) {
+                    SharedBeam beam = {upd.beams[b].net_tx, upd.beams[b].net_ty, upd.beams[b].net_tz, upd.beams[b].active};
+                    shm_push_beam(g_shared_state, &beam);
                 }
                 
                 /* Projectile position */
-                g_shared_state->torp.shm_x = upd.torp.net_x;
-                g_shared_state->torp.shm_y = upd.torp.net_y;
-                g_shared_state->torp.shm_z = upd.torp.net_z;
-                g_shared_state->torp.active = upd.torp.active;
-                
-                /* Event Latching (Visualizer will clear these) */
-                if (upd.boom.active) {
-                    g_shared_state->boom.shm_x = upd.boom.net_x;
-                    g_shared_state->boom.shm_y = upd.boom.net_y;
-                    g_shared_state->boom.shm_z = upd.boom.net_z;
-                    g_shared_state->boom.active = 1;
-                }
+                f->torp.shm_x = upd.torp.net_x;
+                f->torp.shm_y = upd.torp.net_y;
+                f->torp.shm_z = upd.torp.net_z;
+                f->torp.active = upd.torp.active;
                 
+                /* One-shot events ride along in every frame until the next one replaces them */
+                if (upd.boom.active) { boom = (SharedPoint){upd.boom.net_x, upd.boom.net_y, upd.boom.net_z, 1}; boom_seq++; }
                 if (upd.dismantle.active) {
-                    g_shared_state->dismantle.shm_x = upd.dismantle.net_x;
-                    g_shared_state->dismantle.shm_y = upd.dismantle.net_y;
-                    g_shared_state->dismantle.shm_z = upd.dismantle.net_z;
-                    g_shared_state->dismantle.species = upd.dismantle.species;
-                    g_shared_state->dismantle.active = 1;
+                    dismantle = (SharedDismantle){upd.dismantle.net_x, upd.dismantle.net_y, upd.dismantle.net_z, upd.dismantle.species, 1};
+                    dismantle_seq++;
                 }
+                f->boom = boom; f->boom_seq = boom_seq;
+                f->dismantle = dismantle; f->dismantle_seq = dismantle_seq;
                 
-                g_shared_state->frame_id++; 
-                pthread_mutex_unlock(&g_shared_state->mutex);
-                kill(visualizer_pid, SIGUSR1); 
+                f->frame_id = ++frame_id;
+                f->server_tick = upd.server_tick;
+                f->recv_ms = recv_ms;
+                f = shm_publish(g_shared_state, &shm_back);
             }
         }
     }
@@ -222,12 +218,6 @@ int main(int argc, char *argv[]) {
     struct sockaddr_in serv_addr;
     char server_ip[64];
 
-    struct sigaction sa;
-    sa.sa_handler = handle_ack;
-    sigemptyset(&sa.sa_mask);
-    sa.sa_flags = SA_RESTART;
-    sigaction(SIGUSR2, &sa, NULL);
-
     struct sigaction sa_exit;
     sa_exit.sa_handler = handle_sigint;
     sigemptyset(&sa_exit.sa_mask);
@@ -294,13 +284,13 @@ int main(int argc, char *argv[]) {
 
     init_shm();
     visualizer_pid = fork();
-    if (visualizer_pid == 0) {
-        execl("./trek_3dview", "trek_3dview", shm_path, NULL);
-        exit(0);
-    }
+    if (visualizer_pid == 0) exec_visualizer();
 
     /* Wait for visualizer handshake */
-    while(!g_visualizer_ready) usleep(10000);
+    while (!__atomic_load_n(&g_shared_state->viewer_ready, __ATOMIC_ACQUIRE)) {
+        struct timespec ts = {0, 100000000};
+        shm_futex(&g_shared_state->viewer_ready, FUTEX_WAIT, 0, &ts);
+    }
     printf(B_GREEN "Tactical View (3D) initialized.\n" RESET);
 
     /* Thread per ascoltare il server */
@@ -311,8 +301,18 @@ int main(int argc, char *argv[]) {
     enable_raw_mode();
     reprint_prompt();
 
+    uint64_t lock_seen = 0;
     while (g_running) {
         char c;
+        /* Click-to-lock from the Tactical View, forwarded as the typed command (stdin polls every 100 ms) */
+        int lock_id;
+        if (g_shared_state && shm_take_lock(g_shared_state, &lock_seen, &lock_id)) {
+            PacketCommand cpkt = {PKT_COMMAND, ""};
+            snprintf(cpkt.cmd, sizeof(cpkt.cmd), "lock %d", lock_id);
+            send(sock, &cpkt, sizeof(cpkt), 0);
+            printf("\r\033[K" B_CYAN "Tactical View: lock %d" RESET "\n", lock_id);
+            reprint_prompt();
+        }
         if (read(STDIN_FILENO, &c, 1) > 0) {
             if (c == '\n' || c == '\r') {
                 if (g_input_ptr > 0) {
@@ -335,7 +335,7 @@ int main(int argc, char *argv[]) {
                         printf("pha E       : Fire Phasers (Distance-based damage, uses Energy)\n");
                         printf("tor H M     : Launch Photon Torpedo (Ballistic projectile)\n");
                         printf("she F R T B L RI : Configure 6 Shield Quadrants\n");
-                        printf("lock ID     : Lock-on Target (0:Self, 1+:Nearby vessels)\n");
+                        printf("lock ID     : Lock-on Target (0:Self, 1+:Nearby vessels; or click it in the 3D view)\n");
                         printf("pow E S W   : Power Distribution (Engines, Shields, Weapons %%)\n");
                         printf("psy         : Psychological Warfare (Corbomite Bluff)\n");
                         printf("aux probe QX QY QZ: Launch long-range probe\n");
@@ -361,16 +361,12 @@ int main(int argc, char *argv[]) {
                         printf("xxx         : Self-Destruct\n");
                     } else if (strcmp(g_input_buf, "axs") == 0) {
                         if (g_shared_state) {
-                            pthread_mutex_lock(&g_shared_state->mutex);
-                            g_shared_state->shm_show_axes = !g_shared_state->shm_show_axes;
-                            pthread_mutex_unlock(&g_shared_state->mutex);
+                            __atomic_xor_fetch(&g_shared_state->shm_show_axes, 1, __ATOMIC_RELEASE);
                             printf("Axes toggled.\n");
                         }
                     } else if (strcmp(g_input_buf, "grd") == 0) {
                         if (g_shared_state) {
-                            pthread_mutex_lock(&g_shared_state->mutex);
-                            g_shared_state->shm_show_grid = !g_shared_state->shm_show_grid;
-                            pthread_mutex_unlock(&g_shared_state->mutex);
+                            __atomic_xor_fetch(&g_shared_state->shm_show_grid, 1, __ATOMIC_RELEASE);
                             printf("Grid toggled.\n");
                         }
                     } else if (strncmp(g_input_buf, "rad ", 4) == 0) {
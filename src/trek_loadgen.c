@@ -0,0 +1,386 @@
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <math.h>
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include "network.h"
+
+/*
+ * TREK LOADGEN
+ * Headless bot swarm: every bot speaks the client protocol on its own TCP
+ * connection, runs a closed command loop (send, wait for the reply, think)
+ * and consumes the update stream. One epoll thread drives all of them.
+ */
+
+#define TICK_MS (1000.0 / 30.0)
+#define REPLY_TIMEOUT_MS 2000.0    /* No reply in 2 s: counted as a timeout */
+#define STALL_MS 3000.0            /* No update in 3 s: the ship is gone, reconnect */
+#define RECONNECT_MS 1000.0        /* Back-off before a lost or rejected bot tries again */
+#define REPORT_EVERY_MS 5000.0
+#define RX_BUF (sizeof(StarTrekGame) + sizeof(PacketUpdate))
+#define TX_BUF (sizeof(PacketMessage) + sizeof(PacketCommand))
+#define MAX_SCRIPT 256
+
+typedef enum { BOT_IDLE = 0, BOT_CONNECTING, BOT_LOGIN, BOT_SYNC, BOT_ACTIVE } BotState;
+
+typedef enum { CMD_NAV = 0, CMD_IMP, CMD_PHA, CMD_TOR, CMD_SRS, CMD_LRS, CMD_RAD, CMD_OTHER, CMD_COUNT } CmdKind;
+
+const char *cmd_names[CMD_COUNT] = {"nav", "imp", "pha", "tor", "srs", "lrs", "rad", "other"};
+/* Department that answers each command; rad is answered by its own echo, other by anything */
+const char *cmd_reply_from[CMD_COUNT] = {"HELMSMAN", "HELMSMAN", "TACTICAL", "TACTICAL", "COMPUTER", "SCIENCE", NULL, ""};
+
+typedef struct { double *v; size_t n, cap; } Samples;
+
+typedef struct {
+    int fd, idx, gen;
+    BotState state;
+    char name[64];
+    unsigned char rx[RX_BUF]; size_t rx_len;
+    unsigned char tx[TX_BUF]; size_t tx_len;
+    double connect_ms, next_connect_ms, last_upd_ms, next_cmd_ms, sent_ms;
+    int pending;                   /* CmdKind awaiting a reply, -1 if none */
+    int energy, torpedoes, script_pos;
+} Bot;
+
+typedef struct {
+    long long connects, logins, rejected, deaths, protocol_errors;
+    long long cmds_sent[CMD_COUNT], replies[CMD_COUNT], timeouts[CMD_COUNT];
+    long long updates, messages, bytes_rx;
+} LoadStats;
+
+Bot *bots;
+int bot_count = 32;
+int epfd;
+struct sockaddr_in server_addr;
+LoadStats st, st_last;
+Samples lat[CMD_COUNT], lat_all, inter_arrival;
+
+/* Options */
+double duration_s = 30.0, think_ms = 500.0, ramp_per_s = 50.0;
+int mix[CMD_COUNT] = {1, 2, 1, 1, 2, 1, 1, 0};
+char *script[MAX_SCRIPT]; int script_len = 0;
+const char *name_prefix = "bot";
+volatile sig_atomic_t g_running = 1;
+
+double now_ms() {
+    struct timespec t; clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000.0 + t.tv_nsec / 1e6;
+}
+
+void sample_add(Samples *s, double v) {
+    if (s->n == s->cap) { s->cap = s->cap ? s->cap * 2 : 1024; s->v = realloc(s->v, s->cap * sizeof(double)); }
+    s->v[s->n++] = v;
+}
+
+int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+double sample_pct(Samples *s, double pct) {
+    if (s->n == 0) return 0;
+    return s->v[(size_t)((s->n - 1) * pct / 100.0)];
+}
+
+CmdKind cmd_kind(const char *cmd) {
+    for (int k = 0; k < CMD_OTHER; k++) if (strncmp(cmd, cmd_names[k], 3) == 0 && (cmd[3] == ' ' || cmd[3] == '\0')) return k;
+    return CMD_OTHER;
+}
+
+void bot_close(Bot *b) {
+    if (b->fd >= 0) { epoll_ctl(epfd, EPOLL_CTL_DEL, b->fd, NULL); close(b->fd); }
+    b->fd = -1; b->state = BOT_IDLE; b->rx_len = b->tx_len = 0; b->pending = -1;
+    b->next_connect_ms = now_ms() + RECONNECT_MS;
+}
+
+void bot_flush(Bot *b) {
+    while (b->tx_len > 0) {
+        ssize_t n = send(b->fd, b->tx, b->tx_len, MSG_NOSIGNAL);
+        if (n < 0) { if (errno != EAGAIN) { bot_close(b); st.protocol_errors++; } break; }
+        memmove(b->tx, b->tx + n, b->tx_len - n); b->tx_len -= n;
+    }
+    struct epoll_event ev = {EPOLLIN | (b->tx_len ? EPOLLOUT : 0), {.ptr = b}};
+    if (b->fd >= 0) epoll_ctl(epfd, EPOLL_CTL_MOD, b->fd, &ev);
+}
+
+void bot_queue(Bot *b, const void *pkt, size_t len) {
+    if (b->tx_len + len > TX_BUF) return; /* Still backlogged: drop, the reply timeout accounts for it */
+    memcpy(b->tx + b->tx_len, pkt, len); b->tx_len += len;
+    bot_flush(b);
+}
+
+void bot_connect(Bot *b) {
+    b->fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (b->fd < 0) { perror("socket"); return; }
+    int one = 1; setsockopt(b->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (connect(b->fd, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0 && errno != EINPROGRESS) {
+        close(b->fd); b->fd = -1; st.protocol_errors++; return;
+    }
+    snprintf(b->name, sizeof(b->name), "%s%d_%d", name_prefix, b->idx, b->gen++);
+    b->state = BOT_CONNECTING; b->connect_ms = now_ms(); b->pending = -1;
+    struct epoll_event ev = {EPOLLIN | EPOLLOUT, {.ptr = b}};
+    epoll_ctl(epfd, EPOLL_CTL_ADD, b->fd, &ev);
+    st.connects++;
+}
+
+/* Randomized mix: a command the ship can actually execute, weighted by -m */
+void bot_pick_command(Bot *b, char *cmd, size_t len) {
+    if (script_len > 0) { snprintf(cmd, len, "%s", script[b->script_pos++ % script_len]); return; }
+    int total = 0; for (int k = 0; k < CMD_OTHER; k++) total += mix[k];
+    int r = rand() % (total > 0 ? total : 1), k = 0;
+    while (k < CMD_OTHER - 1 && r >= mix[k]) r -= mix[k++];
+    if (k == CMD_TOR && b->torpedoes <= 0) k = CMD_SRS;
+    if (k == CMD_PHA && b->energy < 500) k = CMD_LRS;
+    switch (k) {
+        case CMD_NAV: snprintf(cmd, len, "nav %d %d %.1f", rand() % 360, rand() % 61 - 30, 0.1 + (rand() % 5) / 10.0); break;
+        case CMD_IMP: snprintf(cmd, len, "imp %d %d %.1f", rand() % 360, rand() % 61 - 30, (rand() % 11) / 10.0); break;
+        case CMD_PHA: snprintf(cmd, len, "pha %d", 50 + rand() % 100); break;
+        case CMD_TOR: snprintf(cmd, len, "tor %d %d", rand() % 360, rand() % 61 - 30); break;
+        case CMD_RAD: snprintf(cmd, len, "rad %s load test %lld", b->name, st.cmds_sent[CMD_RAD]); break;
+        default: snprintf(cmd, len, "%s", cmd_names[k]); break;
+    }
+}
+
+void bot_send_command(Bot *b, double t) {
+    char cmd[256]; bot_pick_command(b, cmd, sizeof(cmd));
+    CmdKind k = cmd_kind(cmd);
+    if (k == CMD_RAD) {
+        /* Radio travels as a PacketMessage, exactly like trek_client sends it */
+        PacketMessage m = {PKT_MESSAGE, "", 0, SCOPE_GLOBAL, 0, ""};
+        strncpy(m.from, b->name, 63); strncpy(m.text, cmd + 4, 4095);
+        bot_queue(b, &m, sizeof(m));
+    } else {
+        PacketCommand c = {PKT_COMMAND, ""};
+        strncpy(c.cmd, cmd, 255);
+        bot_queue(b, &c, sizeof(c));
+    }
+    st.cmds_sent[k]++;
+    b->pending = k; b->sent_ms = t;
+}
+
+void bot_on_message(Bot *b, PacketMessage *m, double t) {
+    st.messages++;
+    if (b->state == BOT_LOGIN && strcmp(m->from, "SERVER") == 0) {
+        b->state = BOT_SYNC; /* The raw galaxy blob follows the welcome */
+        return;
+    }
+    if (strcmp(m->from, "COMPUTER") == 0 && (strstr(m->text, "destroyed") || strstr(m->text, "EVENT HORIZON"))) {
+        st.deaths++; bot_close(b); return;
+    }
+    if (b->pending < 0) return;
+    const char *from = cmd_reply_from[b->pending];
+    if ((from == NULL && strcmp(m->from, b->name) == 0) || (from && (from[0] == '\0' || strcmp(m->from, from) == 0))) {
+        double l = t - b->sent_ms;
+        sample_add(&lat[b->pending], l); sample_add(&lat_all, l);
+        st.replies[b->pending]++;
+        b->pending = -1;
+        b->next_cmd_ms = t + think_ms * (0.5 + (rand() % 1000) / 1000.0);
+    }
+}
+
+void bot_on_update(Bot *b, PacketUpdate *u, double t) {
+    st.updates++;
+    if (b->state != BOT_ACTIVE) return;
+    if (b->last_upd_ms > 0) sample_add(&inter_arrival, t - b->last_upd_ms);
+    b->last_upd_ms = t;
+    b->energy = u->energy; b->torpedoes = u->torpedoes;
+}
+
+/* Stream framing: typed packets, plus the one untyped StarTrekGame right after the welcome */
+void bot_parse(Bot *b, double t) {
+    size_t off = 0;
+    while (b->fd >= 0 && b->rx_len - off >= sizeof(int)) {
+        int type; memcpy(&type, b->rx + off, sizeof(int));
+        size_t need;
+        if (b->state == BOT_SYNC && type != PKT_UPDATE && type != PKT_MESSAGE) need = sizeof(StarTrekGame);
+        else if (type == PKT_UPDATE) need = sizeof(PacketUpdate);
+        else if (type == PKT_MESSAGE) need = sizeof(PacketMessage);
+        else { st.protocol_errors++; bot_close(b); return; }
+        if (b->rx_len - off < need) break;
+
+        if (need == sizeof(StarTrekGame) && b->state == BOT_SYNC) {
+            b->state = BOT_ACTIVE; st.logins++;
+            b->last_upd_ms = 0; b->next_cmd_ms = t + think_ms * (rand() % 1000) / 1000.0;
+        } else if (type == PKT_UPDATE) {
+            PacketUpdate u; memcpy(&u, b->rx + off, sizeof(u)); bot_on_update(b, &u, t);
+        } else {
+            PacketMessage m; memcpy(&m, b->rx + off, sizeof(m));
+            m.from[63] = 0; m.text[4095] = 0;
+            bot_on_message(b, &m, t);
+        }
+        off += need;
+    }
+    if (b->fd >= 0 && off > 0) { memmove(b->rx, b->rx + off, b->rx_len - off); b->rx_len -= off; }
+}
+
+void bot_on_event(Bot *b, uint32_t events, double t) {
+    if (b->state == BOT_CONNECTING && (events & (EPOLLOUT | EPOLLERR | EPOLLHUP))) {
+        int err = 0; socklen_t el = sizeof(err);
+        getsockopt(b->fd, SOL_SOCKET, SO_ERROR, &err, &el);
+        if (err) { st.protocol_errors++; bot_close(b); return; }
+        PacketLogin l = {PKT_LOGIN, "", b->idx % 5, b->idx % 14};
+        strncpy(l.name, b->name, 63);
+        b->state = BOT_LOGIN;
+        bot_queue(b, &l, sizeof(l));
+        return;
+    }
+    if (events & EPOLLOUT) bot_flush(b);
+    if (b->fd < 0 || !(events & (EPOLLIN | EPOLLHUP | EPOLLERR))) return;
+    ssize_t n = recv(b->fd, b->rx + b->rx_len, RX_BUF - b->rx_len, 0);
+    if (n == 0 || (n < 0 && errno != EAGAIN)) {
+        /* Closed before the welcome: the server had no free slot */
+        if (b->state == BOT_LOGIN) st.rejected++;
+        else st.deaths++;
+        bot_close(b); return;
+    }
+    if (n > 0) { st.bytes_rx += n; b->rx_len += n; bot_parse(b, t); }
+}
+
+void print_progress(double elapsed_s, double window_s) {
+    long long sent = 0, sent_last = 0, replies = 0, replies_last = 0;
+    for (int k = 0; k < CMD_COUNT; k++) { sent += st.cmds_sent[k]; sent_last += st_last.cmds_sent[k]; replies += st.replies[k]; replies_last += st_last.replies[k]; }
+    int active = 0; for (int i = 0; i < bot_count; i++) if (bots[i].state == BOT_ACTIVE) active++;
+    printf("[%6.1fs] bots %d/%d | cmd %.0f/s reply %.0f/s | updates %.0f/s | rx %.2f MB/s | deaths %lld rejected %lld\n",
+           elapsed_s, active, bot_count, (sent - sent_last) / window_s, (replies - replies_last) / window_s,
+           (st.updates - st_last.updates) / window_s, (st.bytes_rx - st_last.bytes_rx) / window_s / 1e6, st.deaths, st.rejected);
+    fflush(stdout);
+    st_last = st;
+}
+
+void print_report(double elapsed_s) {
+    printf("\n--- TREK LOADGEN REPORT: %d bots, %.1f s ---\n", bot_count, elapsed_s);
+    printf("Connections %lld | logins %lld | rejected (server full) %lld | ships lost %lld | protocol errors %lld\n",
+           st.connects, st.logins, st.rejected, st.deaths, st.protocol_errors);
+    printf("%-6s %8s %8s %8s | %8s %8s %8s %8s\n", "CMD", "sent", "replies", "timeout", "p50 ms", "p90 ms", "p99 ms", "max ms");
+    for (int k = 0; k <= CMD_COUNT; k++) {
+        Samples *s = (k < CMD_COUNT) ? &lat[k] : &lat_all;
+        long long sent = 0, rep = 0, to = 0;
+        if (k < CMD_COUNT) { sent = st.cmds_sent[k]; rep = st.replies[k]; to = st.timeouts[k]; }
+        else for (int j = 0; j < CMD_COUNT; j++) { sent += st.cmds_sent[j]; rep += st.replies[j]; to += st.timeouts[j]; }
+        if (sent == 0) continue;
+        qsort(s->v, s->n, sizeof(double), cmp_double);
+        printf("%-6s %8lld %8lld %8lld | %8.2f %8.2f %8.2f %8.2f\n", k < CMD_COUNT ? cmd_names[k] : "ALL", sent, rep, to,
+               sample_pct(s, 50), sample_pct(s, 90), sample_pct(s, 99), sample_pct(s, 100));
+    }
+    qsort(inter_arrival.v, inter_arrival.n, sizeof(double), cmp_double);
+    double mean = 0, var = 0;
+    for (size_t i = 0; i < inter_arrival.n; i++) mean += inter_arrival.v[i];
+    if (inter_arrival.n) mean /= inter_arrival.n;
+    for (size_t i = 0; i < inter_arrival.n; i++) var += (inter_arrival.v[i] - mean) * (inter_arrival.v[i] - mean);
+    if (inter_arrival.n) var /= inter_arrival.n;
+    printf("Update inter-arrival (target %.1f ms): mean %.2f | p50 %.2f | p99 %.2f | max %.2f | jitter (stddev) %.2f ms\n",
+           TICK_MS, mean, sample_pct(&inter_arrival, 50), sample_pct(&inter_arrival, 99), sample_pct(&inter_arrival, 100), sqrt(var));
+    long long sent = 0; for (int k = 0; k < CMD_COUNT; k++) sent += st.cmds_sent[k];
+    printf("Throughput: %.1f cmd/s | %.1f updates/s | %.1f messages/s | %.2f MB/s received\n",
+           sent / elapsed_s, st.updates / elapsed_s, st.messages / elapsed_s, st.bytes_rx / elapsed_s / 1e6);
+}
+
+int load_script(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) { perror(path); return 0; }
+    char line[256];
+    while (script_len < MAX_SCRIPT && fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\r\n")] = 0;
+        if (line[0] == '\0' || line[0] == '#') continue;
+        script[script_len++] = strdup(line);
+    }
+    fclose(f);
+    return script_len > 0;
+}
+
+int parse_mix(const char *spec) {
+    char buf[256]; snprintf(buf, sizeof(buf), "%s", spec);
+    for (int k = 0; k < CMD_COUNT; k++) mix[k] = 0;
+    for (char *tok = strtok(buf, ","); tok; tok = strtok(NULL, ",")) {
+        char name[16]; int w;
+        if (sscanf(tok, "%15[a-z]=%d", name, &w) != 2) return 0;
+        CmdKind k = cmd_kind(name);
+        if (k == CMD_OTHER || w < 0) return 0;
+        mix[k] = w;
+    }
+    return 1;
+}
+
+void usage(const char *prog) {
+    printf("Usage: %s [-n bots] [-d seconds] [-t think_ms] [-r connects/s] [-m nav=1,imp=2,pha=1,tor=1,srs=2,lrs=1,rad=1]\n"
+           "          [-f script] [-s seed] [-x name_prefix] [server_ip [port]]\n", prog);
+}
+
+void on_signal(int sig) { (void)sig; g_running = 0; }
+
+int main(int argc, char *argv[]) {
+    int opt; unsigned seed = (unsigned)time(NULL);
+    while ((opt = getopt(argc, argv, "n:d:t:r:m:f:s:x:h")) != -1) {
+        switch (opt) {
+            case 'n': bot_count = atoi(optarg); break;
+            case 'd': duration_s = atof(optarg); break;
+            case 't': think_ms = atof(optarg); break;
+            case 'r': ramp_per_s = atof(optarg); break;
+            case 'm': if (!parse_mix(optarg)) { printf("Invalid command mix: %s\n", optarg); return 1; } break;
+            case 'f': if (!load_script(optarg)) return 1; break;
+            case 's': seed = (unsigned)strtoul(optarg, NULL, 10); break;
+            case 'x': name_prefix = optarg; break;
+            default: usage(argv[0]); return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (bot_count < 1 || duration_s <= 0 || ramp_per_s <= 0) { usage(argv[0]); return 1; }
+    srand(seed);
+
+    memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_port = htons(optind + 1 < argc ? atoi(argv[optind + 1]) : DEFAULT_PORT);
+    if (inet_pton(AF_INET, optind < argc ? argv[optind] : "127.0.0.1", &server_addr.sin_addr) <= 0) { printf("Invalid address\n"); return 1; }
+
+    /* Every bot needs one descriptor */
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < (rlim_t)bot_count + 16) {
+        rl.rlim_cur = (rl.rlim_max < (rlim_t)bot_count + 16) ? rl.rlim_max : (rlim_t)bot_count + 16;
+        setrlimit(RLIMIT_NOFILE, &rl);
+        if (rl.rlim_cur < (rlim_t)bot_count + 16) printf("Warning: descriptor limit %lu caps the swarm.\n", (unsigned long)rl.rlim_cur);
+    }
+
+    bots = calloc(bot_count, sizeof(Bot));
+    epfd = epoll_create1(0);
+    signal(SIGINT, on_signal); signal(SIGTERM, on_signal); signal(SIGPIPE, SIG_IGN);
+
+    printf("TREK LOADGEN: %d bots -> %s:%d for %.0f s (think %.0f ms, ramp %.0f/s, %s)\n", bot_count,
+           inet_ntoa(server_addr.sin_addr), ntohs(server_addr.sin_port), duration_s, think_ms, ramp_per_s, script_len ? "scripted" : "random mix");
+
+    struct epoll_event events[256];
+    double t_start = now_ms(), t_report = t_start, t = t_start;
+    /* Ramp-up: connections are spread over time instead of one SYN burst */
+    for (int i = 0; i < bot_count; i++) { bots[i].fd = -1; bots[i].idx = i; bots[i].pending = -1; bots[i].next_connect_ms = t_start + i * 1000.0 / ramp_per_s; }
+    while (g_running && t - t_start < duration_s * 1000.0) {
+        int n = epoll_wait(epfd, events, 256, 5);
+        t = now_ms();
+        for (int e = 0; e < n; e++) bot_on_event((Bot *)events[e].data.ptr, events[e].events, t);
+
+        for (int i = 0; i < bot_count; i++) {
+            Bot *b = &bots[i];
+            if (b->fd < 0 && t >= b->next_connect_ms) bot_connect(b);
+            if (b->state != BOT_ACTIVE) {
+                if (b->state != BOT_IDLE && t - b->connect_ms > STALL_MS) { st.protocol_errors++; bot_close(b); }
+                continue;
+            }
+            if (b->last_upd_ms > 0 && t - b->last_upd_ms > STALL_MS) { st.deaths++; bot_close(b); continue; }
+            if (b->pending >= 0 && t - b->sent_ms > REPLY_TIMEOUT_MS) { st.timeouts[b->pending]++; b->pending = -1; b->next_cmd_ms = t; }
+            if (b->pending < 0 && t >= b->next_cmd_ms) bot_send_command(b, t);
+        }
+
+        if (t - t_report >= REPORT_EVERY_MS) { print_progress((t - t_start) / 1000.0, (t - t_report) / 1000.0); t_report = t; }
+    }
+
+    print_report((t - t_start) / 1000.0);
+    for (int i = 0; i < bot_count; i++) bot_close(&bots[i]);
+    return 0;
+}
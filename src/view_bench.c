@@ -0,0 +1,358 @@
+#define _DEFAULT_SOURCE
+#define GL_GLEXT_PROTOTYPES
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include "view_bench.h"
+#include "view_gl.h"
+#include "view_quality.h"
+#include "view_capture.h"
+#include "network.h"
+
+#define REC_MAGIC "TREKREC1"
+
+typedef struct {
+    int frames, warmup, width, height, ships, png_every, scenery;
+    unsigned seed;
+    const char *input, *png_prefix, *label, *capture;
+    double fps;                     /* Adaptive quality target, 0: full quality throughout */
+} ViewBenchConfig;
+
+static ViewBenchConfig cfg = {600, 60, 1024, 768, 40, 0, 0, 1, NULL, "bench", "", NULL, 0};
+static GameState bench_state;
+static int bench_back = 0;
+static ShmFrame pending;            /* Next server frame, published once the virtual clock reaches it */
+static uint32_t boom_seq, dismantle_seq;
+
+/* --- Recording --- */
+
+void bench_record(FILE *out, const ShmFrame *f) {
+    if (ftell(out) == 0) {
+        int size = sizeof(ShmFrame);
+        fwrite(REC_MAGIC, 8, 1, out);
+        fwrite(&size, sizeof(size), 1, out);
+    }
+    fwrite(f, sizeof(ShmFrame), 1, out);
+}
+
+/* --- Synthetic scene: ships on circular patrols, with churn, phasers, explosions and wrecks --- */
+
+typedef struct { int id, type, ship_class; float cx, cy, cz, r, w, phase; } BenchShip;
+static BenchShip ships[MAX_OBJECTS];
+static unsigned rng;
+static int next_id = 1;
+
+static float frand() { rng = rng * 1103515245u + 12345u; return ((rng >> 8) & 0xffff) / 65536.0f; }
+
+static void spawn_ship(int i) {
+    BenchShip *s = &ships[i];
+    s->id = next_id++;
+    if (i == 0) { s->type = 1; s->ship_class = 0; }
+    else if (i % 9 == 1) s->type = 3 + (i / 9) % 4;             /* Base, star, planet, black hole */
+    else if (i % 3 == 2) { s->type = 1; s->ship_class = (int)(frand() * 13); }
+    else s->type = 10 + (int)(frand() * 11);
+    s->cx = 2 + frand() * 7; s->cy = 2 + frand() * 7; s->cz = 2 + frand() * 7;
+    s->r = s->type >= 3 && s->type <= 6 ? 0 : 0.5f + frand() * 1.5f;
+    s->w = (frand() - 0.5f) * 0.04f;
+    s->phase = frand() * 6.2832f;
+}
+
+static void synthetic_frame(ShmFrame *f, long long tick) {
+    int n = cfg.ships < MAX_OBJECTS ? cfg.ships : MAX_OBJECTS;
+    if (tick > 0 && tick % 90 == 0 && n > 1) spawn_ship(1 + (int)(tick / 90) % (n - 1)); /* One leaves, another arrives */
+    strcpy(f->quadrant, "Q-5-5-5");
+    f->shm_energy = 50000; f->klingons = n / 2; f->is_cloaked = 0;
+    for (int s = 0; s < 6; s++) f->shm_shields[s] = 1000;
+    f->object_count = n;
+    for (int i = 0; i < n; i++) {
+        BenchShip *s = &ships[i];
+        float a = s->phase + s->w * tick;
+        SharedObject *o = &f->objects[i];
+        o->shm_x = s->cx + s->r * cosf(a); o->shm_y = s->cy + s->r * sinf(a); o->shm_z = s->cz;
+        o->h = fmodf((a + (s->w > 0 ? 1.5708f : -1.5708f)) * 57.2958f + 720.0f, 360.0f);
+        o->m = 0;
+        o->type = s->type; o->ship_class = s->ship_class;
+        o->active = 1; o->health_pct = 100 - (i * 7) % 90; o->id = s->id;
+    }
+    f->torp.active = tick % 30 < 20;
+    f->torp.shm_x = 2 + (tick % 30) * 0.3f; f->torp.shm_y = 5; f->torp.shm_z = 5;
+    if (tick % 20 == 0 && n > 1) {
+        const SharedObject *t = &f->objects[1 + (int)(tick / 20) % (n - 1)];
+        SharedBeam b = {t->shm_x, t->shm_y, t->shm_z, 1};
+        shm_push_beam(&bench_state, &b);
+    }
+    if (tick % 60 == 0) { f->boom = (SharedPoint){2 + frand() * 7, 2 + frand() * 7, 2 + frand() * 7, 1}; boom_seq++; }
+    if (tick % 150 == 0) { f->dismantle = (SharedDismantle){2 + frand() * 7, 2 + frand() * 7, 2 + frand() * 7, 10, 1}; dismantle_seq++; }
+    f->boom_seq = boom_seq; f->dismantle_seq = dismantle_seq;
+    f->server_tick = tick;
+}
+
+/* --- Replay: frames recorded by --record, published on the virtual clock as they arrived --- */
+
+static FILE *replay = NULL;
+static ShmFrame replay_frame;
+static uint32_t replay_boom_seq, replay_dismantle_seq;
+static double replay_t0 = -1, replay_shift = 0;
+static long long replay_tick_shift = 0, replay_first_tick = 0, replay_last_tick = 0;
+
+static int replay_open(const char *path) {
+    char magic[8]; int size = 0;
+    if (!(replay = fopen(path, "rb"))) { perror(path); return 0; }
+    if (fread(magic, 8, 1, replay) != 1 || memcmp(magic, REC_MAGIC, 8) || fread(&size, sizeof(size), 1, replay) != 1 || size != sizeof(ShmFrame)) {
+        fprintf(stderr, "%s: not a recording of this build\n", path);
+        return 0;
+    }
+    return 1;
+}
+
+/* Next recorded frame, rewinding at the end with time and ticks carried on: 0 if the file has no frames */
+static int replay_next(ShmFrame *f, double *when) {
+    if (fread(&replay_frame, sizeof(ShmFrame), 1, replay) != 1) {
+        if (replay_t0 < 0) return 0;
+        replay_shift += replay_frame.recv_ms - replay_t0 + 1000.0 / NET_TICK_HZ;
+        replay_tick_shift += replay_last_tick - replay_first_tick + 1;
+        replay_t0 = -1;
+        fseek(replay, 8 + sizeof(int), SEEK_SET);
+        if (fread(&replay_frame, sizeof(ShmFrame), 1, replay) != 1) return 0;
+    }
+    if (replay_t0 < 0) { replay_t0 = replay_frame.recv_ms; replay_first_tick = replay_frame.server_tick; }
+    replay_last_tick = replay_frame.server_tick;
+    *f = replay_frame;
+    /* Event counters keep counting across loops, so the viewer sees every event once */
+    if (replay_frame.boom_seq != replay_boom_seq) boom_seq++;
+    if (replay_frame.dismantle_seq != replay_dismantle_seq) dismantle_seq++;
+    replay_boom_seq = replay_frame.boom_seq; replay_dismantle_seq = replay_frame.dismantle_seq;
+    f->boom_seq = boom_seq; f->dismantle_seq = dismantle_seq;
+    f->server_tick += replay_tick_shift;
+    *when = replay_frame.recv_ms - replay_t0 + replay_shift;
+    return 1;
+}
+
+/* --- PNG without libpng: stored deflate blocks --- */
+
+static uint32_t crc_table[256];
+
+static uint32_t crc32_update(uint32_t c, const unsigned char *p, size_t n) {
+    if (!crc_table[1])
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t v = i;
+            for (int k = 0; k < 8; k++) v = v & 1 ? 0xedb88320u ^ (v >> 1) : v >> 1;
+            crc_table[i] = v;
+        }
+    c = ~c;
+    while (n--) c = crc_table[(c ^ *p++) & 0xff] ^ (c >> 8);
+    return ~c;
+}
+
+static void put32(unsigned char *p, uint32_t v) { p[0] = v >> 24; p[1] = v >> 16; p[2] = v >> 8; p[3] = v; }
+
+static void png_chunk(FILE *out, const char *type, const unsigned char *data, uint32_t len) {
+    unsigned char head[8];
+    put32(head, len); memcpy(head + 4, type, 4);
+    uint32_t crc = crc32_update(crc32_update(0, head + 4, 4), data, len);
+    fwrite(head, 8, 1, out);
+    if (len) fwrite(data, len, 1, out);
+    put32(head, crc); fwrite(head, 4, 1, out);
+}
+
+static int write_png(const char *path, const unsigned char *rgb, int w, int h) {
+    size_t row = (size_t)w * 3 + 1, raw_len = row * h, blocks = (raw_len + 65534) / 65535;
+    unsigned char *raw = malloc(raw_len), *z = malloc(raw_len + blocks * 5 + 6);
+    for (int y = 0; y < h; y++) { raw[y * row] = 0; memcpy(raw + y * row + 1, rgb + (size_t)(h - 1 - y) * w * 3, w * 3); } /* GL rows are bottom-up */
+    size_t zl = 0;
+    z[zl++] = 0x78; z[zl++] = 0x01;
+    uint32_t a = 1, b = 0;
+    for (size_t off = 0; off < raw_len; off += 65535) {
+        size_t n = raw_len - off < 65535 ? raw_len - off : 65535;
+        z[zl++] = off + n == raw_len;
+        z[zl++] = n & 0xff; z[zl++] = n >> 8; z[zl++] = ~n & 0xff; z[zl++] = (~n >> 8) & 0xff;
+        memcpy(z + zl, raw + off, n); zl += n;
+        for (size_t i = 0; i < n; i++) { a = (a + raw[off + i]) % 65521; b = (b + a) % 65521; }
+    }
+    put32(z + zl, (b << 16) | a); zl += 4;
+
+    FILE *out = fopen(path, "wb");
+    if (out) {
+        unsigned char ihdr[13] = {0};
+        put32(ihdr, w); put32(ihdr + 4, h); ihdr[8] = 8; ihdr[9] = 2; /* 8-bit RGB: the cleared alpha is not part of the picture */
+        fwrite("\x89PNG\r\n\x1a\n", 8, 1, out);
+        png_chunk(out, "IHDR", ihdr, 13);
+        png_chunk(out, "IDAT", z, zl);
+        png_chunk(out, "IEND", NULL, 0);
+        fclose(out);
+    } else perror(path);
+    free(raw); free(z);
+    return out != NULL;
+}
+
+/* --- Bench loop --- */
+
+static int cmp_double(const void *a, const void *b) { double x = *(const double *)a, y = *(const double *)b; return (x > y) - (x < y); }
+
+static double pct(const double *sorted, int n, int p) { return sorted[(n - 1) * p / 100]; }
+
+static double now_ms() { return shm_now_ms(); }
+
+static void usage(const char *prog) {
+    printf("Usage: %s --bench [-f frames] [-u warmup frames] [-W width] [-H height] [-n ships] [-r seed]\n"
+           "          [-i recording] [-p png every N frames] [-o png prefix] [-g (grid and axes)] [-l label]\n"
+           "          [-q target fps (adaptive quality, off by default: images then depend on timing)]\n"
+           "          [-c capture.y4m (measured frames, read back asynchronously)]\n", prog);
+}
+
+int view_bench(int argc, char **argv) {
+    int opt;
+    while ((opt = getopt(argc, argv, "f:u:W:H:n:r:i:p:o:gl:q:c:h")) != -1) {
+        switch (opt) {
+            case 'f': cfg.frames = atoi(optarg); break;
+            case 'u': cfg.warmup = atoi(optarg); break;
+            case 'W': cfg.width = atoi(optarg); break;
+            case 'H': cfg.height = atoi(optarg); break;
+            case 'n': cfg.ships = atoi(optarg); break;
+            case 'r': cfg.seed = (unsigned)strtoul(optarg, NULL, 10); break;
+            case 'i': cfg.input = optarg; break;
+            case 'p': cfg.png_every = atoi(optarg); break;
+            case 'o': cfg.png_prefix = optarg; break;
+            case 'g': cfg.scenery = 1; break;
+            case 'l': cfg.label = optarg; break;
+            case 'q': cfg.fps = atof(optarg); break;
+            case 'c': cfg.capture = optarg; break;
+            default: usage("trek_3dview"); return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (cfg.frames < 1 || cfg.warmup < 0 || cfg.width < 16 || cfg.height < 16 || cfg.ships < 1) { usage("trek_3dview"); return 1; }
+    if (cfg.input && !replay_open(cfg.input)) return 1;
+
+    /* Surfaceless EGL context rendering into a framebuffer object */
+    EGLDisplay dpy = eglGetPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    EGLint cfg_attr[] = {EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE}, n_cfg = 0;
+    EGLConfig egl_cfg = (EGLConfig)0;   /* EGL_NO_CONFIG_KHR: drivers without pbuffer configs still make a context */
+    EGLContext ctx = EGL_NO_CONTEXT;
+    if (dpy != EGL_NO_DISPLAY && eglInitialize(dpy, NULL, NULL) && eglBindAPI(EGL_OPENGL_API)) {
+        if (!eglChooseConfig(dpy, cfg_attr, &egl_cfg, 1, &n_cfg) || n_cfg < 1) egl_cfg = (EGLConfig)0;
+        EGLint ctx_attr[] = {EGL_CONTEXT_MAJOR_VERSION, 3, EGL_CONTEXT_MINOR_VERSION, 3,
+                             EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT, EGL_NONE}; /* As the window */
+        ctx = eglCreateContext(dpy, egl_cfg, EGL_NO_CONTEXT, ctx_attr);
+    }
+    if (ctx == EGL_NO_CONTEXT || !eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx)) {
+        fprintf(stderr, "view bench: no surfaceless EGL context (error 0x%x)\n", eglGetError());
+        return 1;
+    }
+    GLuint fbo, rb[2];
+    glGenFramebuffers(1, &fbo); glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glGenRenderbuffers(2, rb);
+    glBindRenderbuffer(GL_RENDERBUFFER, rb[0]); glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, cfg.width, cfg.height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, rb[0]);
+    glBindRenderbuffer(GL_RENDERBUFFER, rb[1]); glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, cfg.width, cfg.height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rb[1]);
+
+    g_headless = 1;
+    if (!viewInit()) return 1;
+    qual_target(cfg.fps, 1);
+    qual_finish(1);                 /* The bench finishes every frame anyway: no queries next to its own */
+    reshape(cfg.width, cfg.height);
+    g_shared_state = &bench_state;
+    shm_init(&bench_state);
+    bench_state.shm_show_axes = bench_state.shm_show_grid = cfg.scenery;
+    rng = cfg.seed;
+    for (int i = 0; i < cfg.ships && i < MAX_OBJECTS; i++) spawn_ship(i);
+    fprintf(stderr, "--- VIEW BENCH: %s, %dx%d, %s, %d frames after %d warmup ---\n", (const char *)glGetString(GL_RENDERER),
+            cfg.width, cfg.height, cfg.input ? cfg.input : "synthetic scene", cfg.frames, cfg.warmup);
+
+    int total = cfg.warmup + cfg.frames;
+    double *cpu = malloc(sizeof(double) * cfg.frames), *gpu = malloc(sizeof(double) * cfg.frames), *frame = malloc(sizeof(double) * cfg.frames);
+    double *pick = malloc(sizeof(double) * cfg.frames);
+    int picked = 0;
+    unsigned pick_rng = cfg.seed;
+    unsigned char *pixels = cfg.png_every > 0 ? malloc((size_t)cfg.width * cfg.height * 3) : NULL;
+    long draws = 0, vertices = 0;
+    long long tick = 0;
+    double pending_ms = -1;
+    ShmFrame *f = &bench_state.frames[bench_back];
+    GLuint query[2];
+    glGenQueries(2, query);
+    for (int k = 0; k < total; k++) {
+        g_bench_clock = k * BENCH_FRAME_MS;
+        /* Server frames due by now, stamped as if they arrived on time */
+        for (;;) {
+            if (pending_ms < 0) {
+                if (!replay) { synthetic_frame(&pending, tick); pending_ms = tick * (1000.0 / NET_TICK_HZ); }
+                else if (!replay_next(&pending, &pending_ms)) { fprintf(stderr, "%s: no frames\n", cfg.input); return 1; }
+                pending.frame_id = ++tick;
+                pending.recv_ms = pending_ms;
+            }
+            if (pending_ms > g_bench_clock) break;
+            *f = pending;
+            f = shm_publish(&bench_state, &bench_back);
+            pending_ms = -1;
+        }
+
+        if (k == cfg.warmup && cfg.capture && !capture_open(cfg.capture, cfg.width, cfg.height)) return 1;
+        long d0 = vgl_stats.draws, v0 = vgl_stats.vertices;
+        double t0 = now_ms();
+        glQueryCounter(query[0], GL_TIMESTAMP);
+        display();
+        glQueryCounter(query[1], GL_TIMESTAMP);
+        double t1 = now_ms();
+        glFinish();
+        double t2 = now_ms();
+        GLuint64 gpu0 = 0, gpu1 = 0;
+        glGetQueryObjectui64v(query[0], GL_QUERY_RESULT, &gpu0);
+        glGetQueryObjectui64v(query[1], GL_QUERY_RESULT, &gpu1);
+        /* Picking reads the frame just drawn, as a click would, and draws nothing: the images stay the same */
+        pick_rng = pick_rng * 1103515245u + 12345u;            /* Own sequence: the scene's stays as it was */
+        int px = (pick_rng >> 8) % cfg.width, py = (pick_rng >> 20) % cfg.height;
+        double t3 = now_ms();
+        int hit = pickAt(px, py);
+        double t4 = now_ms();
+        viewTick();
+
+        if (k < cfg.warmup) continue;
+        int i = k - cfg.warmup;
+        cpu[i] = t1 - t0; frame[i] = t2 - t0; gpu[i] = (gpu1 - gpu0) / 1e6; pick[i] = t4 - t3;
+        picked += hit >= 0;
+        draws += vgl_stats.draws - d0; vertices += vgl_stats.vertices - v0;
+        if (pixels && i % cfg.png_every == 0) {
+            char path[512];
+            snprintf(path, sizeof(path), "%s_%05d.png", cfg.png_prefix, i);
+            glPixelStorei(GL_PACK_ALIGNMENT, 1);
+            glReadPixels(0, 0, cfg.width, cfg.height, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+            write_png(path, pixels, cfg.width, cfg.height);
+        }
+    }
+    capture_close();
+    GLenum err = glGetError();
+
+    int nf = cfg.frames;
+    qsort(cpu, nf, sizeof(double), cmp_double);
+    qsort(gpu, nf, sizeof(double), cmp_double);
+    qsort(frame, nf, sizeof(double), cmp_double);
+    qsort(pick, nf, sizeof(double), cmp_double);
+    printf("{\"bench\":\"view\",\"label\":\"%s\",\"scene\":\"%s\",\"ships\":%d,\"seed\":%u,\"width\":%d,\"height\":%d,\"frames\":%d,\"scenery\":%d,"
+           "\"cpu_ms_p50\":%.3f,\"cpu_ms_p90\":%.3f,\"cpu_ms_p99\":%.3f,\"cpu_ms_max\":%.3f,"
+           "\"gpu_ms_p50\":%.3f,\"gpu_ms_p90\":%.3f,\"gpu_ms_p99\":%.3f,\"gpu_ms_max\":%.3f,"
+           "\"frame_ms_p50\":%.3f,\"frame_ms_p90\":%.3f,\"frame_ms_p99\":%.3f,\"frame_ms_max\":%.3f,"
+           "\"pick_ms_p50\":%.4f,\"pick_ms_p99\":%.4f,\"pick_ms_max\":%.4f,\"pick_hits\":%d,"
+           "\"draws_per_frame\":%.1f,\"vertices_per_frame\":%.0f,\"quality_level\":%d,\"gl_error\":%u}\n",
+           cfg.label, cfg.input ? "replay" : "synthetic", cfg.input ? 0 : cfg.ships, cfg.seed, cfg.width, cfg.height, nf, cfg.scenery,
+           pct(cpu, nf, 50), pct(cpu, nf, 90), pct(cpu, nf, 99), cpu[nf - 1],
+           pct(gpu, nf, 50), pct(gpu, nf, 90), pct(gpu, nf, 99), gpu[nf - 1],
+           pct(frame, nf, 50), pct(frame, nf, 90), pct(frame, nf, 99), frame[nf - 1],
+           pct(pick, nf, 50), pct(pick, nf, 99), pick[nf - 1], picked,
+           (double)draws / nf, (double)vertices / nf, qual_level(), err);
+    fprintf(stderr, "cpu   p50 %8.3f ms  p99 %8.3f ms\ngpu   p50 %8.3f ms  p99 %8.3f ms\nframe p50 %8.3f ms  p99 %8.3f ms\npick  p50 %8.4f ms  p99 %8.4f ms\n%.1f draws, %.0f vertices per frame\n",
+            pct(cpu, nf, 50), pct(cpu, nf, 99), pct(gpu, nf, 50), pct(gpu, nf, 99), pct(frame, nf, 50), pct(frame, nf, 99), pct(pick, nf, 50), pct(pick, nf, 99),
+            (double)draws / nf, (double)vertices / nf);
+    free(cpu); free(gpu); free(frame); free(pick); free(pixels);
+    if (replay) fclose(replay);
+    eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(dpy, ctx);
+    eglTerminate(dpy);
+    return err != GL_NO_ERROR;
+}
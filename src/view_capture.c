@@ -0,0 +1,168 @@
+#define _DEFAULT_SOURCE
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "view_capture.h"
+
+enum { SLOT_FREE, SLOT_READING, SLOT_ENCODING, SLOT_DONE };
+
+typedef struct {
+    GLuint pbo;
+    GLsync fence;
+    int state;                      /* SLOT_DONE is set by the encoder thread, everything else by the render loop */
+    int repeat;                     /* Stream frames this one fills */
+    const unsigned char *pixels;    /* Mapping while encoding: RGBA, bottom row first */
+} CaptureSlot;
+
+static CaptureSlot slots[CAPTURE_SLOTS];
+static int next_slot = 0;           /* Slots are used round-robin, so frames stay in order */
+static int oldest = 0;              /* Oldest slot not yet handed to the encoder */
+static int cap_w = 0, cap_h = 0;
+static FILE *out = NULL;
+static unsigned char *planes = NULL; /* Y, Cb, Cr of one frame: the encoder thread's */
+static long frames = 0, repeated = 0, dropped = 0;
+static double start_ms = -1;
+static long planned = 0;            /* Stream frames given out so far, repeats included */
+
+/* Slots to encode, in order: render loop -> encoder thread */
+static int queue[CAPTURE_SLOTS], q_head = 0, q_tail = 0, closing = 0;
+static pthread_mutex_t q_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t q_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t encoder;
+
+/* 4:2:0, BT.601 full range (C420jpeg): luma per pixel, chroma from each 2x2 block's sum */
+static inline unsigned char luma(const unsigned char *p) { return (unsigned char)((19595 * p[0] + 38470 * p[1] + 7471 * p[2] + 32768) >> 16); }
+static inline unsigned char chroma(int v) { return (unsigned char)((v < 0 ? 0 : v > (255 << 18) ? (255 << 18) : v) >> 18); }
+
+static void encode(const unsigned char *rgba, int repeat) {
+    int cw = cap_w / 2;
+    unsigned char *pu = planes + cap_w * cap_h, *pv = pu + cw * (cap_h / 2);
+    for (int y = 0; y < cap_h; y += 2) {
+        const unsigned char *a = rgba + (size_t)(cap_h - 1 - y) * cap_w * 4, *b = a - (size_t)cap_w * 4; /* GL rows run bottom up */
+        unsigned char *ya = planes + (size_t)y * cap_w, *yb = ya + cap_w, *u = pu + (y / 2) * cw, *v = pv + (y / 2) * cw;
+        for (int x = 0; x < cw; x++, a += 8, b += 8) {
+            ya[2 * x] = luma(a); ya[2 * x + 1] = luma(a + 4);
+            yb[2 * x] = luma(b); yb[2 * x + 1] = luma(b + 4);
+            int r = a[0] + a[4] + b[0] + b[4], g = a[1] + a[5] + b[1] + b[5], bl = a[2] + a[6] + b[2] + b[6];
+            u[x] = chroma((128 << 18) + (1 << 17) - 11059 * r - 21709 * g + 32768 * bl);
+            v[x] = chroma((128 << 18) + (1 << 17) + 32768 * r - 27439 * g - 5329 * bl);
+        }
+    }
+    for (int k = 0; k < repeat; k++) {
+        fputs("FRAME\n", out);
+        fwrite(planes, 1, (size_t)cap_w * cap_h * 3 / 2, out);
+    }
+}
+
+static void *encoder_main(void *arg) {
+    for (;;) {
+        pthread_mutex_lock(&q_lock);
+        while (q_head == q_tail && !closing) pthread_cond_wait(&q_cond, &q_lock);
+        if (q_head == q_tail) { pthread_mutex_unlock(&q_lock); return NULL; }
+        int s = queue[q_tail % CAPTURE_SLOTS];
+        pthread_mutex_unlock(&q_lock);
+        encode(slots[s].pixels, slots[s].repeat);
+        pthread_mutex_lock(&q_lock);
+        q_tail++;
+        pthread_mutex_unlock(&q_lock);
+        __atomic_store_n(&slots[s].state, SLOT_DONE, __ATOMIC_RELEASE);
+    }
+}
+
+int capture_active() { return out != NULL; }
+
+int capture_open(const char *path, int width, int height) {
+    cap_w = width & ~1; cap_h = height & ~1;
+    if (cap_w < 2 || cap_h < 2) return 0;
+    if (!(out = fopen(path, "wb"))) { perror(path); return 0; }
+    fprintf(out, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", cap_w, cap_h, CAPTURE_FPS);
+    frames = repeated = dropped = planned = 0; start_ms = -1;
+    planes = malloc((size_t)cap_w * cap_h * 3 / 2);
+    for (int i = 0; i < CAPTURE_SLOTS; i++) {
+        glGenBuffers(1, &slots[i].pbo);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slots[i].pbo);
+        glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)cap_w * cap_h * 4, NULL, GL_STREAM_READ);
+        slots[i].state = SLOT_FREE;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    closing = 0;
+    if (pthread_create(&encoder, NULL, encoder_main, NULL) != 0) { perror("pthread_create"); fclose(out); out = NULL; return 0; }
+    fprintf(stderr, "--- CAPTURE: %s, %dx%d ---\n", path, cap_w, cap_h);
+    return 1;
+}
+
+/* Moves slots along: finished encodes are unmapped, signalled reads go to the encoder in order. `wait` blocks on the oldest read */
+static void advance(int wait) {
+    for (int i = 0; i < CAPTURE_SLOTS; i++) {
+        CaptureSlot *s = &slots[i];
+        if (__atomic_load_n(&s->state, __ATOMIC_ACQUIRE) != SLOT_DONE) continue;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, s->pbo);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        s->pixels = NULL;
+        s->state = SLOT_FREE;
+    }
+    while (slots[oldest].state == SLOT_READING) {
+        CaptureSlot *s = &slots[oldest];
+        GLenum r = glClientWaitSync(s->fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? 1000000000 : 0);
+        if (r != GL_ALREADY_SIGNALED && r != GL_CONDITION_SATISFIED) break;
+        glDeleteSync(s->fence);
+        s->fence = NULL;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, s->pbo);
+        s->pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)cap_w * cap_h * 4, GL_MAP_READ_BIT);
+        if (!s->pixels) { s->state = SLOT_FREE; dropped++; planned -= s->repeat; }  /* Its time goes to the next frame */
+        else {
+            s->state = SLOT_ENCODING;
+            pthread_mutex_lock(&q_lock);
+            queue[q_head++ % CAPTURE_SLOTS] = oldest;
+            pthread_cond_signal(&q_cond);
+            pthread_mutex_unlock(&q_lock);
+            frames += s->repeat; repeated += s->repeat - 1;
+        }
+        oldest = (oldest + 1) % CAPTURE_SLOTS;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void capture_size(int *width, int *height) { *width = cap_w; *height = cap_h; }
+
+void capture_frame(double now_ms) {
+    if (!out) return;
+    advance(0);
+    /* Stream frames due by now: a frame that is not read back leaves its time to the next one */
+    if (start_ms < 0) start_ms = now_ms;
+    long due = (long)((now_ms - start_ms) * CAPTURE_FPS / 1000.0) + 1;
+    if (due <= planned) return;     /* Drawing faster than the stream */
+    CaptureSlot *s = &slots[next_slot];
+    GLint vp[4];
+    glGetIntegerv(GL_VIEWPORT, vp);
+    if (s->state != SLOT_FREE || vp[2] < cap_w || vp[3] < cap_h) { dropped++; return; } /* Encoder behind, or the window not back to size yet */
+    s->repeat = (int)(due - planned);
+    planned = due;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, s->pbo);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, cap_w, cap_h, GL_RGBA, GL_UNSIGNED_BYTE, 0); /* Into the buffer: returns at once */
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    s->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    s->state = SLOT_READING;
+    next_slot = (next_slot + 1) % CAPTURE_SLOTS;
+}
+
+void capture_close() {
+    if (!out) return;
+    advance(1);
+    while (slots[oldest].state == SLOT_READING) advance(1);
+    pthread_mutex_lock(&q_lock);
+    closing = 1;
+    pthread_cond_signal(&q_cond);
+    pthread_mutex_unlock(&q_lock);
+    pthread_join(encoder, NULL);
+    advance(0);                     /* Unmaps the last ones */
+    for (int i = 0; i < CAPTURE_SLOTS; i++) glDeleteBuffers(1, &slots[i].pbo);
+    fclose(out);
+    out = NULL;
+    free(planes); planes = NULL;
+    fprintf(stderr, "--- CAPTURE: %ld frames written (%ld repeats filling gaps), %ld dropped ---\n", frames, repeated, dropped);
+}
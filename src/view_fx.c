@@ -0,0 +1,217 @@
+#define _DEFAULT_SOURCE
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include <math.h>
+#include "view_fx.h"
+#include "view_gl.h"
+
+static FxParticle pool[FX_MAX_PARTICLES];
+static unsigned long head = 0;          /* Particles ever emitted: the next slot is head % FX_MAX_PARTICLES */
+static unsigned long uploaded = 0;      /* `head` at the last upload */
+static long clock_ticks = 0, epoch = 0; /* Birth ticks are relative to `epoch` */
+static float live_until = 0;            /* Latest death of any particle: nothing to draw after it */
+static unsigned rng = 12345;
+static float density = 1.0f, density_acc = 0;
+
+static GLuint fx_prog = 0, fx_vao = 0, fx_vbo = 0;
+static GLint u_now = -1;
+
+static float frand() { rng = rng * 1103515245u + 12345u; return ((rng >> 8) & 0xffff) / 65536.0f; }
+
+/* Uniform direction times a speed in [lo, hi) */
+static void rand_dir(float *v, float lo, float hi) {
+    float z = frand() * 2.0f - 1.0f, a = frand() * 6.2832f, r = sqrtf(1.0f - z * z), s = lo + frand() * (hi - lo);
+    v[0] = r * cosf(a) * s; v[1] = r * sinf(a) * s; v[2] = z * s;
+}
+
+static void emit(float x, float y, float z, const float *v, float size0, float size1, float life,
+                 float r, float g, float b, float a, unsigned flags) {
+    /* Thinned evenly: the bulk of every effect is its pixel particles, fireballs and beams always go out */
+    if (flags & FX_PIXELS) {
+        if ((density_acc += density) < 1.0f) return;
+        density_acc -= 1.0f;
+    }
+    FxParticle *p = &pool[head++ % FX_MAX_PARTICLES];
+    p->p[0] = x; p->p[1] = y; p->p[2] = z;
+    if (v) memcpy(p->v, v, sizeof(p->v)); else p->v[0] = p->v[1] = p->v[2] = 0;
+    p->size[0] = size0; p->size[1] = size1;
+    p->birth = (float)(clock_ticks - epoch); p->life = life;
+    float c[4] = {r, g, b, a};
+    for (int i = 0; i < 4; i++) p->c[i] = (unsigned char)((c[i] < 0 ? 0 : c[i] > 1 ? 1 : c[i]) * 255.0f + 0.5f);
+    p->flags = flags;
+    if (p->birth + life > live_until) live_until = p->birth + life;
+}
+
+void fx_density(float d) { density = d < 0.05f ? 0.05f : d > 1.0f ? 1.0f : d; }
+
+/* --- Effects --- */
+
+void fx_explosion(float x, float y, float z) {
+    float v[3];
+    emit(x, y, z, NULL, 0.6f, 2.8f, 40, 1.0f, 0.5f, 0.0f, 1.0f, FX_SOFT);          /* Fireball, as wide as the old sphere */
+    emit(x, y, z, NULL, 0.2f, 1.2f, 20, 1.0f, 0.9f, 0.5f, 1.0f, FX_SOFT);          /* Hot core */
+    for (int i = 0; i < 48; i++) {
+        rand_dir(v, 0.03f, 0.08f);
+        emit(x, y, z, v, 3.0f, 1.0f, 30 + frand() * 20, 1.0f, 0.6f + frand() * 0.4f, 0.1f, 1.0f, FX_PIXELS);
+    }
+}
+
+/* Hull fragments: 100 debris points in random colours, drifting apart for a second */
+void fx_dismantle(float x, float y, float z) {
+    for (int i = 0; i < 100; i++) {
+        float v[3] = {(frand() - 0.5f) * 0.2f, (frand() - 0.5f) * 0.2f, (frand() - 0.5f) * 0.2f};
+        emit(x, y, z, v, 3.0f, 3.0f, 60, frand(), frand(), frand(), 1.0f, FX_PIXELS);
+    }
+}
+
+void fx_phaser(const float *from, const float *to) {
+    float v[3];
+    emit(from[0], from[1], from[2], to, 4.0f, 4.0f, 30, 1.0f, 0.8f, 0.0f, 1.0f, FX_BEAM | FX_HOLD);
+    for (int i = 0; i < 8; i++) {                                                   /* Impact sparks */
+        rand_dir(v, 0.01f, 0.03f);
+        emit(to[0], to[1], to[2], v, 2.0f, 1.0f, 15 + frand() * 10, 1.0f, 0.9f, 0.4f, 1.0f, FX_PIXELS);
+    }
+}
+
+void fx_torpedo_wake(float x, float y, float z) {
+    float v[3];
+    for (int i = 0; i < 2; i++) {
+        rand_dir(v, 0.0f, 0.004f);
+        emit(x, y, z, v, 0.12f, 0.02f, 18, 1.0f, 0.3f, 0.05f, 0.8f, FX_SOFT);
+    }
+}
+
+/* A ship dropping out of warp: blue-white flash and a burst of streaks */
+void fx_warp_flash(float x, float y, float z) {
+    float v[3];
+    emit(x, y, z, NULL, 0.1f, 1.4f, 24, 0.6f, 0.8f, 1.0f, 1.0f, FX_SOFT);
+    emit(x, y, z, NULL, 0.05f, 0.5f, 12, 1.0f, 1.0f, 1.0f, 1.0f, FX_SOFT);
+    for (int i = 0; i < 12; i++) {
+        rand_dir(v, 0.1f, 0.16f);
+        emit(x, y, z, v, 2.0f, 1.0f, 12, 0.8f, 0.9f, 1.0f, 1.0f, FX_PIXELS);
+    }
+}
+
+int fx_busy() { return live_until > (float)(clock_ticks - epoch); }
+
+void fx_tick() {
+    clock_ticks++;
+    if (clock_ticks - epoch < FX_REBASE_TICKS) return;
+    /* Shift every birth back and upload the whole pool once */
+    float shift = (float)(clock_ticks - epoch);
+    for (int i = 0; i < FX_MAX_PARTICLES; i++) pool[i].birth -= shift;
+    live_until -= shift;
+    epoch = clock_ticks;
+    uploaded = head > FX_MAX_PARTICLES ? head - FX_MAX_PARTICLES : 0;
+}
+
+/* --- GPU side --- */
+
+static const char *vertex_src =
+    "#version 330 core\n"
+    VGL_FRAME_GLSL
+    "layout(location = 0) in vec3 a_pos;\n"
+    "layout(location = 1) in vec3 a_vel;\n"
+    "layout(location = 2) in vec2 a_size;\n"
+    "layout(location = 3) in vec2 a_time;\n"
+    "layout(location = 4) in vec4 a_color;\n"
+    "layout(location = 5) in uint a_flags;\n"
+    "uniform float u_now;\n"
+    "out vec4 v_color;\n"
+    "out vec2 v_uv;\n"
+    "flat out uint v_flags;\n"
+    "void main() {\n"
+    "    float age = u_now - a_time.x;\n"
+    "    v_flags = a_flags;\n"
+    "    v_uv = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;\n"
+    "    if (age < 0.0 || age >= a_time.y) { gl_Position = vec4(2.0, 2.0, 2.0, 1.0); v_color = vec4(0.0); return; }\n"
+    "    float t = age / a_time.y, size = mix(a_size.x, a_size.y, t);\n"
+    "    float fade = (a_flags & 8u) != 0u ? min(1.0, 1.5 * (1.0 - t)) : 1.0 - t;\n"
+    "    v_color = vec4(a_color.rgb, a_color.a * fade);\n"
+    "    if ((a_flags & 4u) != 0u) {\n"
+    "        vec4 c0 = proj * view * vec4(a_pos, 1.0), c1 = proj * view * vec4(a_vel, 1.0);\n"
+    "        vec2 d = c1.xy / c1.w * viewport.zw - c0.xy / c0.w * viewport.zw;\n"
+    "        vec2 n = length(d) > 0.0 ? normalize(vec2(-d.y, d.x)) : vec2(0.0, 1.0);\n"
+    "        gl_Position = v_uv.y < 0.0 ? c0 : c1;\n"
+    "        gl_Position.xy += n * v_uv.x * size / viewport.zw * gl_Position.w;\n"
+    "    } else if ((a_flags & 2u) != 0u) {\n"
+    "        gl_Position = proj * view * vec4(a_pos + a_vel * age, 1.0);\n"
+    "        gl_Position.xy += v_uv * size / viewport.zw * gl_Position.w;\n"
+    "    } else {\n"
+    "        vec4 eye = view * vec4(a_pos + a_vel * age, 1.0);\n"
+    "        eye.xy += v_uv * size;\n"
+    "        gl_Position = proj * eye;\n"
+    "    }\n"
+    "}\n";
+
+static const char *fragment_src =
+    "#version 330 core\n"
+    "in vec4 v_color;\n"
+    "in vec2 v_uv;\n"
+    "flat in uint v_flags;\n"
+    "out vec4 frag;\n"
+    "void main() {\n"
+    "    float a = v_color.a;\n"
+    "    if ((v_flags & 1u) != 0u) { float r = 1.0 - dot(v_uv, v_uv); if (r <= 0.0) discard; a *= r * r; }\n"
+    "    frag = vec4(v_color.rgb, a);\n"
+    "}\n";
+
+int fx_init() {
+    if (!(fx_prog = vgl_program("effects", vertex_src, fragment_src))) return 0;
+    u_now = glGetUniformLocation(fx_prog, "u_now");
+
+    /* One instance per particle, the quad corner comes from gl_VertexID */
+    glGenVertexArrays(1, &fx_vao);
+    glBindVertexArray(fx_vao);
+    glGenBuffers(1, &fx_vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, fx_vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(pool), pool, GL_DYNAMIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(FxParticle), (void *)offsetof(FxParticle, p));
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(FxParticle), (void *)offsetof(FxParticle, v));
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(FxParticle), (void *)offsetof(FxParticle, size));
+    glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(FxParticle), (void *)offsetof(FxParticle, birth));
+    glVertexAttribPointer(4, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(FxParticle), (void *)offsetof(FxParticle, c));
+    glVertexAttribIPointer(5, 1, GL_UNSIGNED_INT, sizeof(FxParticle), (void *)offsetof(FxParticle, flags));
+    for (int i = 0; i < 6; i++) { glEnableVertexAttribArray(i); glVertexAttribDivisor(i, 1); }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    uploaded = head;
+
+    fprintf(stderr, "--- EFFECTS: %d particle pool (%zu KB) ---\n", FX_MAX_PARTICLES, sizeof(pool) / 1024);
+    return 1;
+}
+
+/* Slots [from, to) of the ring, split where it wraps */
+static void upload(unsigned long from, unsigned long to) {
+    int a = from % FX_MAX_PARTICLES, n = to - from;
+    int first = n < FX_MAX_PARTICLES - a ? n : FX_MAX_PARTICLES - a;
+    glBufferSubData(GL_ARRAY_BUFFER, a * sizeof(FxParticle), first * sizeof(FxParticle), &pool[a]);
+    if (n > first) glBufferSubData(GL_ARRAY_BUFFER, 0, (n - first) * sizeof(FxParticle), pool);
+}
+
+void fx_draw() {
+    if (!fx_prog) return;
+    if (head != uploaded) {
+        if (head - uploaded > FX_MAX_PARTICLES) uploaded = head - FX_MAX_PARTICLES;
+        glBindBuffer(GL_ARRAY_BUFFER, fx_vbo);
+        upload(uploaded, head);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        uploaded = head;
+    }
+    float now = (float)(clock_ticks - epoch);
+    if (now >= live_until) return;
+    int count = head < FX_MAX_PARTICLES ? (int)head : FX_MAX_PARTICLES;
+    glUseProgram(fx_prog);
+    glUniform1f(u_now, now);
+    glBindVertexArray(fx_vao);
+    glDepthMask(GL_FALSE);              /* Translucent: tested against the scene, hidden by nothing of their own */
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+    glDepthMask(GL_TRUE);
+    glBindVertexArray(0);
+    glUseProgram(0);
+    vgl_stats.draws++; vgl_stats.vertices += 4L * count;
+}
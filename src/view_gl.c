@@ -0,0 +1,339 @@
+#define _DEFAULT_SOURCE
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include "view_gl.h"
+#include "view_mesh.h"
+
+typedef struct {
+    float p[3];
+    GLubyte c[4];
+} VglVertex;
+
+typedef struct {
+    GLenum mode;
+    int first, count;
+    float size;
+    int flags;
+} VglRun;
+
+typedef struct { int first, count; VglRun runs[VGL_MAX_RUNS]; int run_count; } VglList;
+
+/* Runs called since the last flush */
+static VglRun runs[VGL_MAX_RUNS];
+static int run_count = 0;
+
+/* Lists, kept in host memory until vgl_init() */
+static VglVertex *lists_data = NULL;
+static int lists_count = 0, lists_cap = 0;
+static VglList lists[VGL_MAX_LISTS];
+static int list_count = 0, recording = -1;
+
+/* Primitive being built */
+static int prim = -1, prim_first = 0, prim_flags = 0;
+static float prim_size = 1.0f;
+static GLubyte color[4] = {255, 255, 255, 255};
+static VglVertex scratch[VGL_MAX_VERTICES];
+
+static ViewFrame frame;
+VglStats vgl_stats;
+static VglStream *streams[VGL_MAX_STREAMS];
+static int stream_total = 0, persistent = -1;
+static GLuint frame_ubo = 0, vgl_prog = 0, static_vao = 0, static_vbo = 0;
+static GLint u_screen = -1, u_size = -1;
+
+/* --- Batching --- */
+
+/* Room for `more` vertices after the list data */
+static void reserve(int more) {
+    if (lists_count + more <= lists_cap) return;
+    while (lists_count + more > lists_cap) lists_cap = lists_cap ? lists_cap * 2 : 4096;
+    lists_data = realloc(lists_data, lists_cap * sizeof(VglVertex));
+}
+
+static void add_run(VglRun *list, int *n, const VglRun *r) {
+    VglRun *last = *n ? &list[*n - 1] : NULL;
+    if (last && last->mode == r->mode && last->size == r->size && last->flags == r->flags &&
+        last->first + last->count == r->first) {
+        last->count += r->count;
+        return;
+    }
+    if (*n < VGL_MAX_RUNS) list[(*n)++] = *r;
+}
+
+int vgl_list_begin() {
+    if (list_count >= VGL_MAX_LISTS) return -1;
+    recording = list_count++;
+    lists[recording].first = lists_count;
+    lists[recording].run_count = 0;
+    return recording;
+}
+
+void vgl_list_end() {
+    if (recording < 0) return;
+    lists[recording].count = lists_count - lists[recording].first;
+    recording = -1;
+}
+
+void vgl_begin(int p, float size, int flags) {
+    if (recording < 0) return;
+    prim = p; prim_first = lists_count; prim_size = size; prim_flags = flags;
+}
+
+void vgl_color3(float r, float g, float b) { vgl_color4(r, g, b, 1.0f); }
+
+void vgl_color4(float r, float g, float b, float a) {
+    float c[4] = {r, g, b, a};
+    for (int i = 0; i < 4; i++) color[i] = (GLubyte)((c[i] < 0 ? 0 : c[i] > 1 ? 1 : c[i]) * 255.0f + 0.5f);
+}
+
+void vgl_vertex(float x, float y, float z) {
+    if (prim < 0 || lists_count - prim_first >= VGL_MAX_VERTICES) return;
+    reserve(1);
+    lists_data[lists_count++] = (VglVertex){{x, y, z}, {color[0], color[1], color[2], color[3]}};
+}
+
+/* Strips, loops and quads become independent lines and triangles so that consecutive primitives share a draw */
+void vgl_end() {
+    if (prim < 0) return;
+    int n = lists_count - prim_first, out = 0;
+    GLenum mode = prim == VGL_POINTS ? GL_POINTS : (prim == VGL_TRIANGLES || prim == VGL_QUADS) ? GL_TRIANGLES : GL_LINES;
+    if (prim == VGL_LINE_STRIP || prim == VGL_LINE_LOOP || prim == VGL_QUADS) {
+        if (n) memcpy(scratch, lists_data + prim_first, n * sizeof(VglVertex));
+        int segs = n < 2 ? 0 : prim == VGL_LINE_STRIP ? n - 1 : prim == VGL_LINE_LOOP ? n : (n / 4) * 6;
+        lists_count = prim_first;
+        reserve(prim == VGL_QUADS ? segs : segs * 2);
+        VglVertex *v = lists_data;
+        if (prim == VGL_QUADS) {
+            static const int tri[6] = {0, 1, 2, 0, 2, 3};
+            for (int q = 0; q + 3 < n; q += 4)
+                for (int k = 0; k < 6; k++) v[prim_first + out++] = scratch[q + tri[k]];
+        } else {
+            for (int s = 0; s < segs; s++) {
+                v[prim_first + out++] = scratch[s];
+                v[prim_first + out++] = scratch[(s + 1) % n];
+            }
+        }
+    } else {
+        out = mode == GL_LINES ? n & ~1 : mode == GL_TRIANGLES ? n - n % 3 : n;
+    }
+    lists_count = prim_first + out;
+    prim = -1;
+    if (!out) return;
+
+    VglRun r = {mode, prim_first, out, prim_size, prim_flags};
+    add_run(lists[recording].runs, &lists[recording].run_count, &r);
+}
+
+void vgl_call(int list) {
+    if (list < 0 || list >= list_count) return;
+    for (int i = 0; i < lists[list].run_count; i++) add_run(runs, &run_count, &lists[list].runs[i]);
+}
+
+/* --- GPU side --- */
+
+static const char *vertex_src =
+    "#version 330 core\n"
+    VGL_FRAME_GLSL
+    "layout(location = 0) in vec3 a_pos;\n"
+    "layout(location = 1) in vec4 a_color;\n"
+    "uniform int u_screen;\n"
+    "uniform float u_size;\n"
+    "out vec4 v_color;\n"
+    "void main() {\n"
+    "    gl_Position = (u_screen != 0 ? screen : proj * view) * vec4(a_pos, 1.0);\n"
+    "    gl_PointSize = u_size;\n"
+    "    v_color = a_color;\n"
+    "}\n";
+
+static const char *fragment_src =
+    "#version 330 core\n"
+    "in vec4 v_color;\n"
+    "out vec4 frag;\n"
+    "void main() { frag = v_color; }\n";
+
+static GLuint compile(const char *name, GLenum kind, const char *src) {
+    GLuint s = glCreateShader(kind);
+    glShaderSource(s, 1, &src, NULL);
+    glCompileShader(s);
+    GLint ok; glGetShaderiv(s, GL_COMPILE_STATUS, &ok);
+    if (!ok) {
+        char log[1024]; glGetShaderInfoLog(s, sizeof(log), NULL, log);
+        fprintf(stderr, "%s shader: %s\n", name, log);
+        glDeleteShader(s); return 0;
+    }
+    return s;
+}
+
+GLuint vgl_program(const char *name, const char *vertex, const char *fragment) {
+    GLuint vs = compile(name, GL_VERTEX_SHADER, vertex), fs = compile(name, GL_FRAGMENT_SHADER, fragment);
+    if (!vs || !fs) { glDeleteShader(vs); glDeleteShader(fs); return 0; }
+    GLuint prog = glCreateProgram();
+    glAttachShader(prog, vs); glAttachShader(prog, fs);
+    glLinkProgram(prog);
+    glDeleteShader(vs); glDeleteShader(fs);
+    GLint ok; glGetProgramiv(prog, GL_LINK_STATUS, &ok);
+    if (!ok) {
+        char log[1024]; glGetProgramInfoLog(prog, sizeof(log), NULL, log);
+        fprintf(stderr, "%s program: %s\n", name, log);
+        glDeleteProgram(prog); return 0;
+    }
+    glUniformBlockBinding(prog, glGetUniformBlockIndex(prog, "Frame"), VGL_FRAME_BINDING);
+    return prog;
+}
+static GLuint vertex_array(GLuint *vbo) {
+    GLuint vao;
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+    glGenBuffers(1, vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, *vbo);
+    glEnableVertexAttribArray(0); glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(VglVertex), (void *)offsetof(VglVertex, p));
+    glEnableVertexAttribArray(1); glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(VglVertex), (void *)offsetof(VglVertex, c));
+    return vao;
+}
+
+int vgl_init() {
+    int major = 0, minor = 0;
+    const char *ver = (const char *)glGetString(GL_VERSION);
+    if (!ver || sscanf(ver, "%d.%d", &major, &minor) != 2 || major * 10 + minor < 33) {
+        fprintf(stderr, "trek_3dview needs OpenGL 3.3 (this context: %s)\n", ver ? ver : "none");
+        return 0;
+    }
+    if (!(vgl_prog = vgl_program("batch", vertex_src, fragment_src))) return 0;
+    u_screen = glGetUniformLocation(vgl_prog, "u_screen");
+    u_size = glGetUniformLocation(vgl_prog, "u_size");
+
+    glGenBuffers(1, &frame_ubo);
+    glBindBuffer(GL_UNIFORM_BUFFER, frame_ubo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(ViewFrame), NULL, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, VGL_FRAME_BINDING, frame_ubo);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    static_vao = vertex_array(&static_vbo);
+    glBufferData(GL_ARRAY_BUFFER, lists_count * sizeof(VglVertex), lists_data, GL_STATIC_DRAW);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glEnable(GL_PROGRAM_POINT_SIZE);
+
+    fprintf(stderr, "--- BATCHER: %d static lists, %d vertices, %s streams ---\n", list_count, lists_count,
+            vgl_persistent() ? "persistent" : "map-range");
+    free(lists_data); lists_data = NULL; lists_cap = 0;
+    return 1;
+}
+
+void vgl_frame(const float *view, const float *proj, int width, int height) {
+    memcpy(frame.view, view, sizeof(frame.view));
+    memcpy(frame.proj, proj, sizeof(frame.proj));
+    mat4_identity(frame.screen);
+    mat4_ortho(frame.screen, 0, width, 0, height, -1, 1);
+    frame.light[0] = frame.light[1] = frame.light[2] = 10.0f; frame.light[3] = 1.0f; /* Where the viewer always placed LIGHT0 */
+    frame.viewport[0] = frame.viewport[1] = 0; frame.viewport[2] = width; frame.viewport[3] = height;
+    glBindBuffer(GL_UNIFORM_BUFFER, frame_ubo);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(ViewFrame), &frame);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    /* New frame: fence what the last one wrote, move every stream to a section the GPU has finished with */
+    for (int i = 0; i < stream_total; i++) {
+        VglStream *st = streams[i];
+        if (st->used) st->fence[st->part] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        st->part = (st->part + 1) % VGL_STREAM_FRAMES;
+        st->used = 0;
+        if (st->fence[st->part]) {
+            glClientWaitSync(st->fence[st->part], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000); /* Two frames back: normally signalled */
+            glDeleteSync(st->fence[st->part]);
+            st->fence[st->part] = NULL;
+        }
+    }
+}
+
+const ViewFrame *vgl_current() { return &frame; }
+
+int vgl_project(float x, float y, float z, float *win) {
+    float clip[4], p[4] = {x, y, z, 1}, eye[4];
+    for (int r = 0; r < 4; r++) eye[r] = frame.view[r] * p[0] + frame.view[4 + r] * p[1] + frame.view[8 + r] * p[2] + frame.view[12 + r];
+    for (int r = 0; r < 4; r++) clip[r] = frame.proj[r] * eye[0] + frame.proj[4 + r] * eye[1] + frame.proj[8 + r] * eye[2] + frame.proj[12 + r] * eye[3];
+    if (clip[3] <= 0.0f) return 0;
+    win[0] = frame.viewport[0] + (clip[0] / clip[3] + 1.0f) * 0.5f * frame.viewport[2];
+    win[1] = frame.viewport[1] + (clip[1] / clip[3] + 1.0f) * 0.5f * frame.viewport[3];
+    win[2] = (clip[2] / clip[3] + 1.0f) * 0.5f;
+    return win[2] <= 1.0f;
+}
+
+void vgl_flush() {
+    if (!vgl_prog || !run_count) { run_count = 0; return; }
+    glUseProgram(vgl_prog);
+    glBindVertexArray(static_vao);
+    int screen = -1;
+    float width = 1.0f, point = -1.0f;
+    for (int i = 0; i < run_count; i++) {
+        const VglRun *r = &runs[i];
+        if ((r->flags & VGL_SCREEN) != screen) {
+            screen = r->flags & VGL_SCREEN;
+            glUniform1i(u_screen, screen);
+            if (screen) glDisable(GL_DEPTH_TEST); else glEnable(GL_DEPTH_TEST);
+        }
+        if (r->mode == GL_POINTS && r->size != point) glUniform1f(u_size, point = r->size);
+        if (r->mode == GL_LINES && r->size != width) glLineWidth(width = r->size);
+        glDrawArrays(r->mode, r->first, r->count);
+        vgl_stats.draws++; vgl_stats.vertices += r->count;
+    }
+    glEnable(GL_DEPTH_TEST);
+    if (width != 1.0f) glLineWidth(1.0f);
+    glBindVertexArray(0);
+    glUseProgram(0);
+    run_count = 0;
+}
+
+/* --- Streams --- */
+
+int vgl_persistent() {
+    if (persistent < 0) {
+        int major = 0, minor = 0, n = 0;
+        const char *ver = (const char *)glGetString(GL_VERSION);
+        persistent = ver && sscanf(ver, "%d.%d", &major, &minor) == 2 && major * 10 + minor >= 44;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &n);
+        for (int i = 0; i < n && !persistent; i++)
+            persistent = strcmp((const char *)glGetStringi(GL_EXTENSIONS, i), "GL_ARB_buffer_storage") == 0;
+        if (getenv("TREK_NO_BUFFER_STORAGE")) persistent = 0;
+    }
+    return persistent;
+}
+
+int vgl_stream_init(VglStream *s, unsigned buffer, int stride, int per_frame) {
+    if (stream_total >= VGL_MAX_STREAMS) return 0;
+    memset(s, 0, sizeof(*s));
+    s->buffer = buffer;
+    s->stride = stride;
+    s->section = ((long)per_frame + 15) / 16 * 16 * stride; /* A multiple of 16 bytes and of the stride */
+    long size = s->section * VGL_STREAM_FRAMES;
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    if (vgl_persistent()) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_ARRAY_BUFFER, size, NULL, flags);
+        s->map = glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags);
+        if (!s->map) { fprintf(stderr, "stream: persistent mapping failed\n"); return 0; }
+    } else glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_STREAM_DRAW);
+    streams[stream_total++] = s;
+    return 1;
+}
+
+void *vgl_stream_begin(VglStream *s, int count) {
+    long bytes = (long)count * s->stride;
+    glBindBuffer(GL_ARRAY_BUFFER, s->buffer);
+    if (count <= 0 || s->used + bytes > s->section) return NULL;
+    s->open = s->part * s->section + s->used;
+    if (s->map) return s->map + s->open;
+    return glMapBufferRange(GL_ARRAY_BUFFER, s->open, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+}
+
+int vgl_stream_end(VglStream *s, int count) {
+    if (count > 0) {
+        if (!s->map) glUnmapBuffer(GL_ARRAY_BUFFER);
+        s->used += (long)count * s->stride;
+    }
+    return s->open / s->stride;
+}
@@ -0,0 +1,503 @@
+#define _DEFAULT_SOURCE
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <math.h>
+#include "view_mesh.h"
+#include "view_gl.h"
+
+typedef struct {
+    float p[3], n[3];
+    GLubyte c[4];
+    GLubyte f[4];                   /* lit, glow weight, scale weight, halo corner */
+} MeshVertex;
+
+typedef struct { GLenum mode; int first, count; } MeshRange;
+
+typedef struct {
+    int ranges;
+    MeshRange range[MESH_MAX_RANGES];
+} MeshModel;
+
+typedef struct { float m[16], tint[4], anim[2]; } GpuInstance;
+
+static MeshVertex *verts = NULL;
+static int vert_count = 0, vert_cap = 0;
+static GLuint *indices = NULL;
+static int index_count = 0, index_cap = 0;
+static MeshModel models[MESH_MAX_MODELS][MESH_LODS];
+static float bound[MESH_MAX_MODELS];     /* Bounding sphere radius per model */
+static int cur_model = -1, cur_lod = 0;
+static const float lod_detail[MESH_LODS] = {1.0f, 0.5f, 0.25f};
+static float detail_scale = 1.0f;
+
+/* Recorder state: the slice of fixed-function state the models use */
+static float stack[MESH_STACK_DEPTH][16];
+static int sp = 0;
+static GLubyte color[4] = {255, 255, 255, 255};
+static int lighting = 1;
+static int wireframe = 0;           /* 1: polygon-mode overlay (LOD 0 only), 2: GLUT wire primitive */
+static GLubyte weight_glow = 0, weight_scale = 0;
+
+static GLuint mesh_vao = 0, mesh_vbo = 0, mesh_ibo = 0, inst_vbo = 0, mesh_prog = 0;
+static VglStream inst_stream;     /* Per-instance data, written in place by mesh_draw() */
+
+/* --- Matrices --- */
+
+void mat4_identity(float *m) {
+    memset(m, 0, 16 * sizeof(float));
+    m[0] = m[5] = m[10] = m[15] = 1.0f;
+}
+
+void mat4_mul(float *m, const float *r) {
+    float t[16];
+    for (int c = 0; c < 4; c++)
+        for (int row = 0; row < 4; row++)
+            t[c*4 + row] = m[row] * r[c*4] + m[4 + row] * r[c*4 + 1] + m[8 + row] * r[c*4 + 2] + m[12 + row] * r[c*4 + 3];
+    memcpy(m, t, sizeof(t));
+}
+
+void mat4_translate(float *m, float x, float y, float z) {
+    float t[16]; mat4_identity(t);
+    t[12] = x; t[13] = y; t[14] = z;
+    mat4_mul(m, t);
+}
+
+void mat4_rotate(float *m, float deg, float x, float y, float z) {
+    float len = sqrtf(x*x + y*y + z*z);
+    if (len == 0.0f) return;
+    x /= len; y /= len; z /= len;
+    float a = deg * (float)M_PI / 180.0f, c = cosf(a), s = sinf(a), k = 1.0f - c;
+    float r[16] = {
+        x*x*k + c,   y*x*k + z*s, x*z*k - y*s, 0,
+        x*y*k - z*s, y*y*k + c,   y*z*k + x*s, 0,
+        x*z*k + y*s, y*z*k - x*s, z*z*k + c,   0,
+        0, 0, 0, 1
+    };
+    mat4_mul(m, r);
+}
+
+void mat4_scale(float *m, float x, float y, float z) {
+    for (int i = 0; i < 4; i++) { m[i] *= x; m[4 + i] *= y; m[8 + i] *= z; }
+}
+
+void mat4_perspective(float *m, float fovy, float aspect, float znear, float zfar) {
+    float f = 1.0f / tanf(fovy * (float)M_PI / 360.0f), p[16] = {0};
+    p[0] = f / aspect; p[5] = f;
+    p[10] = (zfar + znear) / (znear - zfar); p[11] = -1.0f;
+    p[14] = 2.0f * zfar * znear / (znear - zfar);
+    mat4_mul(m, p);
+}
+
+void mat4_ortho(float *m, float left, float right, float bottom, float top, float znear, float zfar) {
+    float o[16]; mat4_identity(o);
+    o[0] = 2.0f / (right - left); o[5] = 2.0f / (top - bottom); o[10] = -2.0f / (zfar - znear);
+    o[12] = -(right + left) / (right - left); o[13] = -(top + bottom) / (top - bottom); o[14] = -(zfar + znear) / (zfar - znear);
+    mat4_mul(m, o);
+}
+
+/* --- Recorder --- */
+
+void mesh_begin(int model, int lod) {
+    if (model < 0 || model >= MESH_MAX_MODELS || lod < 0 || lod >= MESH_LODS) { fprintf(stderr, "mesh_begin: model %d/%d out of range\n", model, lod); exit(1); }
+    cur_model = model; cur_lod = lod;
+    models[model][lod].ranges = 0;
+    sp = 0; mat4_identity(stack[0]);
+    color[0] = color[1] = color[2] = color[3] = 255;
+    lighting = 1; wireframe = 0;
+    weight_glow = weight_scale = 0;
+}
+
+void mesh_end() { cur_model = -1; }
+int mesh_level() { return cur_lod; }
+
+void mesh_push() {
+    if (sp + 1 >= MESH_STACK_DEPTH) { fprintf(stderr, "mesh_push: stack overflow\n"); exit(1); }
+    memcpy(stack[sp + 1], stack[sp], sizeof(stack[0]));
+    sp++;
+}
+
+void mesh_pop() { if (sp > 0) sp--; }
+void mesh_translate(float x, float y, float z) { mat4_translate(stack[sp], x, y, z); }
+void mesh_rotate(float deg, float x, float y, float z) { mat4_rotate(stack[sp], deg, x, y, z); }
+void mesh_scale(float x, float y, float z) { mat4_scale(stack[sp], x, y, z); }
+
+static GLubyte unorm(float v) { return (GLubyte)(v <= 0.0f ? 0 : v >= 1.0f ? 255 : lroundf(v * 255.0f)); }
+
+void mesh_color4(float r, float g, float b, float a) {
+    color[0] = unorm(r); color[1] = unorm(g); color[2] = unorm(b); color[3] = unorm(a);
+}
+
+void mesh_color3(float r, float g, float b) { mesh_color4(r, g, b, 1.0f); }
+void mesh_lighting(int on) { lighting = on; }
+void mesh_wireframe(int on) { wireframe = on ? 1 : 0; }
+void mesh_animate(int glow, int scale) { weight_glow = glow ? 255 : 0; weight_scale = scale ? 255 : 0; }
+
+/* Vertex in model space: position through the current matrix, normal through its inverse transpose */
+static GLuint vertex(float px, float py, float pz, float nx, float ny, float nz) {
+    if (vert_count == vert_cap) {
+        vert_cap = vert_cap ? vert_cap * 2 : 4096;
+        verts = realloc(verts, vert_cap * sizeof(MeshVertex));
+        if (!verts) { perror("mesh vertices"); exit(1); }
+    }
+    const float *m = stack[sp];
+    MeshVertex *v = &verts[vert_count];
+    for (int i = 0; i < 3; i++) v->p[i] = m[i] * px + m[4 + i] * py + m[8 + i] * pz + m[12 + i];
+    float d = sqrtf(v->p[0]*v->p[0] + v->p[1]*v->p[1] + v->p[2]*v->p[2]) * (weight_scale ? 1.1f : 1.0f); /* Animations stay within 10% */
+    if (d > bound[cur_model]) bound[cur_model] = d;
+
+    /* Columns of the inverse transpose are b x c, c x a, a x b over det: only the direction matters */
+    const float *a = m, *b = m + 4, *c = m + 8;
+    float bc[3] = {b[1]*c[2] - b[2]*c[1], b[2]*c[0] - b[0]*c[2], b[0]*c[1] - b[1]*c[0]};
+    float ca[3] = {c[1]*a[2] - c[2]*a[1], c[2]*a[0] - c[0]*a[2], c[0]*a[1] - c[1]*a[0]};
+    float ab[3] = {a[1]*b[2] - a[2]*b[1], a[2]*b[0] - a[0]*b[2], a[0]*b[1] - a[1]*b[0]};
+    float det = a[0]*bc[0] + a[1]*bc[1] + a[2]*bc[2];
+    float n[3], len = 0;
+    for (int i = 0; i < 3; i++) { n[i] = nx * bc[i] + ny * ca[i] + nz * ab[i]; len += n[i] * n[i]; }
+    len = sqrtf(len); if (det < 0) len = -len;
+    for (int i = 0; i < 3; i++) v->n[i] = len != 0.0f ? n[i] / len : 0.0f;
+
+    memcpy(v->c, color, 4);
+    v->f[0] = lighting ? 255 : 0; v->f[1] = weight_glow; v->f[2] = weight_scale; v->f[3] = 0;
+    return (GLuint)vert_count++;
+}
+
+static void put(GLenum mode, GLuint i) {
+    if (cur_model < 0) { fprintf(stderr, "mesh: geometry outside mesh_begin/mesh_end\n"); exit(1); }
+    MeshModel *md = &models[cur_model][cur_lod];
+    MeshRange *r = md->ranges ? &md->range[md->ranges - 1] : NULL;
+    if (!r || r->mode != mode) {
+        if (md->ranges == MESH_MAX_RANGES) { fprintf(stderr, "mesh: model %d exceeds %d draw ranges\n", cur_model, MESH_MAX_RANGES); exit(1); }
+        r = &md->range[md->ranges++];
+        r->mode = mode; r->first = index_count; r->count = 0;
+    }
+    if (index_count == index_cap) {
+        index_cap = index_cap ? index_cap * 2 : 8192;
+        indices = realloc(indices, index_cap * sizeof(GLuint));
+        if (!indices) { perror("mesh indices"); exit(1); }
+    }
+    indices[index_count++] = i;
+    r->count++;
+}
+
+static void line(GLuint a, GLuint b) { put(GL_LINES, a); put(GL_LINES, b); }
+
+/* Hull wire overlays only read up close; lines are the slowest primitive on llvmpipe */
+static int skipped() { return wireframe == 1 && cur_lod > 0; }
+
+static int detail(int n, int min) {
+    int d = (int)lroundf(n * lod_detail[cur_lod]);
+    return d < min ? (n < min ? n : min) : d;
+}
+
+static void tri(GLuint a, GLuint b, GLuint c) {
+    if (skipped()) return;
+    if (wireframe) { line(a, b); line(b, c); line(c, a); return; }
+    put(GL_TRIANGLES, a); put(GL_TRIANGLES, b); put(GL_TRIANGLES, c);
+}
+
+static void quad(GLuint a, GLuint b, GLuint c, GLuint d) {
+    if (skipped()) return;
+    if (wireframe) { line(a, b); line(b, c); line(c, d); line(d, a); return; }
+    tri(a, b, c); tri(a, c, d);
+}
+
+/* Parametric surface over u,v in [0,1]: cells as triangles, or as the u and v lines in wireframe */
+typedef void (*SurfaceFn)(float u, float v, const float *par, float *p, float *n);
+
+static void surface(int cols, int rows, SurfaceFn fn, const float *par, int wrap_u) {
+    if (skipped()) return;
+    GLuint base = vert_count;
+    for (int i = 0; i <= rows; i++)
+        for (int j = 0; j <= cols; j++) {
+            float p[3], n[3];
+            fn((float)j / cols, (float)i / rows, par, p, n);
+            vertex(p[0], p[1], p[2], n[0], n[1], n[2]);
+        }
+    GLuint w = cols + 1;
+    if (wireframe) {
+        for (int i = 0; i <= rows; i++) for (int j = 0; j < cols; j++) line(base + i*w + j, base + i*w + j + 1);
+        for (int j = 0; j < cols + !wrap_u; j++) for (int i = 0; i < rows; i++) line(base + i*w + j, base + (i+1)*w + j);
+        return;
+    }
+    for (int i = 0; i < rows; i++)
+        for (int j = 0; j < cols; j++)
+            quad(base + i*w + j, base + (i+1)*w + j, base + (i+1)*w + j + 1, base + i*w + j + 1);
+}
+
+static void sphere_fn(float u, float v, const float *par, float *p, float *n) {
+    float t = u * 2.0f * (float)M_PI, f = v * (float)M_PI;
+    n[0] = cosf(t) * sinf(f); n[1] = sinf(t) * sinf(f); n[2] = cosf(f);
+    for (int i = 0; i < 3; i++) p[i] = par[0] * n[i];
+}
+
+static void torus_fn(float u, float v, const float *par, float *p, float *n) {
+    float t = u * 2.0f * (float)M_PI, f = v * 2.0f * (float)M_PI;
+    float ring = par[1] + par[0] * cosf(f);
+    p[0] = ring * cosf(t); p[1] = ring * sinf(t); p[2] = par[0] * sinf(f);
+    n[0] = cosf(f) * cosf(t); n[1] = cosf(f) * sinf(t); n[2] = sinf(f);
+}
+
+static void cone_fn(float u, float v, const float *par, float *p, float *n) {
+    float t = u * 2.0f * (float)M_PI, r = par[0] * (1.0f - v), len = sqrtf(par[0]*par[0] + par[1]*par[1]);
+    p[0] = r * cosf(t); p[1] = r * sinf(t); p[2] = par[1] * v;
+    n[0] = cosf(t) * par[1] / len; n[1] = sinf(t) * par[1] / len; n[2] = par[0] / len;
+}
+
+/* Same axes as GLUT: poles on z, cones along +z from a base at z = 0 */
+void mesh_sphere(float r, int slices, int stacks) { surface(detail(slices, 6), detail(stacks, 4), sphere_fn, &r, 1); }
+
+void mesh_wire_sphere(float r, int slices, int stacks) {
+    int w = wireframe; wireframe = 2; mesh_sphere(r, slices, stacks); wireframe = w;
+}
+
+void mesh_cone(float base, float height, int slices, int stacks) {
+    float par[2] = {base, height};
+    if (skipped()) return;
+    slices = detail(slices, 6);
+    surface(slices, detail(stacks, 2), cone_fn, par, 1);
+    GLuint centre = vertex(0, 0, 0, 0, 0, -1), rim = vert_count;
+    for (int j = 0; j <= slices; j++) {
+        float t = (float)j / slices * 2.0f * (float)M_PI;
+        vertex(base * cosf(t), base * sinf(t), 0, 0, 0, -1);
+    }
+    for (int j = 0; j < slices; j++) tri(centre, rim + j + 1, rim + j);
+}
+
+void mesh_wire_torus(float inner, float outer, int sides, int rings) {
+    float par[2] = {inner, outer};
+    int w = wireframe; wireframe = 2; surface(detail(rings, 12), detail(sides, 4), torus_fn, par, 1); wireframe = w;
+}
+
+void mesh_cube(float size) {
+    static const float face[6][3] = {{1,0,0}, {-1,0,0}, {0,1,0}, {0,-1,0}, {0,0,1}, {0,0,-1}};
+    float h = size * 0.5f;
+    for (int f = 0; f < 6; f++) {
+        const float *n = face[f];
+        /* Two in-plane axes for the face corners */
+        float a[3] = {n[1] != 0 || n[2] != 0, n[0] != 0, 0}, b[3];
+        b[0] = n[1]*a[2] - n[2]*a[1]; b[1] = n[2]*a[0] - n[0]*a[2]; b[2] = n[0]*a[1] - n[1]*a[0];
+        GLuint v[4];
+        static const float corner[4][2] = {{-1,-1}, {1,-1}, {1,1}, {-1,1}};
+        for (int k = 0; k < 4; k++)
+            v[k] = vertex(h * (n[0] + corner[k][0]*a[0] + corner[k][1]*b[0]),
+                          h * (n[1] + corner[k][0]*a[1] + corner[k][1]*b[1]),
+                          h * (n[2] + corner[k][0]*a[2] + corner[k][1]*b[2]), n[0], n[1], n[2]);
+        quad(v[0], v[1], v[2], v[3]);
+    }
+}
+
+void mesh_wire_cube(float size) {
+    int w = wireframe; wireframe = 2; mesh_cube(size); wireframe = w;
+}
+
+/* Unit octahedron, one flat-shaded face per octant */
+void mesh_octahedron() {
+    float k = 1.0f / sqrtf(3.0f);
+    for (int o = 0; o < 8; o++) {
+        float sx = (o & 1) ? -1 : 1, sy = (o & 2) ? -1 : 1, sz = (o & 4) ? -1 : 1;
+        GLuint a = vertex(sx, 0, 0, sx*k, sy*k, sz*k);
+        GLuint b = vertex(0, sy, 0, sx*k, sy*k, sz*k);
+        GLuint c = vertex(0, 0, sz, sx*k, sy*k, sz*k);
+        tri(a, b, c);
+    }
+}
+
+void mesh_wire_octahedron() {
+    int w = wireframe; wireframe = 2; mesh_octahedron(); wireframe = w;
+}
+
+/* Four vertices at the centre: the corner and outer radius ride in the normal, the shader spreads them in eye space */
+void mesh_halo(float radius, float r, float g, float b, float alpha) {
+    const float *m = stack[sp];
+    float det = m[0] * (m[5]*m[10] - m[6]*m[9]) - m[4] * (m[1]*m[10] - m[2]*m[9]) + m[8] * (m[1]*m[6] - m[2]*m[5]);
+    float outer = 2.0f * radius * cbrtf(fabsf(det)); /* Non-uniform scales get their mean */
+    GLubyte c[4];
+    memcpy(c, color, 4);
+    mesh_color4(r, g, b, alpha);
+    GLuint v[4];
+    static const float corner[4][2] = {{-1,-1}, {1,-1}, {1,1}, {-1,1}};
+    for (int k = 0; k < 4; k++) {
+        v[k] = vertex(0, 0, 0, 0, 0, 1);
+        MeshVertex *mv = &verts[v[k]];
+        mv->n[0] = corner[k][0]; mv->n[1] = corner[k][1]; mv->n[2] = outer;
+        mv->f[0] = 0; mv->f[3] = 255;
+    }
+    float d = sqrtf(m[12]*m[12] + m[13]*m[13] + m[14]*m[14]) + outer;
+    if (d > bound[cur_model]) bound[cur_model] = d;
+    int w = wireframe; wireframe = 0; quad(v[0], v[1], v[2], v[3]); wireframe = w;
+    memcpy(color, c, 4);
+}
+
+/* --- GPU side --- */
+
+static const char *vertex_src =
+    "#version 330 core\n"
+    VGL_FRAME_GLSL
+    "layout(location = 0) in vec3 a_pos;\n"
+    "layout(location = 1) in vec3 a_normal;\n"
+    "layout(location = 2) in vec4 a_color;\n"
+    "layout(location = 3) in vec4 a_flags;\n"
+    "layout(location = 4) in mat4 i_model;\n"
+    "layout(location = 8) in vec4 i_tint;\n"
+    "layout(location = 9) in vec2 i_anim;\n"
+    "out vec4 v_color;\n"
+    "out vec2 v_uv;\n"
+    "flat out float v_halo;\n"
+    "void main() {\n"
+    "    mat4 mv = view * i_model;\n"
+    "    vec4 eye = mv * vec4(a_pos * mix(1.0, i_anim.y, a_flags.z), 1.0);\n"
+    "    v_halo = a_flags.w;\n"
+    "    v_uv = a_normal.xy * 2.0;\n"
+    "    if (a_flags.w > 0.5) {\n"
+    "        /* Halo: pulled to the front of its outer shell along the view ray, same projected size */\n"
+    "        float k = max((eye.z + a_normal.z) / eye.z, 0.05);\n"
+    "        eye = vec4((eye.xyz + vec3(a_normal.xy * a_normal.z, 0.0)) * k, 1.0);\n"
+    "    }\n"
+    "    vec4 c = vec4(a_color.rgb * mix(1.0, i_anim.x, a_flags.y), a_color.a);\n"
+    "    if (a_flags.x > 0.5 && a_flags.w < 0.5) {\n"
+    "        /* LIGHT0 on the default material: glColor never reached lit surfaces */\n"
+    "        vec3 n = normalize(mat3(mv) * a_normal);\n"
+    "        float d = max(dot(n, normalize(light.xyz - eye.xyz)), 0.0);\n"
+    "        c = vec4(vec3(0.04 + 0.8 * d), 1.0);\n"
+    "    }\n"
+    "    v_color = clamp(c * i_tint, 0.0, 1.0);\n"
+    "    gl_Position = proj * eye;\n"
+    "}\n";
+
+static const char *fragment_src =
+    "#version 330 core\n"
+    "in vec4 v_color;\n"
+    "in vec2 v_uv;\n"
+    "flat in float v_halo;\n"
+    "out vec4 frag;\n"
+    "void main() {\n"
+    "    frag = v_color;\n"
+    "    if (v_halo > 0.5) {\n"
+    "        /* The shells a ray at this radius crosses, each blended once */\n"
+    "        float d = length(v_uv), keep = 1.0;\n"
+    "        for (int i = 1; i <= 5; i++) if (d < 1.0 + 0.2 * float(i)) keep *= 1.0 - v_color.a / (1.5 * float(i));\n"
+    "        if (keep >= 1.0) discard;\n"
+    "        frag.a = 1.0 - keep;\n"
+    "    }\n"
+    "}\n";
+
+int mesh_upload() {
+    if (!(mesh_prog = vgl_program("mesh", vertex_src, fragment_src))) return 0;
+
+    glGenVertexArrays(1, &mesh_vao);
+    glBindVertexArray(mesh_vao);
+    glGenBuffers(1, &mesh_vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh_vbo);
+    glBufferData(GL_ARRAY_BUFFER, vert_count * sizeof(MeshVertex), verts, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0); glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(MeshVertex), (void *)offsetof(MeshVertex, p));
+    glEnableVertexAttribArray(1); glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(MeshVertex), (void *)offsetof(MeshVertex, n));
+    glEnableVertexAttribArray(2); glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(MeshVertex), (void *)offsetof(MeshVertex, c));
+    glEnableVertexAttribArray(3); glVertexAttribPointer(3, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(MeshVertex), (void *)offsetof(MeshVertex, f));
+    glGenBuffers(1, &mesh_ibo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh_ibo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_count * sizeof(GLuint), indices, GL_STATIC_DRAW);
+    glGenBuffers(1, &inst_vbo);
+    if (!vgl_stream_init(&inst_stream, inst_vbo, sizeof(GpuInstance), MESH_MAX_INSTANCES)) return 0;
+    for (int a = 4; a <= 9; a++) { glEnableVertexAttribArray(a); glVertexAttribDivisor(a, 1); }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    int used = 0;
+    for (int i = 0; i < MESH_MAX_MODELS; i++) used += models[i][0].ranges > 0;
+    fprintf(stderr, "--- MESHES: %d models x %d LODs baked, %d vertices, %d indices (%ld KB) ---\n", used, MESH_LODS, vert_count, index_count,
+           (long)(vert_count * sizeof(MeshVertex) + index_count * sizeof(GLuint)) / 1024);
+    free(verts); verts = NULL; vert_cap = 0;
+    free(indices); indices = NULL; index_cap = 0;
+    return 1;
+}
+
+float mesh_radius(int model) { return (model >= 0 && model < MESH_MAX_MODELS) ? bound[model] : 0.0f; }
+
+void mesh_detail(float scale) { detail_scale = scale; }
+
+int mesh_cull(MeshInstance *inst, int count) {
+    const ViewFrame *fr = vgl_current();
+    const float *view = fr->view;
+    float clip[16];
+    memcpy(clip, fr->proj, sizeof(clip));
+    float focal = clip[5] * fr->viewport[3] * 0.5f;   /* Pixels per unit at eye distance 1 */
+    mat4_mul(clip, view);
+
+    /* Frustum planes straight from the clip matrix rows (left, right, bottom, top, near, far) */
+    float plane[6][4];
+    for (int p = 0; p < 6; p++) {
+        int row = p / 2; float sign = (p & 1) ? -1.0f : 1.0f, len = 0;
+        for (int c = 0; c < 4; c++) plane[p][c] = clip[c*4 + 3] + sign * clip[c*4 + row];
+        for (int c = 0; c < 3; c++) len += plane[p][c] * plane[p][c];
+        len = sqrtf(len);
+        for (int c = 0; c < 4; c++) plane[p][c] /= len;
+    }
+
+    int visible = 0;
+    for (int i = 0; i < count; i++) {
+        MeshInstance *in = &inst[i];
+        const float *t = in->m + 12;
+        float r = mesh_radius(in->model) * sqrtf(in->m[0]*in->m[0] + in->m[1]*in->m[1] + in->m[2]*in->m[2]);
+        in->lod = -1;
+        int inside = 1;
+        for (int p = 0; p < 6 && inside; p++)
+            inside = plane[p][0]*t[0] + plane[p][1]*t[1] + plane[p][2]*t[2] + plane[p][3] >= -r;
+        if (!inside) continue;
+        float ez = -(view[2]*t[0] + view[6]*t[1] + view[10]*t[2] + view[14]);
+        float px = (ez > 0.01f ? r * focal / ez : MESH_LOD1_PX) * detail_scale;
+        in->lod = px >= MESH_LOD1_PX ? 0 : px >= MESH_LOD2_PX ? 1 : 2;
+        visible++;
+    }
+    return visible;
+}
+
+void mesh_draw(const MeshInstance *inst, int count) {
+    enum { KEYS = MESH_MAX_MODELS * MESH_LODS };
+    int first[KEYS + 1] = {0}, fill[KEYS];
+    if (!mesh_prog || count <= 0) return;
+    if (count > MESH_MAX_INSTANCES) count = MESH_MAX_INSTANCES;
+
+    /* Counting sort by model and LOD: each batch ends up contiguous, culled instances stay out */
+    for (int i = 0; i < count; i++) if (inst[i].lod >= 0) first[inst[i].model * MESH_LODS + inst[i].lod + 1]++;
+    for (int k = 0; k < KEYS; k++) { first[k + 1] += first[k]; fill[k] = first[k]; }
+    int total = first[KEYS];
+    if (!total) return;
+    /* The sort scatters straight into the stream: no staging copy, no upload call */
+    glBindVertexArray(mesh_vao);
+    GpuInstance *gpu = vgl_stream_begin(&inst_stream, total);
+    if (!gpu) { glBindVertexArray(0); glBindBuffer(GL_ARRAY_BUFFER, 0); return; }
+    for (int i = 0; i < count; i++) {
+        if (inst[i].lod < 0) continue;
+        GpuInstance *g = &gpu[fill[inst[i].model * MESH_LODS + inst[i].lod]++];
+        memcpy(g->m, inst[i].m, sizeof(g->m));
+        memcpy(g->tint, inst[i].tint, sizeof(g->tint));
+        memcpy(g->anim, inst[i].anim, sizeof(g->anim));
+    }
+
+    int at = vgl_stream_end(&inst_stream, total);
+
+    glUseProgram(mesh_prog);
+    for (int k = 0; k < KEYS; k++) {
+        const MeshModel *md = &models[k / MESH_LODS][k % MESH_LODS];
+        int n = first[k + 1] - first[k];
+        if (!n || !md->ranges) continue;
+        size_t base = (size_t)(at + first[k]) * sizeof(GpuInstance);
+        for (int c = 0; c < 4; c++)
+            glVertexAttribPointer(4 + c, 4, GL_FLOAT, GL_FALSE, sizeof(GpuInstance), (void *)(base + offsetof(GpuInstance, m) + c * 4 * sizeof(float)));
+        glVertexAttribPointer(8, 4, GL_FLOAT, GL_FALSE, sizeof(GpuInstance), (void *)(base + offsetof(GpuInstance, tint)));
+        glVertexAttribPointer(9, 2, GL_FLOAT, GL_FALSE, sizeof(GpuInstance), (void *)(base + offsetof(GpuInstance, anim)));
+        for (int r = 0; r < md->ranges; r++) {
+            const MeshRange *rg = &md->range[r];
+            glDrawElementsInstanced(rg->mode, rg->count, GL_UNSIGNED_INT, (void *)(rg->first * sizeof(GLuint)), n);
+            vgl_stats.draws++; vgl_stats.vertices += (long)rg->count * n;
+        }
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glUseProgram(0);
+}
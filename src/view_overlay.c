@@ -0,0 +1,379 @@
+#define _DEFAULT_SOURCE
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include <math.h>
+#include "view_overlay.h"
+#include "view_gl.h"
+
+/* --- Fonts: the X11 bitmaps freeglut ships as GLUT_BITMAP_HELVETICA_10 / _12, ASCII 32-126 --- */
+
+/* -adobe-helvetica-medium-r-normal--10-100-75-75-p-56-iso8859-1: per glyph the advance, then 14 rows bottom-up, (advance + 7) / 8 bytes each */
+static const unsigned char helvetica10[] = {
+    0x03,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00, /* ' ' */
+    0x03,0x00,0x00,0x00,0x40,0x00,0x40,0x40,0x40,0x40,0x40,0x40,0x00,0x00,0x00, /* '!' */
+    0x04,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x50,0x50,0x00,0x00,0x00, /* '"' */
+    0x06,0x00,0x00,0x00,0x50,0x50,0xf8,0x28,0x7c,0x28,0x28,0x00,0x00,0x00,0x00, /* '#' */
+    0x06,0x00,0x00,0x20,0x70,0xa8,0x28,0x70,0xa0,0xa8,0x70,0x20,0x00,0x00,0x00, /* '$' */
+    0x09,0x00,0x00,0x00,0x00,0x00,0x00,0x26,0x00,0x29,0x00,0x16,0x00,0x10,0x00,0x08,0x00,0x68,0x00,0x94,0x00,0x64,0x00,0x00,0x00,0x00,0x00,0x00,0x00, /* '%' */
+    0x08,0x00,0x00,0x00,0x32,0x4c,0x4c,0x52,0x30,0x28,0x28,0x10,0x00,0x00,0x00, /* '&' */
+    0x03,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x40,0x20,0x20,0x00,0x00,0x00, /* '\'' */
+    0x04,0x00,0x20,0x40,0x40,0x80,0x80,0x80,0x80,0x40,0x40,0x20,0x00,0x00,0x00, /* '(' */
+    0x04,0x00,0x40,0x20,0x20,0x10,0x10,0x10,0x10,0x20,0x20,0x40,0x00,0x00,0x00, /* ')' */
+    0x04,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xa0,0x40,0xa0,0x00,0x00,0x00, /* '*' */
+    0x06,0x00,0x00,0x00,0x00,0x20,0x20,0xf8,0x20,0x20,0x00,0x00,0x00,0x00,0x00, /* '+' */
+    0x03,0x00,0x80,0x40,0x40,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00, /* ',' */
+    0x07,0x00,0x00,0x00,0x00,0x00,0x00,0x7c,0x00,0x00,0x00,0x00,0x00,0x00,0x00, /* '-' */
+    0x03,0x00,0x00,0x00,0x40,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00, /* '.' */
+    0x03,0x00,0x00,0x00,0x80,0x80,0x40,0x40,0x40,0x40,0x20,0x20,0x00,0x00,0x00, /* '/' */
+    0x06,0x00,0x00,0x00,0x70,0x88,0x88,0x88,0x88,0x88,0x88,0x70,0x00,0x00,0x00, /* '0' */
+    0x06,0x00,0x00,0x00,0x20,0x20,0x20,0x20,0x20,0x20,0x60,0x20,0x00,0x00,0x00, /* '1' */
+    0x06,0x00,0x00,0x00,0xf8,0x80,0x40,0x30,0x08,0x08,0x88,0x70,0x00,0x00,0x00, /* '2' */
+    0x06,0x00,0x00,0x00,0x70,0x88,0x08,0x08,0x30,0x08,0x88,0x70,0x00,0x00,0x00, /* '3' */
+    0x06,0x00,0x00,0x00,0x10,0x10,0xf8,0x90,0x50,0x50,0x30,0x10,0x00,0x00,0x00, /* '4' */
+    0x06,0x00,0x00,0x00,0x70,0x88,0x08,0x08,0xf0,0x80,0x80,0xf8,0x00,0x00,0x00, /* '5' */
+    0x06,0x00,0x00,0x00,0x70,0x88,0x88,0xc8,0xb0,0x80,0x88,0x70,0x00,0x00,0x00, /* '6' */
+    0x06,0x00,0x00,0x00,0x40,0x40,0x20,0x20,0x10,0x10,0x08,0xf8,0x00,0x00,0x00, /* '7' */
+    0x06,0x00,0x00,0x00,0x70,0x88,0x88,0x88,0x70,0x88,0x88,0x70,0x00,0x00,0x00, /* '8' */
+    0x06,0x00,0x00,0x00,0x70,0x88,0x08,0x68,0x98,0x88,0x88,0x70,0x00,0x00,0x00, /* '9' */
+    0x03,0x00,0x00,0x00,0x40,0x00,0x00,0x00,0x00,0x40,0x00,0x00,0x00,0x00,0x00, /* ':' */
+    0x03,0x00,0x80,0x40,0x40,0x00,0x00,0x00,0x00,0x40,0x00,0x00,0x00,0x00,0x00, /* ';' */
+    0x06,0x00,0x00,0x00,0x00,0x10,0x20,0x40,0x20,0x10,0x00,0x00,0x00,0x00,0x00, /* '<' */
+    0x05,0x00,0x00,0x00,0x00,0x00,0xf0,0x00,0xf0,0x00,0x00,0x00,0x00,0x00,0x00, /* '=' */
+    0x06,0x00,0x00,0x00,0x00,0x40,0x20,0x10,0x20,0x40,0x00,0x00,0x00,0x00,0x00, /* '>' */
+    0x06,0x00,0x00,0x00,0x20,0x00,0x20,0x20,0x10,0x08,0x48,0x30,0x00,0x00,0x00, /* '?' */
+    0x0b,0x00,0x00,0x3e,0x00,0x40,0x00,0x9b,0x00,0xa4,0x80,0xa4,0x80,0xa2,0x40,0x92,0x40,0x4d,0x40,0x20,0x80,0x1f,0x00,0x00,0x00,0x00,0x00,0x00,0x00, /* '@' */
+    0x07,0x00,0x00,0x00,0x82,0x82,0x7c,0x44,0x28,0x28,0x10,0x10,0x00,0x00,0x00, /* 'A' */
+    0x07,0x00,0x00,0x00,0x78,0x44,0x44,0x44,0x78,0x44,0x44,0x78,0x00,0x00,0x00, /* 'B' */
+    0x08,0x00,0x00,0x00,0x3c,0x42,0x40,0x40,0x40,0x40,0x42,0x3c,0x00,0x00,0x00, /* 'C' */
+    0x08,0x00,0x00,0x00,0x78,0x44,0x42,0x42,0x42,0x42,0x44,0x78,0x00,0x00,0x00, /* 'D' */
+    0x07,0x00,0x00,0x00,0x7c,0x40,0x40,0x40,0x7c,0x40,0x40,0x7c,0x00,0x00,0x00, /* 'E' */
+    0x06,0x00,0x00,0x00,0x40,0x40,0x40,0x40,0x78,0x40,0x40,0x7c,0x00,0x00,0x00, /* 'F' */
+    0x08,0x00,0x00,0x00,0x3a,0x46,0x42,0x46,0x40,0x40,0x42,0x3c,0x00,0x00,0x00, /* 'G' */
+    0x08,0x00,0x00,0x00,0x42,0x42,0x42,0x42,0x7e,0x42,0x42,0x42,0x00,0x00,0x00, /* 'H' */
+    0x03,0x00,0x00,0x00,0x40,0x40,0x40,0x40,0x40,0x40,0x40,0x40,0x00,0x00,0x00, /* 'I' */
+    0x05,0x00,0x00,0x00,0x60,0x90,0x10,0x10,0x10,0x10,0x10,0x10,0x00,0x00,0x00, /* 'J' */
+    0x07,0x00,0x00,0x00,0x44,0x44,0x48,0x48,0x70,0x50,0x48,0x44,0x00,0x00,0x00, /* 'K' */
+    0x06,0x00,0x00,0x00,0x78,0x40,0x40,0x40,0x40,0x40,0x40,0x40,0x00,0x00,0x00, /* 'L' */
+    0x09,0x00,0x00,0x00,0x00,0x00,0x00,0x49,0x00,0x49,0x00,0x49,0x00,0x55,0x00,0x55,0x00,0x63,0x00,0x63,0x00,0x41,0x00,0x00,0x00,0x00,0x00,0x00,0x00, /* 'M' */
+    0x08,0x00,0x00,0x00,0x46,0x46,0x4a,0x4a,0x52,0x52,0x62,0x62,0x00,0x00,0x00, /* 'N' */
+    0x08,0x00,0x00,0x00,0x3c,0x42,0x42,0x42,0x42,0x42,0x42,0x3c,0x00,0x00,0x00, /* 'O' */
+    0x07,0x00,0x00,0x00,0x40,0x40,0x40,0x40,0x78,0x44,0x44,0x78,0x00,0x00,0x00, /* 'P' */
+    0x08,0x00,0x00,0x01,0x3e,0x46,0x4a,0x42,0x42,0x42,0x42,0x3c,0x00,0x00,0x00, /* 'Q' */
+    0x07,0x00,0x00,0x00,0x44,0x44,0x44,0x44,0x78,0x44,0x44,0x78,0x00,0x00,0x00, /* 'R' */
+    0x07,0x00,0x00,0x00,0x38,0x44,0x44,0x04,0x38,0x40,0x44,0x38,0x00,0x00,0x00, /* 'S' */
+    0x05,0x00,0x00,0x00,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0xf8,0x00,0x00,0x00, /* 'T' */
+    0x08,0x00,0x00,0x00,0x3c,0x42,0x42,0x42,0x42,0x42,0x42,0x42,0x00,0x00,0x00, /* 'U' */
+    0x07,0x00,0x00,0x00,0x10,0x28,0x28,0x44,0x44,0x44,0x82,0x82,0x00,0x00,0x00, /* 'V' */
+    0x09,0x00,0x00,0x00,0x00,0x00,0x00,0x22,0x00,0x22,0x00,0x22,0x00,0x55,0x00,0x49,0x00,0x49,0x00,0x88,0x80,0x88,0x80,0x00,0x00,0x00,0x00,0x00,0x00, /* 'W' */
+    0x07,0x00,0x00,0x00,0x44,0x44,0x28,0x28,0x10,0x28,0x44,0x44,0x00,0x00,0x00, /* 'X' */
+    0x07,0x00,0x00,0x00,0x10,0x10,0x10,0x28,0x28,0x44,0x44,0x82,0x00,0x00,0x00, /* 'Y' */
+    0x07,0x00,0x00,0x00,0x7c,0x40,0x20,0x10,0x10,0x08,0x04,0x7c,0x00,0x00,0x00, /* 'Z' */
+    0x03,0x00,0x60,0x40,0x40,0x40,0x40,0x40,0x40,0x40,0x40,0x60,0x00,0x00,0x00, /* '[' */
+    0x03,0x00,0x00,0x00,0x20,0x20,0x40,0x40,0x40,0x40,0x80,0x80,0x00,0x00,0x00, /* '\\' */
+    0x03,0x00,0xc0,0x40,0x40,0x40,0x40,0x40,0x40,0x40,0x40,0xc0,0x00,0x00,0x00, /* ']' */
+    0x06,0x00,0x00,0x00,0x00,0x00,0x00,0x88,0x50,0x50,0x20,0x20,0x00,0x00,0x00, /* '^' */
+    0x06,0x00,0xfc,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00, /* '_' */
+    0x03,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x3f,0x40,0x20,0x00,0x00,0x00, /* '`' */
+    0x05,0x00,0x00,0x00,0x68,0x90,0x90,0x70,0x10,0xe0,0x00,0x00,0x00,0x00,0x00, /* 'a' */
+    0x06,0x00,0x00,0x00,0xb0,0xc8,0x88,0x88,0xc8,0xb0,0x80,0x80,0x00,0x00,0x00, /* 'b' */
+    0x05,0x00,0x00,0x00,0x60,0x90,0x80,0x80,0x90,0x60,0x00,0x00,0x00,0x00,0x00, /* 'c' */
+    0x06,0x00,0x00,0x00,0x68,0x98,0x88,0x88,0x98,0x68,0x08,0x08,0x00,0x00,0x00, /* 'd' */
+    0x05,0x00,0x00,0x00,0x60,0x90,0x80,0xf0,0x90,0x60,0x00,0x00,0x00,0x00,0x00, /* 'e' */
+    0x04,0x00,0x00,0x00,0x40,0x40,0x40,0x40,0x40,0xe0,0x40,0x30,0x00,0x00,0x00, /* 'f' */
+    0x06,0x00,0x70,0x08,0x68,0x98,0x88,0x88,0x98,0x68,0x00,0x00,0x00,0x00,0x00, /* 'g' */
+    0x06,0x00,0x00,0x00,0x88,0x88,0x88,0x88,0xc8,0xb0,0x80,0x80,0x00,0x00,0x00, /* 'h' */
+    0x02,0x00,0x00,0x00,0x80,0x80,0x80,0x80,0x80,0x80,0x00,0x80,0x00,0x00,0x00, /* 'i' */
+    0x02,0x00,0x00,0x80,0x80,0x80,0x80,0x80,0x80,0x80,0x00,0x80,0x00,0x00,0x00, /* 'j' */
+    0x05,0x00,0x00,0x00,0x90,0x90,0xa0,0xc0,0xa0,0x90,0x80,0x80,0x00,0x00,0x00, /* 'k' */
+    0x02,0x00,0x00,0x00,0x80,0x80,0x80,0x80,0x80,0x80,0x80,0x80,0x00,0x00,0x00, /* 'l' */
+    0x08,0x00,0x00,0x00,0x92,0x92,0x92,0x92,0x92,0xec,0x00,0x00,0x00,0x00,0x00, /* 'm' */
+    0x06,0x00,0x00,0x00,0x88,0x88,0x88,0x88,0xc8,0xb0,0x00,0x00,0x00,0x00,0x00, /* 'n' */
+    0x06,0x00,0x00,0x00,0x70,0x88,0x88,0x88,0x88,0x70,0x00,0x00,0x00,0x00,0x00, /* 'o' */
+    0x06,0x00,0x80,0x80,0xb0,0xc8,0x88,0x88,0xc8,0xb0,0x00,0x00,0x00,0x00,0x00, /* 'p' */
+    0x06,0x00,0x08,0x08,0x68,0x98,0x88,0x88,0x98,0x68,0x00,0x00,0x00,0x00,0x00, /* 'q' */
+    0x04,0x00,0x00,0x00,0x80,0x80,0x80,0x80,0xc0,0xa0,0x00,0x00,0x00,0x00,0x00, /* 'r' */
+    0x05,0x00,0x00,0x00,0x60,0x90,0x10,0x60,0x90,0x60,0x00,0x00,0x00,0x00,0x00, /* 's' */
+    0x04,0x00,0x00,0x00,0x60,0x40,0x40,0x40,0x40,0xe0,0x40,0x40,0x00,0x00,0x00, /* 't' */
+    0x05,0x00,0x00,0x00,0x70,0x90,0x90,0x90,0x90,0x90,0x00,0x00,0x00,0x00,0x00, /* 'u' */
+    0x06,0x00,0x00,0x00,0x20,0x20,0x50,0x50,0x88,0x88,0x00,0x00,0x00,0x00,0x00, /* 'v' */
+    0x08,0x00,0x00,0x00,0x28,0x28,0x54,0x54,0x92,0x92,0x00,0x00,0x00,0x00,0x00, /* 'w' */
+    0x06,0x00,0x00,0x00,0x88,0x88,0x50,0x20,0x50,0x88,0x00,0x00,0x00,0x00,0x00, /* 'x' */
+    0x05,0x00,0x80,0x40,0x40,0x60,0xa0,0xa0,0x90,0x90,0x00,0x00,0x00,0x00,0x00, /* 'y' */
+    0x05,0x00,0x00,0x00,0xf0,0x80,0x40,0x20,0x10,0xf0,0x00,0x00,0x00,0x00,0x00, /* 'z' */
+    0x03,0x00,0x20,0x40,0x40,0x40,0x40,0x80,0x40,0x40,0x40,0x20,0x00,0x00,0x00, /* '{' */
+    0x03,0x00,0x40,0x40,0x40,0x40,0x40,0x40,0x40,0x40,0x40,0x40,0x00,0x00,0x00, /* '|' */
+    0x03,0x00,0x80,0x40,0x40,0x40,0x40,0x20,0x40,0x40,0x40,0x80,0x00,0x00,0x00, /* '}' */
+    0x07,0x00,0x00,0x00,0x00,0x00,0x00,0x98,0x64,0x00,0x00,0x00,0x00,0x00,0x00, /* '~' */
+};
+/* -adobe-helvetica-medium-r-normal--12-120-75-75-p-67-iso8859-1: per glyph the advance, then 16 rows bottom-up, (advance + 7) / 8 bytes each */
+static const unsigned char helvetica12[] = {
+    0x04,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00, /* ' ' */
+    0x03,0x00,0x00,0x00,0x00,0x40,0x00,0x40,0x40,0x40,0x40,0x40,0x40,0x40,0x00,0x00,0x00, /* '!' */
+    0x05,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x50,0x50,0x50,0x00,0x00,0x00, /* '"' */
+    0x07,0x00,0x00,0x00,0x00,0x50,0x50,0x50,0xfc,0x28,0xfc,0x28,0x28,0x00,0x00,0x00,0x00, /* '#' */
+    0x07,0x00,0x00,0x00,0x10,0x38,0x54,0x54,0x14,0x38,0x50,0x54,0x38,0x10,0x00,0x00,0x00, /* '$' */
+    0x0b,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x11,0x80,0x0a,0x40,0x0a,0x40,0x09,0x80,0x04,0x00,0x34,0x00,0x4a,0x00,0x4a,0x00,0x31,0x00,0x00,0x00,0x00,0x00,0x00,0x00, /* '%' */
+    0x09,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x39,0x00,0x46,0x00,0x42,0x00,0x45,0x00,0x28,0x00,0x18,0x00,0x24,0x00,0x24,0x00,0x18,0x00,0x00,0x00,0x00,0x00,0x00,0x00, /* '&' */
+    0x03,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x40,0x20,0x60,0x00,0x00,0x00, /* '\'' */
+    0x04,0x00,0x10,0x20,0x20,0x40,0x40,0x40,0x40,0x40,0x40,0x20,0x20,0x10,0x00,0x00,0x00, /* '(' */
+    0x04,0x00,0x80,0x40,0x40,0x20,0x20,0x20,0x20,0x20,0x20,0x40,0x40,0x80,0x00,0x00,0x00, /* ')' */
+    0x05,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x50,0x20,0x50,0x00,0x00,0x00, /* '*' */
+    0x07,0x00,0x00,0x00,0x00,0x00,0x10,0x10,0x7c,0x10,0x10,0x00,0x00,0x00,0x00,0x00,0x00, /* '+' */
+    0x04,0x00,0x00,0x40,0x20,0x20,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00, /* ',' */
+    0x08,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x7c,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00, /* '-' */
+    0x03,0x00,0x00,0x00,0x00,0x40,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00, /* '.' */
+    0x04,0x00,0x00,0x00,0x00,0x80,0x80,0x40,0x40,0x40,0x20,0x20,0x10,0x10,0x00,0x00,0x00, /* '/' */
+    0x07,0x00,0x00,0x00,0x00,0x38,0x44,0x44,0x44,0x44,0x44,0x44,0x44,0x38,0x00,0x00,0x00, /* '0' */
+    0x07,0x00,0x00,0x00,0x00,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x70,0x10,0x00,0x00,0x00, /* '1' */
+    0x07,0x00,0x00,0x00,0x00,0x7c,0x40,0x40,0x20,0x10,0x08,0x04,0x44,0x38,0x00,0x00,0x00, /* '2' */
+    0x07,0x00,0x00,0x00,0x00,0x38,0x44,0x44,0x04,0x04,0x18,0x04,0x44,0x38,0x00,0x00,0x00, /* '3' */
+    0x07,0x00,0x00,0x00,0x00,0x08,0x08,0xfc,0x88,0x48,0x28,0x28,0x18,0x08,0x00,0x00,0x00, /* '4' */
+    0x07,0x00,0x00,0x00,0x00,0x38,0x44,0x44,0x04,0x04,0x78,0x40,0x40,0x7c,0x00,0x00,0x00, /* '5' */
+    0x07,0x00,0x00,0x00,0x00,0x38,0x44,0x44,0x44,0x64,0x58,0x40,0x44,0x38,0x00,0x00,0x00, /* '6' */
+    0x07,0x00,0x00,0x00,0x00,0x20,0x20,0x10,0x10,0x10,0x08,0x08,0x04,0x7c,0x00,0x00,0x00, /* '7' */
+    0x07,0x00,0x00,0x00,0x00,0x38,0x44,0x44,0x44,0x44,0x38,0x44,0x44,0x38,0x00,0x00,0x00, /* '8' */
+    0x07,0x00,0x00,0x00,0x00,0x38,0x44,0x04,0x04,0x3c,0x44,0x44,0x44,0x38,0x00,0x00,0x00, /* '9' */
+    0x03,0x00,0x00,0x00,0x00,0x40,0x00,0x00,0x00,0x00,0x40,0x00,0x00,0x00,0x00,0x00,0x00, /* ':' */
+    0x03,0x00,0x00,0x80,0x40,0x40,0x00,0x00,0x00,0x00,0x40,0x00,0x00,0x00,0x00,0x00,0x00, /* ';' */
+    0x07,0x00,0x00,0x00,0x00,0x00,0x0c,0x30,0xc0,0x30,0x0c,0x00,0x00,0x00,0x00,0x00,0x00, /* '<' */
+    0x07,0x00,0x00,0x00,0x00,0x00,0x00,0x7c,0x00,0x7c,0x00,0x00,0x00,0x00,0x00,0x00,0x00, /* '=' */
+    0x07,0x00,0x00,0x00,0x00,0x00,0x60,0x18,0x06,0x18,0x60,0x00,0x00,0x00,0x00,0x00,0x00, /* '>' */
+    0x07,0x00,0x00,0x00,0x00,0x10,0x00,0x10,0x10,0x08,0x08,0x44,0x44,0x38,0x00,0x00,0x00, /* '?' */
+    0x0c,0x00,0x00,0x00,0x00,0x00,0x00,0x1f,0x00,0x20,0x00,0x4d,0x80,0x53,0x40,0x51,0x20,0x51,0x20,0x49,0x20,0x26,0xa0,0x30,0x40,0x0f,0x80,0x00,0x00,0x00,0x00,0x00,0x00, /* '@' */
+    0x09,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x41,0x00,0x41,0x00,0x41,0x00,0x3e,0x00,0x22,0x00,0x22,0x00,0x14,0x00,0x14,0x00,0x08,0x00,0x00,0x00,0x00,0x00,0x00,0x00, /* 'A' */
+    0x08,0x00,0x00,0x00,0x00,0x7c,0x42,0x42,0x42,0x7c,0x42,0x42,0x42,0x7c,0x00,0x00,0x00, /* 'B' */
+    0x09,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x1e,0x00,0x21,0x00,0x40,0x00,0x40,0x00,0x40,0x00,0x40,0x00,0x40,0x00,0x21,0x00,0x1e,0x00,0x00,0x00,0x00,0x00,0x00,0x00, /* 'C' */
+    0x09,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x7c,0x00,0x42,0x00,0x41,0x00,0x41,0x00,0x41,0x00,0x41,0x00,0x41,0x00,0x42,0x00,0x7c,0x00,0x00,0x00,0x00,0x00,0x00,0x00, /* 'D' */
+    0x08,0x00,0x00,0x00,0x00,0x7e,0x40,0x40,0x40,0x7e,0x40,0x40,0x40,0x7e,0x00,0x00,0x00, /* 'E' */
+    0x08,0x00,0x00,0x00,0x00,0x40,0x40,0x40,0x40,0x7c,0x40,0x40,0x40,0x7e,0x00,0x00,0x00, /* 'F' */
+    0x09,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x1d,0x00,0x23,0x00,0x41,0x00,0x41,0x00,0x47,0x00,0x40,0x00,0x40,0x00,0x21,0x00,0x1e,0x00,0x00,0x00,0x00,0x00,0x00,0x00, /* 'G' */
+    0x09,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x41,0x00,0x41,0x00,0x41,0x00,0x41,0x00,0x7f,0x00,0x41,0x00,0x41,0x00,0x41,0x00,0x41,0x00,0x00,0x00,0x00,0x00,0x00,0x00, /* 'H' */
+    0x03,0x00,0x00,0x00,0x00,0x40,0x40,0x40,0x40,0x40,0x40,0x40,0x40,0x40,0x00,0x00,0x00, /* 'I' */
+    0x07,0x00,0x00,0x00,0x00,0x38,0x44,0x44,0x04,0x04,0x04,0x04,0x04,0x04,0x00,0x00,0x00, /* 'J' */
+    0x08,0x00,0x00,0x00,0x00,0x41,0x42,0x44,0x48,0x70,0x50,0x48,0x44,0x42,0x00,0x00,0x00, /* 'K' */
+    0x07,0x00,0x00,0x00,0x00,0x7c,0x40,0x40,0x40,0x40,0x40,0x40,0x40,0x40,0x00,0x00,0x00, /* 'L' */
+    0x0b,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x44,0x40,0x44,0x40,0x4a,0x40,0x4a,0x40,0x51,0x40,0x51,0x40,0x60,0xc0,0x60,0xc0,0x40,0x40,0x00,0x00,0x00,0x00,0x00,0x00, /* 'M' */
+    0x09,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x41,0x00,0x43,0x00,0x45,0x00,0x45,0x00,0x49,0x00,0x51,0x00,0x51,0x00,0x61,0x00,0x41,0x00,0x00,0x00,0x00,0x00,0x00,0x00, /* 'N' */
+    0x0a,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x1e,0x00,0x21,0x00,0x40,0x80,0x40,0x80,0x40,0x80,0x40,0x80,0x40,0x80,0x21,0x00,0x1e,0x00,0x00,0x00,0x00,0x00,0x00,0x00, /* 'O' */
+    0x08,0x00,0x00,0x00,0x00,0x40,0x40,0x40,0x40,0x7c,0x42,0x42,0x42,0x7c,0x00,0x00,0x00, /* 'P' */
+    0x0a,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x1e,0x80,0x21,0x00,0x42,0x80,0x44,0x80,0x40,0x80,0x40,0x80,0x40,0x80,0x21,0x00,0x1e,0x00,0x00,0x00,0x00,0x00,0x00,0x00, /* 'Q' */
+    0x08,0x00,0x00,0x00,0x00,0x42,0x42,0x42,0x44,0x7c,0x42,0x42,0x42,0x7c,0x00,0x00,0x00, /* 'R' */
+    0x08,0x00,0x00,0x00,0x00,0x3c,0x42,0x42,0x02,0x0c,0x30,0x40,0x42,0x3c,0x00,0x00,0x00, /* 'S' */
+    0x07,0x00,0x00,0x00,0x00,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0xfe,0x00,0x00,0x00, /* 'T' */
+    0x08,0x00,0x00,0x00,0x00,0x3c,0x42,0x42,0x42,0x42,0x42,0x42,0x42,0x42,0x00,0x00,0x00, /* 'U' */
+    0x09,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x08,0x00,0x08,0x00,0x14,0x00,0x14,0x00,0x22,0x00,0x22,0x00,0x22,0x00,0x41,0x00,0x41,0x00,0x00,0x00,0x00,0x00,0x00,0x00, /* 'V' */
+    0x0b,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x11,0x00,0x11,0x00,0x11,0x00,0x2a,0x80,0x2a,0x80,0x24,0x80,0x44,0x40,0x44,0x40,0x44,0x40,0x00,0x00,0x00,0x00,0x00,0x00, /* 'W' */
+    0x09,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x41,0x00,0x22,0x00,0x22,0x00,0x14,0x00,0x08,0x00,0x14,0x00,0x22,0x00,0x22,0x00,0x41,0x00,0x00,0x00,0x00,0x00,0x00,0x00, /* 'X' */
+    0x09,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x08,0x00,0x08,0x00,0x08,0x00,0x08,0x00,0x14,0x00,0x22,0x00,0x22,0x00,0x41,0x00,0x41,0x00,0x00,0x00,0x00,0x00,0x00,0x00, /* 'Y' */
+    0x09,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x7f,0x00,0x40,0x00,0x20,0x00,0x10,0x00,0x08,0x00,0x04,0x00,0x02,0x00,0x01,0x00,0x7f,0x00,0x00,0x00,0x00,0x00,0x00,0x00, /* 'Z' */
+    0x03,0x00,0x60,0x40,0x40,0x40,0x40,0x40,0x40,0x40,0x40,0x40,0x40,0x60,0x00,0x00,0x00, /* '[' */
+    0x04,0x00,0x00,0x00,0x00,0x10,0x10,0x20,0x20,0x20,0x40,0x40,0x80,0x80,0x00,0x00,0x00, /* '\\' */
+    0x03,0x00,0xc0,0x40,0x40,0x40,0x40,0x40,0x40,0x40,0x40,0x40,0x40,0xc0,0x00,0x00,0x00, /* ']' */
+    0x06,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x88,0x50,0x20,0x00,0x00,0x00,0x00, /* '^' */
+    0x07,0x00,0x00,0xfe,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00, /* '_' */
+    0x03,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xc0,0x80,0x40,0x00,0x00,0x00, /* '`' */
+    0x07,0x00,0x00,0x00,0x00,0x3a,0x44,0x44,0x3c,0x04,0x44,0x38,0x00,0x00,0x00,0x00,0x00, /* 'a' */
+    0x07,0x00,0x00,0x00,0x00,0x58,0x64,0x44,0x44,0x44,0x64,0x58,0x40,0x40,0x00,0x00,0x00, /* 'b' */
+    0x07,0x00,0x00,0x00,0x00,0x38,0x44,0x40,0x40,0x40,0x44,0x38,0x00,0x00,0x00,0x00,0x00, /* 'c' */
+    0x07,0x00,0x00,0x00,0x00,0x34,0x4c,0x44,0x44,0x44,0x4c,0x34,0x04,0x04,0x00,0x00,0x00, /* 'd' */
+    0x07,0x00,0x00,0x00,0x00,0x38,0x44,0x40,0x7c,0x44,0x44,0x38,0x00,0x00,0x00,0x00,0x00, /* 'e' */
+    0x03,0x00,0x00,0x00,0x00,0x40,0x40,0x40,0x40,0x40,0x40,0xe0,0x40,0x30,0x00,0x00,0x00, /* 'f' */
+    0x07,0x00,0x38,0x44,0x04,0x34,0x4c,0x44,0x44,0x44,0x4c,0x34,0x00,0x00,0x00,0x00,0x00, /* 'g' */
+    0x07,0x00,0x00,0x00,0x00,0x44,0x44,0x44,0x44,0x44,0x64,0x58,0x40,0x40,0x00,0x00,0x00, /* 'h' */
+    0x03,0x00,0x00,0x00,0x00,0x40,0x40,0x40,0x40,0x40,0x40,0x40,0x00,0x40,0x00,0x00,0x00, /* 'i' */
+    0x03,0x00,0x80,0x40,0x40,0x40,0x40,0x40,0x40,0x40,0x40,0x40,0x00,0x40,0x00,0x00,0x00, /* 'j' */
+    0x06,0x00,0x00,0x00,0x00,0x44,0x48,0x50,0x60,0x60,0x50,0x48,0x40,0x40,0x00,0x00,0x00, /* 'k' */
+    0x03,0x00,0x00,0x00,0x00,0x40,0x40,0x40,0x40,0x40,0x40,0x40,0x40,0x40,0x00,0x00,0x00, /* 'l' */
+    0x09,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x49,0x00,0x49,0x00,0x49,0x00,0x49,0x00,0x49,0x00,0x6d,0x00,0x52,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00, /* 'm' */
+    0x07,0x00,0x00,0x00,0x00,0x44,0x44,0x44,0x44,0x44,0x64,0x58,0x00,0x00,0x00,0x00,0x00, /* 'n' */
+    0x07,0x00,0x00,0x00,0x00,0x38,0x44,0x44,0x44,0x44,0x44,0x38,0x00,0x00,0x00,0x00,0x00, /* 'o' */
+    0x07,0x00,0x40,0x40,0x40,0x58,0x64,0x44,0x44,0x44,0x64,0x58,0x00,0x00,0x00,0x00,0x00, /* 'p' */
+    0x07,0x00,0x04,0x04,0x04,0x34,0x4c,0x44,0x44,0x44,0x4c,0x34,0x00,0x00,0x00,0x00,0x00, /* 'q' */
+    0x04,0x00,0x00,0x00,0x00,0x40,0x40,0x40,0x40,0x40,0x60,0x50,0x00,0x00,0x00,0x00,0x00, /* 'r' */
+    0x06,0x00,0x00,0x00,0x00,0x30,0x48,0x08,0x30,0x40,0x48,0x30,0x00,0x00,0x00,0x00,0x00, /* 's' */
+    0x03,0x00,0x00,0x00,0x00,0x60,0x40,0x40,0x40,0x40,0x40,0xe0,0x40,0x40,0x00,0x00,0x00, /* 't' */
+    0x07,0x00,0x00,0x00,0x00,0x34,0x4c,0x44,0x44,0x44,0x44,0x44,0x00,0x00,0x00,0x00,0x00, /* 'u' */
+    0x07,0x00,0x00,0x00,0x00,0x10,0x10,0x28,0x28,0x44,0x44,0x44,0x00,0x00,0x00,0x00,0x00, /* 'v' */
+    0x09,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x22,0x00,0x22,0x00,0x55,0x00,0x49,0x00,0x49,0x00,0x88,0x80,0x88,0x80,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00, /* 'w' */
+    0x06,0x00,0x00,0x00,0x00,0x84,0x84,0x48,0x30,0x30,0x48,0x84,0x00,0x00,0x00,0x00,0x00, /* 'x' */
+    0x07,0x00,0x40,0x20,0x10,0x10,0x28,0x28,0x48,0x44,0x44,0x44,0x00,0x00,0x00,0x00,0x00, /* 'y' */
+    0x06,0x00,0x00,0x00,0x00,0x78,0x40,0x20,0x20,0x10,0x08,0x78,0x00,0x00,0x00,0x00,0x00, /* 'z' */
+    0x04,0x00,0x30,0x40,0x40,0x40,0x40,0x40,0x80,0x40,0x40,0x40,0x40,0x30,0x00,0x00,0x00, /* '{' */
+    0x03,0x00,0x40,0x40,0x40,0x40,0x40,0x40,0x40,0x40,0x40,0x40,0x40,0x40,0x00,0x00,0x00, /* '|' */
+    0x04,0x00,0xc0,0x20,0x20,0x20,0x20,0x20,0x10,0x20,0x20,0x20,0x20,0xc0,0x00,0x00,0x00, /* '}' */
+    0x07,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x98,0x64,0x00,0x00,0x00,0x00,0x00,0x00,0x00, /* '~' */
+};
+
+static const struct { const unsigned char *data; int height, descent; } fonts[OV_FONTS] = {
+    {helvetica10, 14, 3},
+    {helvetica12, 16, 4},
+};
+
+typedef struct { short advance, u, v, empty; } OvGlyph;
+
+typedef struct {
+    float x, y, u, v;
+    GLubyte c[4];
+} OvVertex;
+
+#define ATLAS_W 256
+#define ATLAS_H 128
+
+static OvGlyph glyphs[OV_FONTS][95];
+static OvVertex stream[OV_MAX_QUADS * 6];
+static VglStream ov_stream;
+static int quad_count = 0;
+static GLubyte color[4] = {255, 255, 255, 255};
+static GLuint ov_prog = 0, ov_vao = 0, ov_vbo = 0, atlas = 0;
+
+void ov_color(float r, float g, float b, float a) {
+    float c[4] = {r, g, b, a};
+    for (int i = 0; i < 4; i++) color[i] = (GLubyte)((c[i] < 0 ? 0 : c[i] > 1 ? 1 : c[i]) * 255.0f + 0.5f);
+}
+
+/* Texels [u0, u1) x [v0, v1) of the atlas on window pixels [x0, x1) x [y0, y1) */
+static void quad(float x0, float y0, float x1, float y1, float u0, float v0, float u1, float v1) {
+    if (quad_count >= OV_MAX_QUADS) return;
+    OvVertex *q = &stream[quad_count++ * 6];
+    u0 /= ATLAS_W; u1 /= ATLAS_W; v0 /= ATLAS_H; v1 /= ATLAS_H;
+    OvVertex a = {x0, y0, u0, v0}, b = {x1, y0, u1, v0}, c = {x1, y1, u1, v1}, d = {x0, y1, u0, v1};
+    q[0] = a; q[1] = b; q[2] = c; q[3] = a; q[4] = c; q[5] = d;
+    for (int i = 0; i < 6; i++) memcpy(q[i].c, color, 4);
+}
+
+void ov_rect(float x0, float y0, float x1, float y1) { quad(x0, y0, x1, y1, 0.25f, 0.25f, 0.75f, 0.75f); } /* Inside the white texel */
+
+void ov_frame(float x0, float y0, float x1, float y1) {
+    ov_rect(x0, y0, x1, y0 + 1); ov_rect(x0, y1 - 1, x1, y1);
+    ov_rect(x0, y0 + 1, x0 + 1, y1 - 1); ov_rect(x1 - 1, y0 + 1, x1, y1 - 1);
+}
+
+int ov_label(OvLabel *l, int font, const char *text) {
+    if (l->count >= 0 && l->font == font && strncmp(l->text, text, OV_LABEL_MAX) == 0) return l->width;
+    snprintf(l->text, OV_LABEL_MAX, "%s", text);
+    l->font = font; l->count = 0;
+    int pen = 0;
+    for (const char *p = l->text; *p; p++) {
+        int g = (*p >= 32 && *p < 127) ? *p - 32 : '?' - 32;
+        l->pen[l->count] = pen; l->glyph[l->count++] = g;
+        pen += glyphs[font][g].advance;
+    }
+    return l->width = pen;
+}
+
+void ov_draw_label(const OvLabel *l, float x, float y) {
+    /* Whole pixels, as glBitmap placed them: the atlas maps texel to pixel */
+    x = floorf(x + 0.5f); y = floorf(y + 0.5f) - fonts[l->font].descent;
+    int h = fonts[l->font].height;
+    for (int i = 0; i < l->count; i++) {
+        const OvGlyph *g = &glyphs[l->font][l->glyph[i]];
+        if (g->empty) continue;
+        quad(x + l->pen[i], y, x + l->pen[i] + g->advance, y + h, g->u, g->v, g->u + g->advance, g->v + h);
+    }
+}
+
+void ov_text(float x, float y, int font, const char *text) {
+    OvLabel l = {.count = -1};
+    ov_label(&l, font, text);
+    ov_draw_label(&l, x, y);
+}
+
+/* --- GPU side --- */
+
+static const char *vertex_src =
+    "#version 330 core\n"
+    VGL_FRAME_GLSL
+    "layout(location = 0) in vec2 a_pos;\n"
+    "layout(location = 1) in vec2 a_uv;\n"
+    "layout(location = 2) in vec4 a_color;\n"
+    "out vec2 v_uv;\n"
+    "out vec4 v_color;\n"
+    "void main() {\n"
+    "    gl_Position = screen * vec4(a_pos, 0.0, 1.0);\n"
+    "    v_uv = a_uv;\n"
+    "    v_color = a_color;\n"
+    "}\n";
+
+static const char *fragment_src =
+    "#version 330 core\n"
+    "uniform sampler2D u_atlas;\n"
+    "in vec2 v_uv;\n"
+    "in vec4 v_color;\n"
+    "out vec4 frag;\n"
+    "void main() { frag = vec4(v_color.rgb, v_color.a * texture(u_atlas, v_uv).r); }\n";
+
+/* Glyph cells row by row; texel (0, 0) stays white for the rectangles */
+static void build_atlas(unsigned char *pixels) {
+    int x = 1, y = 0;
+    pixels[0] = 255;
+    for (int f = 0; f < OV_FONTS; f++) {
+        const unsigned char *p = fonts[f].data;
+        int h = fonts[f].height;
+        for (int c = 0; c < 95; c++) {
+            int w = *p++, bpr = (w + 7) / 8;
+            if (x + w > ATLAS_W) { x = 0; y += h; }
+            OvGlyph *g = &glyphs[f][c];
+            g->advance = w; g->u = x; g->v = y; g->empty = 1;
+            for (int r = 0; r < h; r++, p += bpr)
+                for (int i = 0; i < w; i++)
+                    if (p[i / 8] & (0x80 >> (i % 8))) { pixels[(y + r) * ATLAS_W + x + i] = 255; g->empty = 0; }
+            x += w;
+        }
+        x = 0; y += h;
+    }
+}
+
+int ov_init() {
+    if (!(ov_prog = vgl_program("overlay", vertex_src, fragment_src))) return 0;
+    glUseProgram(ov_prog);
+    glUniform1i(glGetUniformLocation(ov_prog, "u_atlas"), 0);
+    glUseProgram(0);
+
+    static unsigned char pixels[ATLAS_W * ATLAS_H];
+    build_atlas(pixels);
+    glGenTextures(1, &atlas);
+    glBindTexture(GL_TEXTURE_2D, atlas);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, ATLAS_W, ATLAS_H, 0, GL_RED, GL_UNSIGNED_BYTE, pixels);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenVertexArrays(1, &ov_vao);
+    glBindVertexArray(ov_vao);
+    glGenBuffers(1, &ov_vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, ov_vbo);
+    if (!vgl_stream_init(&ov_stream, ov_vbo, sizeof(OvVertex), OV_MAX_QUADS * 6)) return 0;
+    glEnableVertexAttribArray(0); glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(OvVertex), (void *)offsetof(OvVertex, x));
+    glEnableVertexAttribArray(1); glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(OvVertex), (void *)offsetof(OvVertex, u));
+    glEnableVertexAttribArray(2); glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(OvVertex), (void *)offsetof(OvVertex, c));
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return 1;
+}
+
+void ov_flush() {
+    if (!ov_prog || !quad_count) { quad_count = 0; return; }
+    OvVertex *dst = vgl_stream_begin(&ov_stream, quad_count * 6);
+    if (dst) memcpy(dst, stream, quad_count * 6 * sizeof(OvVertex));
+    int base = vgl_stream_end(&ov_stream, dst ? quad_count * 6 : 0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    if (!dst) { quad_count = 0; return; }
+    glUseProgram(ov_prog);
+    glBindVertexArray(ov_vao);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, atlas);
+    glDisable(GL_DEPTH_TEST);
+    glDrawArrays(GL_TRIANGLES, base, quad_count * 6);
+    glEnable(GL_DEPTH_TEST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindVertexArray(0);
+    glUseProgram(0);
+    vgl_stats.draws++; vgl_stats.vertices += quad_count * 6L;
+    quad_count = 0;
+}
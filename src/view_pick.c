@@ -0,0 +1,133 @@
+#define _DEFAULT_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "view_pick.h"
+
+typedef struct {
+    float lo[3], hi[3];
+    int first, count;               /* Leaf: items [first, first + count). Inner: count 0, right child at `first` */
+} PickNode;
+
+static PickSphere items[PICK_MAX];  /* In leaf order */
+static int order[PICK_MAX];         /* items[k] is input sphere order[k] */
+static int ids[PICK_MAX], item_count = 0;
+static PickNode nodes[2 * PICK_MAX];
+static int node_count = 0, refits = 0;
+
+static void sphere_box(const PickSphere *s, float *lo, float *hi) {
+    for (int a = 0; a < 3; a++) { lo[a] = s->c[a] - s->r; hi[a] = s->c[a] + s->r; }
+}
+
+static void grow(PickNode *n, const float *lo, const float *hi) {
+    for (int a = 0; a < 3; a++) {
+        if (lo[a] < n->lo[a]) n->lo[a] = lo[a];
+        if (hi[a] > n->hi[a]) n->hi[a] = hi[a];
+    }
+}
+
+static void leaf_bounds(PickNode *n) {
+    sphere_box(&items[n->first], n->lo, n->hi);
+    for (int k = 1; k < n->count; k++) { float lo[3], hi[3]; sphere_box(&items[n->first + k], lo, hi); grow(n, lo, hi); }
+}
+
+static int split_axis;
+static int cmp_centre(const void *a, const void *b) {
+    float x = ((const PickSphere *)a)->c[split_axis], y = ((const PickSphere *)b)->c[split_axis];
+    return (x > y) - (x < y);
+}
+
+/* Subtree over items [first, first + count): children follow their parent, the left one right after it */
+static void build(int first, int count) {
+    PickNode *n = &nodes[node_count++];
+    n->first = first; n->count = count;
+    leaf_bounds(n);
+    if (count <= PICK_LEAF) return;
+    /* Median on the axis where the centres spread most */
+    float lo[3] = {INFINITY, INFINITY, INFINITY}, hi[3] = {-INFINITY, -INFINITY, -INFINITY};
+    for (int k = first; k < first + count; k++)
+        for (int a = 0; a < 3; a++) {
+            if (items[k].c[a] < lo[a]) lo[a] = items[k].c[a];
+            if (items[k].c[a] > hi[a]) hi[a] = items[k].c[a];
+        }
+    split_axis = 0;
+    for (int a = 1; a < 3; a++) if (hi[a] - lo[a] > hi[split_axis] - lo[split_axis]) split_axis = a;
+    qsort(&items[first], count, sizeof(PickSphere), cmp_centre);
+    int half = count / 2;
+    n->count = 0;
+    build(first, half);
+    n->first = node_count;
+    build(first + half, count - half);
+}
+
+int pick_update(const PickSphere *s, int n) {
+    if (n > PICK_MAX) n = PICK_MAX;
+    int same = n == item_count && refits < PICK_REFITS;
+    for (int i = 0; i < n && same; i++) same = ids[i] == s[i].id;
+    if (same) {
+        /* Refit: new spheres in place, boxes from the leaves up (children always follow their parent) */
+        for (int k = 0; k < n; k++) items[k] = s[order[k]];
+        for (int i = node_count - 1; i >= 0; i--) {
+            PickNode *nd = &nodes[i];
+            if (nd->count) { leaf_bounds(nd); continue; }
+            const PickNode *l = &nodes[i + 1], *r = &nodes[nd->first];
+            memcpy(nd->lo, l->lo, sizeof(nd->lo)); memcpy(nd->hi, l->hi, sizeof(nd->hi));
+            grow(nd, r->lo, r->hi);
+        }
+        refits++;
+        return 0;
+    }
+    /* Rebuild: the sort moves spheres, their input index rides along in `id` until the tree is done */
+    item_count = n; node_count = 0; refits = 0;
+    for (int i = 0; i < n; i++) { ids[i] = s[i].id; items[i] = s[i]; items[i].id = i; }
+    if (n) build(0, n);
+    for (int k = 0; k < n; k++) { order[k] = items[k].id; items[k].id = ids[order[k]]; }
+    return 1;
+}
+
+/* Entry distance of the ray into the box, or INFINITY */
+static float slab(const PickNode *n, const float *org, const float *inv) {
+    float t0 = 0, t1 = INFINITY;
+    for (int a = 0; a < 3; a++) {
+        float near = (n->lo[a] - org[a]) * inv[a], far = (n->hi[a] - org[a]) * inv[a];
+        if (near > far) { float x = near; near = far; far = x; }
+        if (near > t0) t0 = near;
+        if (far < t1) t1 = far;
+        if (t0 > t1) return INFINITY;
+    }
+    return t0;
+}
+
+int pick_ray(const float *org, const float *dir, float *t) {
+    if (!item_count) return -1;
+    float inv[3], dd = dir[0]*dir[0] + dir[1]*dir[1] + dir[2]*dir[2];
+    for (int a = 0; a < 3; a++) inv[a] = 1.0f / dir[a];    /* ±inf on a zero component: the slab test still holds */
+    float best = INFINITY;
+    int hit = -1;
+    int stack[64], sp = 0;
+    if (slab(&nodes[0], org, inv) < INFINITY) stack[sp++] = 0;
+    while (sp) {
+        const PickNode *n = &nodes[stack[--sp]];
+        if (slab(n, org, inv) >= best) continue;
+        if (n->count) {
+            for (int k = n->first; k < n->first + n->count; k++) {
+                const PickSphere *s = &items[k];
+                float oc[3] = {org[0] - s->c[0], org[1] - s->c[1], org[2] - s->c[2]};
+                float b = oc[0]*dir[0] + oc[1]*dir[1] + oc[2]*dir[2], c = oc[0]*oc[0] + oc[1]*oc[1] + oc[2]*oc[2] - s->r * s->r;
+                float disc = b * b - dd * c;
+                if (disc < 0) continue;
+                float ts = (-b - sqrtf(disc)) / dd;
+                if (ts < 0) ts = 0;                                 /* Camera inside the sphere */
+                if ((-b + sqrtf(disc)) / dd >= 0 && ts < best) { best = ts; hit = s->id; }
+            }
+            continue;
+        }
+        /* Nearer child last, so it is popped first */
+        int l = n - nodes + 1, r = n->first;
+        float tl = slab(&nodes[l], org, inv), tr = slab(&nodes[r], org, inv);
+        if (tl <= tr) { if (tr < best) stack[sp++] = r; if (tl < best) stack[sp++] = l; }
+        else { if (tl < best) stack[sp++] = l; if (tr < best) stack[sp++] = r; }
+    }
+    if (hit >= 0 && t) *t = best;
+    return hit;
+}
@@ -0,0 +1,142 @@
+#define _DEFAULT_SOURCE
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <stdio.h>
+#include <string.h>
+#include "view_quality.h"
+#include "view_mesh.h"
+#include "view_fx.h"
+#include "view_trail.h"
+
+/* Cheapest losses first: detail far away, sparks, trails and tags, resolution last */
+static const QualKnobs ladder[QUAL_LEVELS] = {
+    {1.00f, 1.00f, TRAIL_POINTS, 1 << 30, 1.00f},
+    {0.60f, 0.75f, 32, 1 << 30, 1.00f},
+    {0.35f, 0.50f, 24, 32, 1.00f},
+    {0.20f, 0.35f, 16, 16, 1.00f},
+    {0.00f, 0.25f, 10, 8, 0.75f},
+    {0.00f, 0.15f, 6, 4, 0.50f},
+};
+
+static double budget = 0;           /* ms per frame, 0: governor off */
+static int scaling = 1;
+static int level = 0;
+static QualKnobs knobs = {1.00f, 1.00f, TRAIL_POINTS, 1 << 30, 1.00f};
+static double avg = 0;
+static int over = 0, under = 0, hold = 0;
+static int finish = 0;              /* Time frames to glFinish instead of GPU queries */
+static int log_changes = 0;
+
+/* GPU time per frame, read back QUAL_QUERIES - 1 frames later at most, never waited on */
+static GLuint queries[QUAL_QUERIES];
+static double query_cpu[QUAL_QUERIES];
+static int q_next = 0, q_pending = 0, q_open = 0, q_first = 1;
+
+static GLuint fbo = 0, rb[2];
+static int fbo_w = 0, fbo_h = 0;
+static GLint outer_fbo = 0;         /* Where the scaled scene goes: the window, or the bench's framebuffer */
+
+static void apply(int l) {
+    level = l;
+    knobs = ladder[l];
+    if (!scaling) knobs.scale = 1.0f;
+    mesh_detail(knobs.detail);
+    fx_density(knobs.particles);
+    trail_length(knobs.trail);
+}
+
+void qual_target(double fps, int scale) {
+    budget = fps > 0 ? 1000.0 / fps : 0;
+    scaling = scale;
+    avg = 0; over = under = hold = 0;
+    apply(0);
+    /* Software GL rasterises when the frame is finished, and its queries would wait for that anyway */
+    const char *r = (const char *)glGetString(GL_RENDERER);
+    finish = r && (strstr(r, "llvmpipe") || strstr(r, "softpipe") || strstr(r, "Software"));
+}
+
+void qual_finish(int on) { finish = on; }
+int qual_finishes() { return budget > 0 && finish; }
+
+int qual_enabled() { return budget > 0; }
+void qual_log(int on) { log_changes = on; }
+int qual_level() { return level; }
+
+const QualKnobs *qual_knobs() { return &knobs; }
+
+void qual_frame(double ms) {
+    if (budget <= 0) return;
+    avg = avg > 0 ? avg * 0.9 + ms * 0.1 : ms;
+    if (hold > 0) { hold--; return; }
+    int to = level;
+    if (avg > budget) {
+        under = 0;
+        if (++over >= QUAL_DOWN_FRAMES && level < QUAL_LEVELS - 1) to = level + 1;
+    } else if (avg < budget * QUAL_UP_RATIO) {
+        over = 0;
+        if (++under >= QUAL_UP_FRAMES && level > 0) to = level - 1;
+    } else over = under = 0;
+    if (to == level) return;
+    if (log_changes) fprintf(stderr, "--- QUALITY: level %d -> %d (%.1f ms per frame, budget %.1f) ---\n", level, to, avg, budget);
+    apply(to);
+    avg = 0; over = under = 0; hold = QUAL_HOLD_FRAMES;
+}
+
+void qual_frame_begin() {
+    if (budget <= 0 || finish || q_pending == QUAL_QUERIES) return;   /* All in flight: this frame goes untimed */
+    if (!queries[0]) glGenQueries(QUAL_QUERIES, queries);
+    glBeginQuery(GL_TIME_ELAPSED, queries[q_next]);
+    q_open = 1;
+}
+
+void qual_frame_end(double cpu_ms) {
+    if (budget <= 0) return;
+    if (finish) { qual_frame(cpu_ms); return; }
+    if (q_open) {
+        glEndQuery(GL_TIME_ELAPSED);
+        query_cpu[q_next] = cpu_ms;
+        q_next = (q_next + 1) % QUAL_QUERIES; q_pending++; q_open = 0;
+    }
+    /* Finished frames in order: the cost is whichever of CPU and GPU took longer */
+    while (q_pending) {
+        int q = (q_next - q_pending + QUAL_QUERIES) % QUAL_QUERIES;
+        GLint ready = 0;
+        glGetQueryObjectiv(queries[q], GL_QUERY_RESULT_AVAILABLE, &ready);
+        if (!ready) break;
+        GLuint64 ns = 0;
+        glGetQueryObjectui64v(queries[q], GL_QUERY_RESULT, &ns);
+        q_pending--;
+        if (q_first) { q_first = 0; continue; }    /* Covers context start-up on some drivers (llvmpipe: seconds) */
+        qual_frame(ns / 1e6 > query_cpu[q] ? ns / 1e6 : query_cpu[q]);
+    }
+}
+
+void qual_scene_begin(int width, int height) {
+    if (knobs.scale >= 1.0f) return;
+    int w = (int)(width * knobs.scale), h = (int)(height * knobs.scale);
+    if (w < 1) w = 1;
+    if (h < 1) h = 1;
+    if (!fbo) { glGenFramebuffers(1, &fbo); glGenRenderbuffers(2, rb); }
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &outer_fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    if (w != fbo_w || h != fbo_h) {
+        glBindRenderbuffer(GL_RENDERBUFFER, rb[0]); glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, w, h);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, rb[0]);
+        glBindRenderbuffer(GL_RENDERBUFFER, rb[1]); glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, w, h);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rb[1]);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        fbo_w = w; fbo_h = h;
+    }
+    glViewport(0, 0, w, h);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void qual_scene_end(int width, int height) {
+    if (knobs.scale >= 1.0f) return;
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, outer_fbo);
+    glBlitFramebuffer(0, 0, fbo_w, fbo_h, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    glBindFramebuffer(GL_FRAMEBUFFER, outer_fbo);
+    glViewport(0, 0, width, height);
+}
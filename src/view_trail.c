@@ -0,0 +1,130 @@
+#define _DEFAULT_SOURCE
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <stddef.h>
+#include "view_trail.h"
+#include "view_gl.h"
+
+#define STR_(x) #x
+#define STR(x) STR_(x)
+
+typedef struct {
+    float p[3];
+    GLubyte c[4];
+    GLint tick;                     /* When this point was laid */
+    GLint seg;                      /* When the segment was laid: its newer point */
+    GLint slot;
+} TrailVertex;
+
+static TrailVertex ring[TRAIL_RING * 2];
+static unsigned long head = 0;      /* Segments ever appended */
+static unsigned long uploaded = 0;
+static unsigned long tick_start[TRAIL_POINTS]; /* `head` when each of the last ticks began */
+static GLint now = 1;
+static GLint cut[TRAIL_SLOTS];
+static int cut_dirty = 1;
+static GLint length = TRAIL_POINTS;
+
+static GLuint trail_prog = 0, trail_vao = 0, trail_vbo = 0;
+static GLint u_now = -1, u_cut = -1, u_len = -1;
+
+void trail_tick() {
+    now++;
+    tick_start[now % TRAIL_POINTS] = head;
+}
+
+void trail_append(int slot, const float *from, const float *to, float r, float g, float b) {
+    if (slot < 0 || slot >= TRAIL_SLOTS) return;
+    TrailVertex *v = &ring[(head++ % TRAIL_RING) * 2];
+    GLubyte c[4] = {(GLubyte)(r * 255.0f + 0.5f), (GLubyte)(g * 255.0f + 0.5f), (GLubyte)(b * 255.0f + 0.5f), 255};
+    v[0] = (TrailVertex){{from[0], from[1], from[2]}, {c[0], c[1], c[2], c[3]}, now - 1, now, slot};
+    v[1] = (TrailVertex){{to[0], to[1], to[2]}, {c[0], c[1], c[2], c[3]}, now, now, slot};
+}
+
+void trail_length(int points) { length = points < 2 ? 2 : points > TRAIL_POINTS ? TRAIL_POINTS : points; }
+
+void trail_cut(int slot) {
+    if (slot < 0 || slot >= TRAIL_SLOTS) return;
+    cut[slot] = now + 1;            /* Segments of this tick go too: the caller restarts the trail */
+    cut_dirty = 1;
+}
+
+/* --- GPU side --- */
+
+static const char *vertex_src =
+    "#version 330 core\n"
+    VGL_FRAME_GLSL
+    "layout(location = 0) in vec3 a_pos;\n"
+    "layout(location = 1) in vec4 a_color;\n"
+    "layout(location = 2) in ivec3 a_tick;\n"      /* Point tick, segment tick, slot */
+    "uniform int u_now;\n"
+    "uniform int u_len;\n"
+    "uniform int u_cut[" STR(TRAIL_SLOTS) "];\n"
+    "out vec4 v_color;\n"
+    "void main() {\n"
+    "    gl_Position = proj * view * vec4(a_pos, 1.0);\n"
+    "    if (u_now - a_tick.y > u_len - 2 || a_tick.y < u_cut[a_tick.z]) gl_Position = vec4(2.0, 2.0, 2.0, 1.0);\n"
+    "    v_color = vec4(a_color.rgb, (1.0 - float(u_now - a_tick.x) / float(u_len)) * 0.5);\n"
+    "}\n";
+
+static const char *fragment_src =
+    "#version 330 core\n"
+    "in vec4 v_color;\n"
+    "out vec4 frag;\n"
+    "void main() { frag = v_color; }\n";
+
+int trail_init() {
+    if (!(trail_prog = vgl_program("trail", vertex_src, fragment_src))) return 0;
+    u_now = glGetUniformLocation(trail_prog, "u_now");
+    u_cut = glGetUniformLocation(trail_prog, "u_cut");
+    u_len = glGetUniformLocation(trail_prog, "u_len");
+
+    glGenVertexArrays(1, &trail_vao);
+    glBindVertexArray(trail_vao);
+    glGenBuffers(1, &trail_vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, trail_vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(ring), ring, GL_DYNAMIC_DRAW);
+    glEnableVertexAttribArray(0); glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(TrailVertex), (void *)offsetof(TrailVertex, p));
+    glEnableVertexAttribArray(1); glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(TrailVertex), (void *)offsetof(TrailVertex, c));
+    glEnableVertexAttribArray(2); glVertexAttribIPointer(2, 3, GL_INT, sizeof(TrailVertex), (void *)offsetof(TrailVertex, tick));
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    uploaded = head;
+    return 1;
+}
+
+/* Segments [from, to) of the ring, split where it wraps */
+static void upload(unsigned long from, unsigned long to) {
+    int a = from % TRAIL_RING, n = to - from;
+    int first = n < TRAIL_RING - a ? n : TRAIL_RING - a;
+    glBufferSubData(GL_ARRAY_BUFFER, a * 2 * sizeof(TrailVertex), first * 2 * sizeof(TrailVertex), &ring[a * 2]);
+    if (n > first) glBufferSubData(GL_ARRAY_BUFFER, 0, (n - first) * 2 * sizeof(TrailVertex), ring);
+}
+
+void trail_draw() {
+    if (!trail_prog) return;
+    glBindBuffer(GL_ARRAY_BUFFER, trail_vbo);
+    if (head - uploaded > TRAIL_RING) uploaded = head - TRAIL_RING;
+    if (head != uploaded) upload(uploaded, head);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    uploaded = head;
+
+    /* Live window: segments laid in the last length - 1 ticks */
+    unsigned long from = now > length - 2 ? tick_start[(now - (length - 2)) % TRAIL_POINTS] : 0;
+    if (head - from > TRAIL_RING) from = head - TRAIL_RING;
+    if (from == head) return;
+    glUseProgram(trail_prog);
+    glUniform1i(u_now, now);
+    glUniform1i(u_len, length);
+    if (cut_dirty) { glUniform1iv(u_cut, TRAIL_SLOTS, cut); cut_dirty = 0; }
+    glBindVertexArray(trail_vao);
+    glLineWidth(2.0f);
+    int a = from % TRAIL_RING, n = head - from, first = n < TRAIL_RING - a ? n : TRAIL_RING - a;
+    glDrawArrays(GL_LINES, a * 2, first * 2);
+    if (n > first) glDrawArrays(GL_LINES, 0, (n - first) * 2);
+    glLineWidth(1.0f);
+    glBindVertexArray(0);
+    glUseProgram(0);
+    vgl_stats.draws += 1 + (n > first); vgl_stats.vertices += n * 2L;
+}